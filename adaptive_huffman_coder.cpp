@@ -0,0 +1,251 @@
+#include "adaptive_huffman_coder.hpp"
+#include "file_format_error.h"
+
+adaptive_huffman_coder::adaptive_huffman_coder()
+{
+    reset();
+}
+
+void adaptive_huffman_coder::reset()
+{
+    nyt = ROOT;
+    nodes[ROOT] = { 0, NONE, NONE, NONE, -1 };
+    
+    for (uint16_t& leaf : leaf_of)
+    {
+        leaf = NONE;
+    }
+}
+
+size_t adaptive_huffman_coder::encode(const int8_t* text,
+                                      size_t length,
+                                      std::vector<uint64_t>& words)
+{
+    words.clear();
+    uint64_t accumulator = 0;
+    size_t number_of_bits = 0;
+    
+    // The bits of a code word are found from the leaf up to the root:
+    uint8_t path[MAX_NODES];
+    
+    auto put_bit = [&](uint64_t bit) {
+        accumulator |= bit << (number_of_bits % 64);
+        
+        if (++number_of_bits % 64 == 0)
+        {
+            words.push_back(accumulator);
+            accumulator = 0;
+        }
+    };
+    
+    for (size_t i = 0; i != length; ++i)
+    {
+        uint8_t character = (uint8_t) text[i];
+        uint16_t number = leaf_of[character];
+        bool is_new = number == NONE;
+        
+        if (is_new)
+        {
+            number = nyt;
+        }
+        
+        size_t path_length = 0;
+        
+        for (; number != ROOT; number = nodes[number].parent)
+        {
+            path[path_length++] = nodes[nodes[number].parent].right == number;
+        }
+        
+        while (path_length != 0)
+        {
+            put_bit(path[--path_length]);
+        }
+        
+        if (is_new)
+        {
+            for (size_t bit = 0; bit != 8; ++bit)
+            {
+                put_bit((character >> bit) & 1);
+            }
+        }
+        
+        update(character);
+    }
+    
+    if (number_of_bits % 64 != 0)
+    {
+        words.push_back(accumulator);
+    }
+    
+    return number_of_bits;
+}
+
+void adaptive_huffman_coder::decode(const int8_t* data,
+                                    size_t number_of_bits,
+                                    int8_t* text,
+                                    size_t length)
+{
+    size_t position = 0;
+    
+    auto get_bit = [&]() {
+        if (position == number_of_bits)
+        {
+            throw file_format_error{"The adaptive code ends in the middle of "
+                                    "a code word."};
+        }
+        
+        uint8_t byte = (uint8_t) data[position / 8];
+        return (byte >> (position++ % 8)) & 1;
+    };
+    
+    for (size_t i = 0; i != length; ++i)
+    {
+        uint16_t number = ROOT;
+        
+        while (!is_leaf(number))
+        {
+            number = get_bit() != 0 ? nodes[number].right : nodes[number].left;
+        }
+        
+        uint8_t character;
+        
+        if (number == nyt)
+        {
+            character = 0;
+            
+            for (size_t bit = 0; bit != 8; ++bit)
+            {
+                character |= get_bit() << bit;
+            }
+        }
+        else
+        {
+            character = (uint8_t) nodes[number].character;
+        }
+        
+        text[i] = (int8_t) character;
+        update(character);
+    }
+    
+    if (position != number_of_bits)
+    {
+        throw file_format_error{"The adaptive code has bits left over."};
+    }
+}
+
+void adaptive_huffman_coder::update(uint8_t character)
+{
+    uint16_t leaf_to_increment = NONE;
+    uint16_t q = leaf_of[character];
+    
+    if (q == NONE)
+    {
+        // The "not yet transmitted" leaf spawns the leaf of the character
+        // and the next "not yet transmitted" leaf:
+        uint16_t leaf = nyt - 1;
+        uint16_t next_nyt = nyt - 2;
+        nodes[leaf] = { 0, nyt, NONE, NONE, character };
+        nodes[next_nyt] = { 0, nyt, NONE, NONE, -1 };
+        nodes[nyt].left = next_nyt;
+        nodes[nyt].right = leaf;
+        leaf_of[character] = leaf;
+        q = nyt;
+        nyt = next_nyt;
+        leaf_to_increment = leaf;
+    }
+    else
+    {
+        // Move the leaf to the top of the leaves of its weight:
+        uint16_t leader = q;
+        
+        while (leader != ROOT &&
+               is_leaf(leader + 1) &&
+               nodes[leader + 1].weight == nodes[q].weight)
+        {
+            ++leader;
+        }
+        
+        if (leader != q)
+        {
+            swap_nodes(q, leader);
+            q = leader;
+        }
+        
+        // The sibling of the "not yet transmitted" leaf is incremented last,
+        // after its parent has outgrown it:
+        if (nodes[q].parent == nodes[nyt].parent)
+        {
+            leaf_to_increment = q;
+            q = nodes[q].parent;
+        }
+    }
+    
+    while (q != NONE)
+    {
+        q = slide_and_increment(q);
+    }
+    
+    if (leaf_to_increment != NONE)
+    {
+        slide_and_increment(leaf_to_increment);
+    }
+}
+
+uint16_t adaptive_huffman_coder::slide_and_increment(uint16_t number)
+{
+    uint16_t old_parent = nodes[number].parent;
+    uint32_t weight = nodes[number].weight;
+    bool leaf = is_leaf(number);
+    
+    // A leaf goes past the internal nodes of its weight and an internal node
+    // past the leaves of the next weight, which keeps the leaves ahead of the
+    // internal nodes of the same weight:
+    while (number != ROOT)
+    {
+        uint16_t next = number + 1;
+        bool passes = leaf
+                    ? !is_leaf(next) && nodes[next].weight == weight
+                    : is_leaf(next) && nodes[next].weight == weight + 1;
+        
+        if (!passes)
+        {
+            break;
+        }
+        
+        swap_nodes(number, next);
+        number = next;
+    }
+    
+    ++nodes[number].weight;
+    
+    // The position an internal node left is taken by a leaf one heavier, so
+    // the old parent grows; a leaf grows its new parent:
+    return leaf ? nodes[number].parent : old_parent;
+}
+
+void adaptive_huffman_coder::swap_nodes(uint16_t a, uint16_t b)
+{
+    node a_node = nodes[a];
+    node b_node = nodes[b];
+    a_node.parent = nodes[b].parent;
+    b_node.parent = nodes[a].parent;
+    nodes[a] = b_node;
+    nodes[b] = a_node;
+    adopt(a);
+    adopt(b);
+}
+
+void adaptive_huffman_coder::adopt(uint16_t number)
+{
+    node& n = nodes[number];
+    
+    if (!is_leaf(number))
+    {
+        nodes[n.left].parent = number;
+        nodes[n.right].parent = number;
+    }
+    else if (n.character >= 0)
+    {
+        leaf_of[n.character] = number;
+    }
+}
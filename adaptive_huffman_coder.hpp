@@ -0,0 +1,103 @@
+#ifndef ADAPTIVE_HUFFMAN_CODER_HPP
+#define ADAPTIVE_HUFFMAN_CODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/******************************************************************************
+* The one-pass adaptive Huffman code of Vitter (algorithm Lambda). The code   *
+* tree starts with the lone "not yet transmitted" leaf and is updated after   *
+* each character, so that no code table is stored and every character can be *
+* emitted as soon as it is read. The first occurrence of a character is      *
+* coded as the code word of the "not yet transmitted" leaf followed by the    *
+* eight bits of the character. The decoder mirrors the updates of the        *
+* encoder. The tree lives in fixed arrays, so nothing is allocated.           *
+******************************************************************************/
+class adaptive_huffman_coder {
+public:
+    
+    /*******************************************
+    * Constructs a coder in the initial state. *
+    *******************************************/
+    adaptive_huffman_coder();
+    
+    /*************************************************************************
+    * Returns the coder to the initial state, so that the next text is coded *
+    * independently of the previous ones.                                    *
+    *************************************************************************/
+    void reset();
+    
+    /*************************************************************************
+    * Encodes the 'length' characters starting at 'text' into 'words', least *
+    * significant bit first, and returns the number of the encoded bits. The *
+    * storage of 'words' is reused.                                          *
+    *************************************************************************/
+    size_t encode(const int8_t* text,
+                  size_t length,
+                  std::vector<uint64_t>& words);
+    
+    /**************************************************************************
+    * Decodes 'length' characters from the 'number_of_bits' bits at 'data'    *
+    * into 'text'. Throws 'file_format_error' if the bits run out or some are *
+    * left over.                                                              *
+    **************************************************************************/
+    void decode(const int8_t* data,
+                size_t number_of_bits,
+                int8_t* text,
+                size_t length);
+    
+private:
+    
+    constexpr static size_t NUMBER_OF_CHARACTERS = 256;
+    
+    // Every character leaf, the "not yet transmitted" leaf and the internal
+    // nodes joining them:
+    constexpr static size_t MAX_NODES = 2 * (NUMBER_OF_CHARACTERS + 1) - 1;
+    
+    // The root has the highest node number:
+    constexpr static size_t ROOT = MAX_NODES - 1;
+    
+    constexpr static uint16_t NONE = UINT16_MAX;
+    
+    // A node of the code tree. The node numbers order the nodes by weight,
+    // with the leaves preceding the internal nodes of the same weight. A
+    // parent link belongs to the position, the rest moves with the subtree:
+    struct node {
+        uint32_t weight;
+        uint16_t parent;
+        uint16_t left;
+        uint16_t right;
+        int16_t  character; // -1 for the internal nodes.
+    };
+    
+    node nodes[MAX_NODES];
+    
+    // The leaf of each character, or 'NONE' if it has not occurred yet:
+    uint16_t leaf_of[NUMBER_OF_CHARACTERS];
+    
+    // The "not yet transmitted" leaf, which has the lowest node number:
+    uint16_t nyt;
+    
+    bool is_leaf(uint16_t number) const
+    {
+        return nodes[number].left == NONE;
+    }
+    
+    // Updates the tree after an occurrence of 'character':
+    void update(uint8_t character);
+    
+    // Moves the node 'number' past the following nodes it must precede once
+    // its weight grows, increments the weight and returns the next node to
+    // update:
+    uint16_t slide_and_increment(uint16_t number);
+    
+    // Exchanges the subtrees at the positions 'a' and 'b', neither of which
+    // is an ancestor of the other:
+    void swap_nodes(uint16_t a, uint16_t b);
+    
+    // Points the children or the character of the node 'number' to it:
+    void adopt(uint16_t number);
+};
+
+#endif // ADAPTIVE_HUFFMAN_CODER_HPP
@@ -0,0 +1,380 @@
+/***************************************************************************
+* The micro-benchmark of the pipeline stages. Build it from the repository *
+* root together with all the sources but 'main.cpp', for example:          *
+*                                                                          *
+*     g++ -std=c++14 -O3 -pthread -I. benchmark/benchmark.cpp \            *
+*         $(ls *.cpp | grep -v '^main.cpp$') -o huffman_benchmark          *
+*                                                                          *
+* Usage: huffman_benchmark [--min-size BYTES] [--max-size BYTES]           *
+*                          [--repetitions N] [--distribution NAME]         *
+***************************************************************************/
+
+#include "block_compressor.hpp"
+#include "block_decompressor.hpp"
+#include "byte_counts.hpp"
+#include "code_table.hpp"
+#include "histogram.hpp"
+#include "huffman_decode_table.hpp"
+#include "huffman_decoder.hpp"
+#include "huffman_deserializer.hpp"
+#include "huffman_encoder.hpp"
+#include "huffman_serializer.hpp"
+#include "huffman_tree.hpp"
+#include "length_limited_code.hpp"
+#include "minimum_redundancy_code.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// The smallest and the largest benchmarked input:
+static const size_t MIN_INPUT_SIZE = 64;
+static const size_t MAX_INPUT_SIZE = (size_t) 1 << 30;
+
+// Each stage is repeated until it has run this long, but at least the
+// requested number of times:
+static const double MIN_STAGE_SECONDS = 0.2;
+static const size_t MAX_REPETITIONS = 1000000;
+
+// Keeps the optimizer from dropping the benchmarked work:
+static volatile uint64_t sink;
+
+// The statistics of the repeated runs of a stage:
+struct measurement {
+    double mean_ns_per_byte;
+    double stddev_ns_per_byte;
+    size_t repetitions;
+};
+
+// Runs 'stage' repeatedly and measures the time per input byte:
+measurement measure(const std::function<void()>& stage,
+                    size_t input_size,
+                    size_t min_repetitions)
+{
+    std::vector<double> samples;
+    double total_seconds = 0.0;
+    
+    while (samples.size() < MAX_REPETITIONS &&
+           (samples.size() < min_repetitions ||
+            total_seconds < MIN_STAGE_SECONDS))
+    {
+        auto start = std::chrono::steady_clock::now();
+        stage();
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        total_seconds += seconds;
+        samples.push_back(1e9 * seconds / input_size);
+    }
+    
+    double sum = 0.0;
+    
+    for (double sample : samples)
+    {
+        sum += sample;
+    }
+    
+    double mean = sum / samples.size();
+    double squares = 0.0;
+    
+    for (double sample : samples)
+    {
+        squares += (sample - mean) * (sample - mean);
+    }
+    
+    measurement m;
+    m.mean_ns_per_byte = mean;
+    m.stddev_ns_per_byte = samples.size() > 1 ?
+                           std::sqrt(squares / (samples.size() - 1)) :
+                           0.0;
+    m.repetitions = samples.size();
+    return m;
+}
+
+// Returns 'size' bytes distributed as named by 'distribution':
+std::vector<int8_t> generate_input(const std::string& distribution,
+                                   size_t size)
+{
+    std::default_random_engine engine(12345);
+    std::vector<int8_t> input(size);
+    
+    if (distribution == "uniform")
+    {
+        std::uniform_int_distribution<int> dist(0, 255);
+        
+        for (int8_t& c : input)
+        {
+            c = (int8_t) dist(engine);
+        }
+    }
+    else if (distribution == "zipf")
+    {
+        std::vector<double> weights;
+        
+        for (size_t rank = 1; rank <= 256; ++rank)
+        {
+            weights.push_back(1.0 / std::pow((double) rank, 1.1));
+        }
+        
+        std::discrete_distribution<int> dist(weights.begin(), weights.end());
+        
+        for (int8_t& c : input)
+        {
+            c = (int8_t) dist(engine);
+        }
+    }
+    else if (distribution == "text")
+    {
+        // Letter frequencies of English with words of varying length:
+        static const char letters[] = "etaoinshrdlcumwfgypbvkjxqz";
+        static const double frequencies[] = {
+            12.7, 9.1, 8.2, 7.5, 7.0, 6.7, 6.3, 6.1, 6.0, 4.3, 4.0, 2.8, 2.8,
+            2.4, 2.4, 2.2, 2.0, 2.0, 1.9, 1.5, 1.0, 0.8, 0.2, 0.2, 0.1, 0.1
+        };
+        
+        std::discrete_distribution<int> letter_dist(std::begin(frequencies),
+                                                    std::end(frequencies));
+        std::geometric_distribution<int> word_length_dist(0.2);
+        std::uniform_int_distribution<int> punctuation_dist(0, 19);
+        size_t index = 0;
+        
+        while (index != size)
+        {
+            int word_length = 1 + word_length_dist(engine);
+            
+            for (int i = 0; i != word_length && index != size; ++i)
+            {
+                input[index++] = letters[letter_dist(engine)];
+            }
+            
+            if (index == size)
+            {
+                break;
+            }
+            
+            int punctuation = punctuation_dist(engine);
+            input[index++] = punctuation == 0 ? '\n' :
+                             punctuation == 1 ? ',' :
+                             punctuation == 2 ? '.' : ' ';
+        }
+    }
+    else if (distribution == "single")
+    {
+        std::fill(input.begin(), input.end(), 'a');
+    }
+    else
+    {
+        throw std::invalid_argument{"Unknown distribution: " + distribution};
+    }
+    
+    return input;
+}
+
+void print_measurement(const std::string& stage, const measurement& m)
+{
+    cout << "    "
+         << std::left << std::setw(22) << stage << std::right
+         << std::fixed << std::setprecision(3)
+         << std::setw(12) << m.mean_ns_per_byte << " ns/B"
+         << std::setw(10) << 1.0 / m.mean_ns_per_byte << " GB/s"
+         << "  stddev " << std::setw(9) << m.stddev_ns_per_byte << " ns/B"
+         << "  (" << m.repetitions << " runs)"
+         << endl;
+}
+
+// Benchmarks every stage on the input separately:
+void benchmark_stages(const std::vector<int8_t>& input,
+                      size_t min_repetitions)
+{
+    size_t size = input.size();
+    
+    histogram counts = compute_byte_histogram(input);
+    code_table table = build_minimum_redundancy_code(counts);
+    huffman_encoder encoder;
+    bit_string encoded_text = encoder.encode(table, input);
+    huffman_serializer serializer;
+    std::vector<int8_t> serialized = serializer.serialize(table, encoded_text);
+    huffman_deserializer deserializer;
+    huffman_decode_table decode_table(table);
+    huffman_decoder decoder;
+    std::vector<int8_t> decoded(size);
+    
+    std::vector<bit_string> streams =
+        encoder.encode_interleaved(table, input.data(), size, 4);
+    std::vector<int8_t> interleaved;
+    std::vector<size_t> numbers_of_bits;
+    
+    for (const bit_string& stream : streams)
+    {
+        stream.append_bytes_to(interleaved);
+        numbers_of_bits.push_back(stream.length());
+    }
+    
+    block_compressor compressor;
+    std::string text((const char*) input.data(), size);
+    std::istringstream text_in(text);
+    std::ostringstream compressed_out;
+    compressor.compress(text_in, compressed_out);
+    std::string compressed = compressed_out.str();
+    
+    print_measurement("count", measure([&]() {
+        sink += compute_byte_histogram(input).get_count('a');
+    }, size, min_repetitions));
+    
+    print_measurement("tree", measure([&]() {
+        huffman_tree tree(counts);
+        sink += tree.infer_canonical_code_table().max_length();
+    }, size, min_repetitions));
+    
+    print_measurement("code lengths", measure([&]() {
+        sink += build_minimum_redundancy_code(counts).max_length();
+    }, size, min_repetitions));
+    
+    print_measurement("length limit 12", measure([&]() {
+        sink += counts.number_of_characters() > 1 ?
+                build_length_limited_code(counts, 12).max_length() :
+                0;
+    }, size, min_repetitions));
+    
+    print_measurement("encode", measure([&]() {
+        sink += encoder.encode(table, input).length();
+    }, size, min_repetitions));
+    
+    print_measurement("serialize", measure([&]() {
+        sink += serializer.serialize(table, encoded_text).size();
+    }, size, min_repetitions));
+    
+    print_measurement("deserialize", measure([&]() {
+        sink += deserializer.deserialize(serialized).encoded_text.length();
+    }, size, min_repetitions));
+    
+    print_measurement("decode table", measure([&]() {
+        huffman_decode_table t(table);
+        size_t code_length;
+        sink += t.decode(0, code_length);
+    }, size, min_repetitions));
+    
+    print_measurement("decode", measure([&]() {
+        decoder.decode(decode_table,
+                       (const int8_t*) encoded_text.data(),
+                       encoded_text.length(),
+                       decoded.data(),
+                       size);
+        sink += decoded[size / 2];
+    }, size, min_repetitions));
+    
+    print_measurement("decode 4 streams", measure([&]() {
+        decoder.decode_interleaved(decode_table,
+                                   interleaved.data(),
+                                   numbers_of_bits,
+                                   decoded.data(),
+                                   size);
+        sink += decoded[size / 2];
+    }, size, min_repetitions));
+    
+    print_measurement("block compress", measure([&]() {
+        std::istringstream in(text);
+        std::ostringstream out;
+        compressor.compress(in, out);
+        sink += out.tellp();
+    }, size, min_repetitions));
+    
+    print_measurement("block decompress", measure([&]() {
+        std::istringstream in(compressed);
+        std::ostringstream out;
+        block_decompressor decompressor;
+        decompressor.decompress(in, out);
+        sink += out.tellp();
+    }, size, min_repetitions));
+}
+
+// Parses the value of the option 'flag' at 'argv[index + 1]':
+size_t parse_size(int argc, const char* argv[], int index)
+{
+    if (index + 1 == argc)
+    {
+        throw std::invalid_argument{std::string{"Missing value of "} +
+                                    argv[index]};
+    }
+    
+    char* end;
+    unsigned long long value = std::strtoull(argv[index + 1], &end, 10);
+    
+    if (*argv[index + 1] == '\0' || *end != '\0')
+    {
+        throw std::invalid_argument{std::string{"Bad value of "} +
+                                    argv[index]};
+    }
+    
+    return (size_t) value;
+}
+
+int main(int argc, const char* argv[])
+{
+    size_t min_size = MIN_INPUT_SIZE;
+    size_t max_size = MAX_INPUT_SIZE;
+    size_t min_repetitions = 5;
+    std::vector<std::string> distributions = {
+        "uniform", "zipf", "text", "single"
+    };
+    
+    try
+    {
+        for (int i = 1; i < argc; i += 2)
+        {
+            std::string flag = argv[i];
+            
+            if (flag == "--min-size")
+            {
+                min_size = std::max(parse_size(argc, argv, i), MIN_INPUT_SIZE);
+            }
+            else if (flag == "--max-size")
+            {
+                max_size = parse_size(argc, argv, i);
+            }
+            else if (flag == "--repetitions")
+            {
+                min_repetitions = std::max(parse_size(argc, argv, i),
+                                           (size_t) 1);
+            }
+            else if (flag == "--distribution" && i + 1 < argc)
+            {
+                distributions = { argv[i + 1] };
+            }
+            else
+            {
+                throw std::invalid_argument{"Unknown option: " + flag};
+            }
+        }
+        
+        for (const std::string& distribution : distributions)
+        {
+            // The sizes grow by a factor of 16 from 64 bytes to 1 GiB:
+            for (size_t size = min_size; size <= max_size; size *= 16)
+            {
+                cout << distribution << ", " << size << " bytes:" << endl;
+                benchmark_stages(generate_input(distribution, size),
+                                 min_repetitions);
+            }
+        }
+    }
+    catch (std::exception& err)
+    {
+        cerr << "Error: " << err.what() << endl;
+        return 1;
+    }
+    
+    return 0;
+}
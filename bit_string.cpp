@@ -1,5 +1,6 @@
 #include "bit_string.hpp"
 #include <climits>
+#include <cstring>
 #include <stdexcept>
 #include <sstream>
 #include <iostream>
@@ -11,6 +12,33 @@ bit_string::bit_string()
     size{0}
 {}
 
+bit_string::bit_string(std::vector<uint64_t>&& storage_longs,
+                       size_t number_of_bits)
+:
+    storage_longs{std::move(storage_longs)},
+    storage_capacity{this->storage_longs.size() * BITS_PER_UINT64},
+    size{number_of_bits}
+{
+    if (size > storage_capacity)
+    {
+        throw std::runtime_error{"Too few words for the number of bits."};
+    }
+}
+
+bit_string::bit_string(const int8_t* bytes, size_t number_of_bits)
+:
+    storage_longs(number_of_bits / BITS_PER_UINT64 + 1, 0),
+    storage_capacity{storage_longs.size() * BITS_PER_UINT64},
+    size{number_of_bits}
+{
+    size_t number_of_bytes = get_number_of_occupied_bytes();
+    
+    if (number_of_bytes != 0)
+    {
+        std::memcpy(storage_longs.data(), bytes, number_of_bytes);
+    }
+}
+
 bit_string::bit_string(const bit_string& to_copy)
 :
     size{to_copy.size},
@@ -18,6 +46,16 @@ bit_string::bit_string(const bit_string& to_copy)
     storage_capacity{to_copy.storage_capacity}
 {}
 
+bit_string::bit_string(bit_string&& other)
+:
+    storage_longs{std::move(other.storage_longs)},
+    storage_capacity{other.storage_capacity},
+    size{other.size}
+{
+    other.storage_capacity = 0;
+    other.size = 0;
+}
+
 bit_string& bit_string::operator=(bit_string &&other)
 {
     storage_longs = std::move(other.storage_longs);
@@ -76,16 +114,33 @@ size_t bit_string::get_number_of_occupied_bytes() const
 
 std::vector<int8_t> bit_string::to_byte_array() const
 {
+    std::vector<int8_t> ret;
+    append_bytes_to(ret);
+    return ret;
+}
+
+void bit_string::append_bytes_to(std::vector<int8_t>& byte_list) const
+{
+    // The words are stored little-endian, so their bytes are already in the
+    // stream order:
     size_t number_of_bytes = get_number_of_occupied_bytes();
-    std::vector<int8_t> ret(number_of_bytes);
+    size_t offset = byte_list.size();
+    byte_list.resize(offset + number_of_bytes);
     
-    for (size_t i = 0; i != number_of_bytes; ++i)
+    if (number_of_bytes != 0)
     {
-        ret[i] = (int8_t)((storage_longs[i / sizeof(uint64_t)]
-                           >> CHAR_BIT * (i % sizeof(uint64_t))));
+        std::memcpy(&byte_list[offset], storage_longs.data(), number_of_bytes);
     }
-    
-    return std::move(ret);
+}
+
+const uint64_t* bit_string::data() const
+{
+    return storage_longs.data();
+}
+
+size_t bit_string::number_of_words() const
+{
+    return storage_longs.size();
 }
 
 void bit_string::check_access_index(size_t index) const
@@ -19,6 +19,19 @@ public:
     **********************************/
     explicit bit_string();
     
+    /*************************************************************************
+    * Constructs a bit string holding the first 'number_of_bits' bits of the *
+    * 64-bit words 'storage_longs'.                                          *
+    *************************************************************************/
+    explicit bit_string(std::vector<uint64_t>&& storage_longs,
+                        size_t number_of_bits);
+    
+    /*************************************************************************
+    * Constructs a bit string holding the first 'number_of_bits' bits of the *
+    * bytes starting at 'bytes'. The lowest bit of each byte comes first.    *
+    *************************************************************************/
+    explicit bit_string(const int8_t* bytes, size_t number_of_bits);
+    
     /***********************************
     * Copy constructs this bit string. *
     ***********************************/
@@ -75,6 +88,24 @@ public:
     ***********************************************************************/
     std::vector<int8_t> to_byte_array() const;
     
+    /*************************************************************************
+    * Appends the bytes holding all the bits from this bit string to the end *
+    * of 'byte_list'.                                                        *
+    *************************************************************************/
+    void append_bytes_to(std::vector<int8_t>& byte_list) const;
+    
+    /*********************************************************************
+    * Returns a pointer to the 64-bit words storing the bits of this bit *
+    * string. The bit at index 'i' lives in the word 'i / 64' at the bit *
+    * position 'i % 64'. Used by the table-driven decoder.               *
+    *********************************************************************/
+    const uint64_t* data() const;
+    
+    /***********************************************************************
+    * Returns the number of 64-bit words currently allocated for the bits. *
+    ***********************************************************************/
+    size_t number_of_words() const;
+    
     /***************************************************************************
     * Used for printing the bits in the output stream. Note that for each long *
     * its bits are printed starting from the lowest bit, which implies that    *
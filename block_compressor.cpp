@@ -0,0 +1,1123 @@
+#include "adaptive_huffman_coder.hpp"
+#include "block_compressor.hpp"
+#include "byte_counts.hpp"
+#include "huffman_encoder.hpp"
+#include "huffman_serializer.hpp"
+#include "length_limited_code.hpp"
+#include "minimum_redundancy_code.hpp"
+#include "pipeline_statistics.hpp"
+#include "varint.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+const size_t block_compressor::MIN_MAX_CODE_LENGTH = 8;
+
+block_compressor::block_compressor(size_t block_size_log2,
+                                   size_t number_of_streams,
+                                   size_t max_code_length)
+:
+    block_size_log2{block_size_log2},
+    number_of_streams{number_of_streams},
+    max_code_length{max_code_length},
+    number_of_encoded_bits{0},
+    number_of_unlimited_bits{0},
+    statistics{nullptr},
+    dictionary{nullptr},
+    block_codec{codec::HUFFMAN},
+    lz77_level{lz77_matcher::DEFAULT_LEVEL}
+{
+    if (block_size_log2 < block_format::MIN_BLOCK_SIZE_LOG2 ||
+        block_size_log2 > block_format::MAX_BLOCK_SIZE_LOG2)
+    {
+        std::stringstream ss;
+        ss << "The block size must be between 2^"
+           << block_format::MIN_BLOCK_SIZE_LOG2
+           << " and 2^"
+           << block_format::MAX_BLOCK_SIZE_LOG2
+           << " bytes.";
+        throw std::runtime_error{ss.str()};
+    }
+    
+    if (number_of_streams != 1 &&
+        (number_of_streams < block_format::MIN_INTERLEAVED_STREAMS ||
+         number_of_streams > block_format::MAX_INTERLEAVED_STREAMS))
+    {
+        std::stringstream ss;
+        ss << "The number of streams must be 1 or between "
+           << block_format::MIN_INTERLEAVED_STREAMS
+           << " and "
+           << block_format::MAX_INTERLEAVED_STREAMS
+           << ".";
+        throw std::runtime_error{ss.str()};
+    }
+    
+    if (max_code_length < MIN_MAX_CODE_LENGTH ||
+        max_code_length > code_table::MAX_CODE_WORD_LENGTH)
+    {
+        std::stringstream ss;
+        ss << "The maximum code word length must be between "
+           << MIN_MAX_CODE_LENGTH
+           << " and "
+           << code_table::MAX_CODE_WORD_LENGTH
+           << ".";
+        throw std::runtime_error{ss.str()};
+    }
+}
+
+size_t block_compressor::get_block_size() const
+{
+    return (size_t) 1 << block_size_log2;
+}
+
+size_t block_compressor::get_number_of_streams() const
+{
+    return number_of_streams;
+}
+
+uint64_t block_compressor::get_number_of_encoded_bits() const
+{
+    return number_of_encoded_bits;
+}
+
+uint64_t block_compressor::get_number_of_unlimited_bits() const
+{
+    return number_of_unlimited_bits;
+}
+
+void block_compressor::set_statistics(pipeline_statistics* statistics)
+{
+    this->statistics = statistics;
+}
+
+void block_compressor::set_dictionary(const huffman_dictionary* dictionary)
+{
+    this->dictionary = dictionary;
+}
+
+void block_compressor::set_codec(codec block_codec)
+{
+    this->block_codec = block_codec;
+}
+
+void block_compressor::set_lz77_level(size_t level)
+{
+    // Let the matcher check the level:
+    lz77_matcher(level).get_level();
+    this->lz77_level = level;
+}
+
+void block_compressor::compress(std::istream& in, std::ostream& out)
+{
+    std::vector<int8_t> text(get_block_size());
+    std::vector<int8_t> output;
+    block_index index;
+    append_stream_header(output);
+    write_output(out, output);
+    output.clear();
+    
+    while (in)
+    {
+        size_t length = read_input(in, text.data(), text.size());
+        
+        if (length == 0)
+        {
+            break;
+        }
+        
+        compress_block(text.data(), length, output);
+        index.add_block(output.size(), length);
+        write_output(out, output);
+        output.clear();
+    }
+    
+    append_end_of_stream(index, output);
+    write_output(out, output);
+    
+    if (!out)
+    {
+        throw std::runtime_error{"Could not write the compressed stream."};
+    }
+}
+
+void block_compressor::compress(std::istream& in,
+                                std::ostream& out,
+                                thread_pool& pool)
+{
+    bool end_of_input = false;
+    
+    compress_blocks([this, &in, &end_of_input](pending_block& block) {
+        if (end_of_input)
+        {
+            return false;
+        }
+        
+        block.buffer.resize(get_block_size());
+        block.length = read_input(in, block.buffer.data(), block.buffer.size());
+        block.text = block.buffer.data();
+        end_of_input = block.length < block.buffer.size();
+        return block.length != 0;
+    }, out, pool);
+}
+
+void block_compressor::compress(const int8_t* text,
+                                size_t length,
+                                std::ostream& out)
+{
+    std::vector<int8_t> output;
+    block_index index;
+    append_stream_header(output);
+    write_output(out, output);
+    output.clear();
+    
+    if (statistics != nullptr)
+    {
+        statistics->add_uncompressed_bytes(length);
+    }
+    
+    for (size_t offset = 0; offset != length; )
+    {
+        size_t block_length = std::min(get_block_size(), length - offset);
+        compress_block(text + offset, block_length, output);
+        index.add_block(output.size(), block_length);
+        write_output(out, output);
+        output.clear();
+        offset += block_length;
+    }
+    
+    append_end_of_stream(index, output);
+    write_output(out, output);
+    
+    if (!out)
+    {
+        throw std::runtime_error{"Could not write the compressed stream."};
+    }
+}
+
+void block_compressor::compress(const int8_t* text,
+                                size_t length,
+                                std::ostream& out,
+                                thread_pool& pool)
+{
+    size_t offset = 0;
+    
+    if (statistics != nullptr)
+    {
+        statistics->add_uncompressed_bytes(length);
+    }
+    
+    compress_blocks([this, text, length, &offset](pending_block& block) {
+        block.text = text + offset;
+        block.length = std::min(get_block_size(), length - offset);
+        offset += block.length;
+        return block.length != 0;
+    }, out, pool);
+}
+
+size_t block_compressor::compress(const int8_t* text,
+                                  size_t length,
+                                  int8_t* output,
+                                  size_t capacity)
+{
+    scratch block_scratch;
+    return compress(text, length, output, capacity, block_scratch);
+}
+
+size_t block_compressor::compress(const int8_t* text,
+                                  size_t length,
+                                  int8_t* output,
+                                  size_t capacity,
+                                  scratch& block_scratch)
+{
+    std::vector<int8_t>& block = block_scratch.block;
+    block_index& index = block_scratch.index;
+    block.clear();
+    index.clear();
+    size_t output_size = 0;
+    append_stream_header(block);
+    copy_output(block, output, capacity, output_size);
+    
+    for (size_t offset = 0; offset != length; )
+    {
+        size_t block_length = std::min(get_block_size(), length - offset);
+        block.clear();
+        compress_block(text + offset, block_length, block, block_scratch);
+        index.add_block(block.size(), block_length);
+        copy_output(block, output, capacity, output_size);
+        offset += block_length;
+    }
+    
+    block.clear();
+    append_end_of_stream(index, block);
+    copy_output(block, output, capacity, output_size);
+    
+    if (statistics != nullptr)
+    {
+        statistics->add_uncompressed_bytes(length);
+        statistics->add_compressed_bytes(output_size);
+    }
+    
+    return output_size;
+}
+
+void block_compressor::copy_output(const std::vector<int8_t>& block,
+                                   int8_t* output,
+                                   size_t capacity,
+                                   size_t& output_size) const
+{
+    if (block.size() > capacity - output_size)
+    {
+        throw std::invalid_argument{"The output buffer is too small for the "
+                                    "compressed stream."};
+    }
+    
+    std::copy(block.begin(), block.end(), output + output_size);
+    output_size += block.size();
+}
+
+// Returns the most bytes a block of 'length' characters takes in the stream:
+static size_t max_block_bytes(size_t length)
+{
+    // The code takes at most 8 bits per character, since it is optimal and
+    // the 8-bit code is one of the candidates, so the payload exceeds the
+    // block size by at most the overhead:
+    size_t max_payload_length = length + block_format::MAX_PAYLOAD_OVERHEAD;
+    return 1 + varint_length(length)
+             + varint_length(max_payload_length)
+             + max_payload_length;
+}
+
+size_t block_compressor::compress_bound(size_t length) const
+{
+    size_t number_of_full_blocks = length / get_block_size();
+    size_t last_block_length = length % get_block_size();
+    size_t number_of_blocks = number_of_full_blocks
+                            + (last_block_length != 0);
+    
+    // Each block takes its bytes and an index entry:
+    size_t full_block_bound = max_block_bytes(get_block_size())
+                            + varint_length(max_block_bytes(get_block_size()))
+                            + varint_length(get_block_size());
+    size_t bound = block_format::STREAM_HEADER_SIZE
+                 + number_of_full_blocks * full_block_bound
+                 + 1
+                 + varint_length(number_of_blocks)
+                 + block_format::INDEX_FOOTER_SIZE;
+    
+    if (last_block_length != 0)
+    {
+        bound += max_block_bytes(last_block_length)
+               + varint_length(max_block_bytes(last_block_length))
+               + varint_length(last_block_length);
+    }
+    
+    return bound;
+}
+
+void block_compressor::compress_blocks(
+                const std::function<bool(pending_block&)>& next_block,
+                std::ostream& out,
+                thread_pool& pool)
+{
+    const size_t max_pending_blocks = 2 * pool.size();
+    std::deque<std::unique_ptr<pending_block>> pending_blocks;
+    bool end_of_input = false;
+    block_index index;
+    
+    std::vector<int8_t> header;
+    append_stream_header(header);
+    write_output(out, header);
+    
+    // Each worker reuses its own scratch, so no block allocates anew:
+    if (worker_scratch.size() < pool.size())
+    {
+        worker_scratch.resize(pool.size());
+    }
+    
+    try
+    {
+        while (true)
+        {
+            // Keep the pool busy with the blocks following the oldest one:
+            while (!end_of_input && pending_blocks.size() < max_pending_blocks)
+            {
+                std::unique_ptr<pending_block> block(new pending_block);
+                
+                if (!next_block(*block))
+                {
+                    end_of_input = true;
+                    break;
+                }
+                
+                pending_block* p = block.get();
+                p->done = pool.submit([this, p]() {
+                    compress_block(
+                        p->text,
+                        p->length,
+                        p->output,
+                        worker_scratch[thread_pool::get_worker_index()]);
+                });
+                
+                pending_blocks.push_back(std::move(block));
+            }
+            
+            if (pending_blocks.empty())
+            {
+                break;
+            }
+            
+            // Emit the blocks in the input order:
+            pending_block& oldest = *pending_blocks.front();
+            oldest.done.get();
+            write_output(out, oldest.output);
+            index.add_block(oldest.output.size(), oldest.length);
+            pending_blocks.pop_front();
+        }
+    }
+    catch (...)
+    {
+        // Do not free the buffers the workers may still be using:
+        for (std::unique_ptr<pending_block>& block : pending_blocks)
+        {
+            if (block->done.valid())
+            {
+                block->done.wait();
+            }
+        }
+        
+        throw;
+    }
+    
+    std::vector<int8_t> trailer;
+    append_end_of_stream(index, trailer);
+    write_output(out, trailer);
+    
+    if (!out)
+    {
+        throw std::runtime_error{"Could not write the compressed stream."};
+    }
+}
+
+size_t block_compressor::read_input(std::istream& in,
+                                    int8_t* text,
+                                    size_t length) const
+{
+    pipeline_statistics::stage_timer timer(statistics,
+                                           pipeline_statistics::READ,
+                                           0);
+    in.read((char*) text, length);
+    size_t number_of_bytes = (size_t) in.gcount();
+    timer.set_number_of_bytes(number_of_bytes);
+    
+    if (statistics != nullptr)
+    {
+        statistics->add_uncompressed_bytes(number_of_bytes);
+    }
+    
+    return number_of_bytes;
+}
+
+void block_compressor::write_output(std::ostream& out,
+                                    const std::vector<int8_t>& output) const
+{
+    pipeline_statistics::stage_timer timer(statistics,
+                                           pipeline_statistics::WRITE,
+                                           output.size());
+    out.write((const char*) output.data(), output.size());
+    
+    if (statistics != nullptr)
+    {
+        statistics->add_compressed_bytes(output.size());
+    }
+}
+
+void block_compressor::append_stream_header(std::vector<int8_t>& output) const
+{
+    for (int8_t magic_byte : block_format::MAGIC)
+    {
+        output.push_back(magic_byte);
+    }
+    
+    output.push_back((int8_t) block_size_log2);
+    
+    output.push_back((int8_t) block_format::HAS_BLOCK_INDEX);
+}
+
+void block_compressor::compress_block(const int8_t* text,
+                                      size_t length,
+                                      std::vector<int8_t>& output) const
+{
+    scratch block_scratch;
+    compress_block(text, length, output, block_scratch);
+}
+
+void block_compressor::compress_block(const int8_t* text,
+                                      size_t length,
+                                      std::vector<int8_t>& output,
+                                      scratch& block_scratch) const
+{
+    if (length == 0 || length > get_block_size())
+    {
+        throw std::runtime_error{"Bad block length."};
+    }
+    
+    histogram counts;
+    
+    {
+        pipeline_statistics::stage_timer timer(statistics,
+                                               pipeline_statistics::COUNT,
+                                               length);
+        counts = compute_byte_histogram(text, length);
+    }
+    
+    // A block of a single repeated character needs nothing but the character:
+    if (counts.get_count(text[0]) == length)
+    {
+        append_run_block(text, length, counts, output);
+        return;
+    }
+    
+    if (block_codec == codec::ADAPTIVE_HUFFMAN &&
+        compress_adaptive_block(text, length, counts, output, block_scratch))
+    {
+        return;
+    }
+    
+    if (block_codec == codec::CONTEXT_HUFFMAN &&
+        compress_context_block(text, length, counts, output, block_scratch))
+    {
+        return;
+    }
+    
+    if (block_codec == codec::LZ77_HUFFMAN &&
+        compress_lz77_block(text, length, counts, output, block_scratch))
+    {
+        return;
+    }
+    
+    // Code the block with the dictionary unless the text is so unlike the
+    // samples that it would expand, which also keeps the payload bounded:
+    const huffman_dictionary* block_dictionary = nullptr;
+    uint64_t unlimited_bits;
+    uint64_t encoded_bits;
+    
+    if (dictionary != nullptr)
+    {
+        encoded_bits = compute_encoded_length(counts,
+                                              dictionary->get_code_table());
+        unlimited_bits = encoded_bits;
+        
+        if (encoded_bits <= (uint64_t) CHAR_BIT * length)
+        {
+            block_dictionary = dictionary;
+        }
+    }
+    
+    code_table block_table;
+    const code_table& table = block_dictionary == nullptr
+                            ? block_table
+                            : block_dictionary->get_code_table();
+    
+    if (block_dictionary == nullptr)
+    {
+        pipeline_statistics::stage_timer timer(statistics,
+                                               pipeline_statistics::BUILD_CODE,
+                                               length);
+        block_table = build_code(counts, unlimited_bits, encoded_bits);
+    }
+    
+    // The payload bytes preceding the numbers of bits show together with the
+    // number of the encoded bits whether coding pays off before a single
+    // character is encoded:
+    std::vector<int8_t>& payload_header = block_scratch.payload_header;
+    payload_header.clear();
+    block_format::block_type type = block_format::HUFFMAN_BLOCK;
+    
+    {
+        // The bytes of the block are counted once the block is written:
+        pipeline_statistics::stage_timer timer(statistics,
+                                               pipeline_statistics::SERIALIZE,
+                                               0);
+        
+        if (block_dictionary != nullptr)
+        {
+            // The dictionary replaces the code word lengths:
+            uint32_t id = block_dictionary->get_id();
+            type = block_format::DICTIONARY_HUFFMAN_BLOCK;
+            
+            for (size_t i = 0; i != 4; ++i)
+            {
+                payload_header.push_back((int8_t)(id >> (8 * i)));
+            }
+            
+            payload_header.push_back((int8_t) number_of_streams);
+        }
+        else
+        {
+            huffman_serializer serializer;
+            serializer.append_code_table(table, payload_header);
+            
+            if (number_of_streams != 1)
+            {
+                type = block_format::INTERLEAVED_HUFFMAN_BLOCK;
+                payload_header.push_back((int8_t) number_of_streams);
+            }
+        }
+    }
+    
+    if (payload_header.size() + encoded_bits / CHAR_BIT >= length)
+    {
+        append_stored_block(text, length, counts, output);
+        return;
+    }
+    
+    // The streams are encoded into the words kept from the previous blocks:
+    std::vector<std::vector<uint64_t>>& stream_words =
+        block_scratch.stream_words;
+    size_t numbers_of_bits[block_format::MAX_INTERLEAVED_STREAMS];
+    
+    if (stream_words.size() < number_of_streams)
+    {
+        stream_words.resize(number_of_streams);
+    }
+    
+    {
+        pipeline_statistics::stage_timer timer(statistics,
+                                               pipeline_statistics::ENCODE,
+                                               length);
+        huffman_encoder encoder;
+        
+        for (size_t stream = 0; stream != number_of_streams; ++stream)
+        {
+            size_t stream_length = length > stream ? length - stream : 0;
+            numbers_of_bits[stream] =
+                encoder.encode_words(table,
+                                     text + stream,
+                                     stream_length,
+                                     number_of_streams,
+                                     stream_words[stream]);
+        }
+    }
+    
+    add_block_statistics(counts, unlimited_bits, encoded_bits);
+    
+    pipeline_statistics::stage_timer timer(statistics,
+                                           pipeline_statistics::SERIALIZE,
+                                           length);
+    size_t payload_length = 0;
+    
+    for (size_t stream = 0; stream != number_of_streams; ++stream)
+    {
+        append_varint(numbers_of_bits[stream], payload_header);
+        payload_length += (numbers_of_bits[stream] + CHAR_BIT - 1) / CHAR_BIT;
+    }
+    
+    payload_length += payload_header.size();
+    
+    output.push_back((int8_t) type);
+    append_varint(length, output);
+    append_varint(payload_length, output);
+    output.insert(output.end(), payload_header.begin(), payload_header.end());
+    
+    // The words are stored little-endian, so their bytes are already in the
+    // stream order:
+    for (size_t stream = 0; stream != number_of_streams; ++stream)
+    {
+        size_t number_of_bytes = (numbers_of_bits[stream] + CHAR_BIT - 1)
+                               / CHAR_BIT;
+        size_t offset = output.size();
+        output.resize(offset + number_of_bytes);
+        
+        if (number_of_bytes != 0)
+        {
+            std::memcpy(&output[offset],
+                        stream_words[stream].data(),
+                        number_of_bytes);
+        }
+    }
+}
+
+bool block_compressor::compress_context_block(
+                                        const int8_t* text,
+                                        size_t length,
+                                        const histogram& counts,
+                                        std::vector<int8_t>& output,
+                                        scratch& block_scratch) const
+{
+    context_model& model = block_scratch.model;
+    
+    {
+        pipeline_statistics::stage_timer timer(statistics,
+                                               pipeline_statistics::COUNT,
+                                               length);
+        model.count(text, length);
+    }
+    
+    std::vector<code_table>& tables = block_scratch.context_tables;
+    uint64_t unlimited_bits = 0;
+    uint64_t encoded_bits = 0;
+    
+    {
+        pipeline_statistics::stage_timer timer(statistics,
+                                               pipeline_statistics::BUILD_CODE,
+                                               length);
+        model.cluster(block_format::MAX_CONTEXT_TABLES);
+        
+        if (model.get_number_of_tables() == 1)
+        {
+            return false;
+        }
+        
+        tables.resize(model.get_number_of_tables());
+        
+        for (size_t table = 0; table != tables.size(); ++table)
+        {
+            uint64_t table_unlimited_bits;
+            uint64_t table_encoded_bits;
+            tables[table] = build_code(model.get_table_counts(table),
+                                       table_unlimited_bits,
+                                       table_encoded_bits);
+            unlimited_bits += table_unlimited_bits;
+            encoded_bits += table_encoded_bits;
+        }
+    }
+    
+    std::vector<int8_t>& payload_header = block_scratch.payload_header;
+    size_t single_table_length =
+        estimate_single_table_length(counts, payload_header);
+    
+    {
+        pipeline_statistics::stage_timer timer(statistics,
+                                               pipeline_statistics::SERIALIZE,
+                                               0);
+        huffman_serializer serializer;
+        payload_header.clear();
+        payload_header.push_back((int8_t) tables.size());
+        const uint8_t* context_map = model.get_context_map();
+        
+        for (size_t context = 0;
+             context != context_model::NUMBER_OF_CONTEXTS; )
+        {
+            size_t run_length = 1;
+            
+            while (context + run_length != context_model::NUMBER_OF_CONTEXTS &&
+                   context_map[context + run_length] == context_map[context])
+            {
+                ++run_length;
+            }
+            
+            payload_header.push_back((int8_t) context_map[context]);
+            append_varint(run_length, payload_header);
+            context += run_length;
+        }
+        
+        for (const code_table& table : tables)
+        {
+            serializer.append_code_table(table, payload_header);
+        }
+    }
+    
+    // The tables must pay for themselves, which also keeps the payload
+    // shorter than the text:
+    if (payload_header.size() + encoded_bits / CHAR_BIT >=
+        std::min(single_table_length, length))
+    {
+        return false;
+    }
+    
+    std::vector<std::vector<uint64_t>>& stream_words =
+        block_scratch.stream_words;
+    
+    if (stream_words.empty())
+    {
+        stream_words.resize(1);
+    }
+    
+    size_t number_of_bits;
+    
+    {
+        pipeline_statistics::stage_timer timer(statistics,
+                                               pipeline_statistics::ENCODE,
+                                               length);
+        huffman_encoder encoder;
+        number_of_bits =
+            encoder.encode_words_with_contexts(tables.data(),
+                                               model.get_context_map(),
+                                               text,
+                                               length,
+                                               stream_words[0]);
+    }
+    
+    add_block_statistics(counts, unlimited_bits, encoded_bits);
+    
+    pipeline_statistics::stage_timer timer(statistics,
+                                           pipeline_statistics::SERIALIZE,
+                                           length);
+    size_t number_of_bytes = (number_of_bits + CHAR_BIT - 1) / CHAR_BIT;
+    append_varint(number_of_bits, payload_header);
+    output.push_back((int8_t) block_format::CONTEXT_HUFFMAN_BLOCK);
+    append_varint(length, output);
+    append_varint(payload_header.size() + number_of_bytes, output);
+    output.insert(output.end(), payload_header.begin(), payload_header.end());
+    size_t offset = output.size();
+    output.resize(offset + number_of_bytes);
+    
+    if (number_of_bytes != 0)
+    {
+        std::memcpy(&output[offset], stream_words[0].data(), number_of_bytes);
+    }
+    
+    return true;
+}
+
+bool block_compressor::compress_lz77_block(const int8_t* text,
+                                           size_t length,
+                                           const histogram& counts,
+                                           std::vector<int8_t>& output,
+                                           scratch& block_scratch) const
+{
+    std::vector<lz77_sequence>& sequences = block_scratch.sequences;
+    
+    {
+        pipeline_statistics::stage_timer timer(statistics,
+                                               pipeline_statistics::MATCH,
+                                               length);
+        block_scratch.matcher.set_level(lz77_level);
+        block_scratch.matcher.parse(text, length, sequences);
+    }
+    
+    // Split the sequences into the literals, the codes and the extra bits
+    // of the codes:
+    std::vector<int8_t>& literals = block_scratch.literals;
+    std::vector<int8_t>& codes = block_scratch.codes;
+    std::vector<std::vector<uint64_t>>& stream_words =
+        block_scratch.stream_words;
+    literals.clear();
+    codes.clear();
+    
+    if (stream_words.size() < 3)
+    {
+        stream_words.resize(3);
+    }
+    
+    std::vector<uint64_t>& extra_words = stream_words[2];
+    extra_words.clear();
+    uint64_t accumulator = 0;
+    size_t number_of_extra_bits = 0;
+    
+    auto append_code = [&](uint8_t first_code, uint32_t value) {
+        uint32_t extra_bits;
+        size_t number_of_bits;
+        uint8_t code = lz77_value_code(value, extra_bits, number_of_bits);
+        codes.push_back((int8_t)(first_code + code));
+        
+        for (size_t bit = 0; bit != number_of_bits; ++bit)
+        {
+            accumulator |= (uint64_t)((extra_bits >> bit) & 1)
+                        << (number_of_extra_bits % 64);
+            
+            if (++number_of_extra_bits % 64 == 0)
+            {
+                extra_words.push_back(accumulator);
+                accumulator = 0;
+            }
+        }
+    };
+    
+    {
+        pipeline_statistics::stage_timer timer(statistics,
+                                               pipeline_statistics::MATCH,
+                                               length);
+        size_t position = 0;
+        
+        for (const lz77_sequence& sequence : sequences)
+        {
+            literals.insert(literals.end(),
+                            text + position,
+                            text + position + sequence.literal_length);
+            append_code(LZ77_LITERAL_LENGTH_CODES, sequence.literal_length);
+            position += sequence.literal_length;
+            
+            if (sequence.match_length != 0)
+            {
+                append_code(LZ77_MATCH_LENGTH_CODES,
+                            sequence.match_length
+                            - (uint32_t) lz77_matcher::MIN_MATCH_LENGTH);
+                append_code(LZ77_DISTANCE_CODES, sequence.distance - 1);
+                position += sequence.match_length;
+            }
+        }
+        
+        if (number_of_extra_bits % 64 != 0)
+        {
+            extra_words.push_back(accumulator);
+        }
+    }
+    
+    histogram literal_counts;
+    histogram code_counts;
+    
+    {
+        pipeline_statistics::stage_timer timer(statistics,
+                                               pipeline_statistics::COUNT,
+                                               length);
+        literal_counts = compute_byte_histogram(literals.data(),
+                                                literals.size());
+        code_counts = compute_byte_histogram(codes.data(), codes.size());
+    }
+    
+    code_table literal_table;
+    code_table codes_table;
+    uint64_t unlimited_bits = number_of_extra_bits;
+    uint64_t encoded_bits = number_of_extra_bits;
+    uint64_t literal_bits = 0;
+    uint64_t code_bits;
+    
+    {
+        pipeline_statistics::stage_timer timer(statistics,
+                                               pipeline_statistics::BUILD_CODE,
+                                               length);
+        uint64_t table_unlimited_bits = 0;
+        
+        if (!literals.empty())
+        {
+            literal_table = build_code(literal_counts,
+                                       table_unlimited_bits,
+                                       literal_bits);
+        }
+        
+        unlimited_bits += table_unlimited_bits;
+        codes_table = build_code(code_counts, table_unlimited_bits, code_bits);
+        unlimited_bits += table_unlimited_bits;
+        encoded_bits += literal_bits + code_bits;
+    }
+    
+    std::vector<int8_t>& payload_header = block_scratch.payload_header;
+    size_t single_table_length =
+        estimate_single_table_length(counts, payload_header);
+    
+    {
+        pipeline_statistics::stage_timer timer(statistics,
+                                               pipeline_statistics::SERIALIZE,
+                                               0);
+        huffman_serializer serializer;
+        payload_header.clear();
+        append_varint(literals.size(), payload_header);
+        append_varint(codes.size(), payload_header);
+        
+        if (!literals.empty())
+        {
+            serializer.append_code_table(literal_table, payload_header);
+        }
+        
+        serializer.append_code_table(codes_table, payload_header);
+    }
+    
+    // The matches must pay for the second table, which also keeps the
+    // payload shorter than the text:
+    if (payload_header.size() + encoded_bits / CHAR_BIT >=
+        std::min(single_table_length, length))
+    {
+        return false;
+    }
+    
+    {
+        pipeline_statistics::stage_timer timer(statistics,
+                                               pipeline_statistics::ENCODE,
+                                               length);
+        huffman_encoder encoder;
+        encoder.encode_words(literal_table,
+                             literals.data(),
+                             literals.size(),
+                             1,
+                             stream_words[0]);
+        encoder.encode_words(codes_table,
+                             codes.data(),
+                             codes.size(),
+                             1,
+                             stream_words[1]);
+    }
+    
+    add_block_statistics(counts, unlimited_bits, encoded_bits);
+    
+    pipeline_statistics::stage_timer timer(statistics,
+                                           pipeline_statistics::SERIALIZE,
+                                           length);
+    const uint64_t numbers_of_bits[] = { literal_bits,
+                                         code_bits,
+                                         number_of_extra_bits };
+    size_t payload_length = payload_header.size();
+    
+    for (uint64_t number_of_bits : numbers_of_bits)
+    {
+        append_varint(number_of_bits, payload_header);
+        payload_length += varint_length(number_of_bits)
+                        + (number_of_bits + CHAR_BIT - 1) / CHAR_BIT;
+    }
+    
+    output.push_back((int8_t) block_format::LZ77_HUFFMAN_BLOCK);
+    append_varint(length, output);
+    append_varint(payload_length, output);
+    output.insert(output.end(), payload_header.begin(), payload_header.end());
+    
+    for (size_t stream = 0; stream != 3; ++stream)
+    {
+        size_t number_of_bytes = (numbers_of_bits[stream] + CHAR_BIT - 1)
+                               / CHAR_BIT;
+        size_t offset = output.size();
+        output.resize(offset + number_of_bytes);
+        
+        if (number_of_bytes != 0)
+        {
+            std::memcpy(&output[offset],
+                        stream_words[stream].data(),
+                        number_of_bytes);
+        }
+    }
+    
+    return true;
+}
+
+size_t block_compressor::estimate_single_table_length(
+                                        const histogram& counts,
+                                        std::vector<int8_t>& buffer) const
+{
+    uint64_t unlimited_bits;
+    uint64_t encoded_bits;
+    code_table table = build_code(counts, unlimited_bits, encoded_bits);
+    huffman_serializer serializer;
+    buffer.clear();
+    serializer.append_code_table(table, buffer);
+    return buffer.size() + encoded_bits / CHAR_BIT;
+}
+
+code_table block_compressor::build_code(const histogram& counts,
+                                        uint64_t& unlimited_bits,
+                                        uint64_t& encoded_bits) const
+{
+    code_table table = build_minimum_redundancy_code(counts);
+    unlimited_bits = compute_encoded_length(counts, table);
+    encoded_bits = unlimited_bits;
+    
+    if (table.max_length() > max_code_length)
+    {
+        table = build_length_limited_code(counts, max_code_length);
+        encoded_bits = compute_encoded_length(counts, table);
+    }
+    
+    return table;
+}
+
+void block_compressor::append_stored_block(const int8_t* text,
+                                           size_t length,
+                                           const histogram& counts,
+                                           std::vector<int8_t>& output) const
+{
+    uint64_t number_of_bits = (uint64_t) CHAR_BIT * length;
+    add_block_statistics(counts, number_of_bits, number_of_bits);
+    
+    pipeline_statistics::stage_timer timer(statistics,
+                                           pipeline_statistics::SERIALIZE,
+                                           length);
+    output.push_back((int8_t) block_format::STORED_BLOCK);
+    append_varint(length, output);
+    append_varint(length, output);
+    output.insert(output.end(), text, text + length);
+}
+
+void block_compressor::append_run_block(const int8_t* text,
+                                        size_t length,
+                                        const histogram& counts,
+                                        std::vector<int8_t>& output) const
+{
+    add_block_statistics(counts, CHAR_BIT, CHAR_BIT);
+    
+    pipeline_statistics::stage_timer timer(statistics,
+                                           pipeline_statistics::SERIALIZE,
+                                           length);
+    output.push_back((int8_t) block_format::RUN_BLOCK);
+    append_varint(length, output);
+    append_varint(1, output);
+    output.push_back(text[0]);
+}
+
+void block_compressor::add_block_statistics(const histogram& counts,
+                                            uint64_t unlimited_bits,
+                                            uint64_t encoded_bits) const
+{
+    number_of_unlimited_bits += unlimited_bits;
+    number_of_encoded_bits += encoded_bits;
+    
+    if (statistics != nullptr)
+    {
+        statistics->add_counts(counts);
+        statistics->add_encoded_bits(encoded_bits);
+    }
+}
+
+bool block_compressor::compress_adaptive_block(
+                                        const int8_t* text,
+                                        size_t length,
+                                        const histogram& counts,
+                                        std::vector<int8_t>& output,
+                                        scratch& block_scratch) const
+{
+    std::vector<std::vector<uint64_t>>& stream_words =
+        block_scratch.stream_words;
+    
+    if (stream_words.empty())
+    {
+        stream_words.resize(1);
+    }
+    
+    size_t number_of_bits;
+    
+    {
+        pipeline_statistics::stage_timer timer(statistics,
+                                               pipeline_statistics::ENCODE,
+                                               length);
+        adaptive_huffman_coder coder;
+        number_of_bits = coder.encode(text, length, stream_words[0]);
+    }
+    
+    // Leave the block that does not pay for its header to the Huffman
+    // path, which stores it if nothing else does:
+    size_t number_of_bytes = (number_of_bits + CHAR_BIT - 1) / CHAR_BIT;
+    size_t payload_length = varint_length(number_of_bits) + number_of_bytes;
+    
+    if (payload_length >= length)
+    {
+        return false;
+    }
+    
+    add_block_statistics(counts, number_of_bits, number_of_bits);
+    
+    pipeline_statistics::stage_timer timer(statistics,
+                                           pipeline_statistics::SERIALIZE,
+                                           length);
+    output.push_back((int8_t) block_format::ADAPTIVE_HUFFMAN_BLOCK);
+    append_varint(length, output);
+    append_varint(payload_length, output);
+    append_varint(number_of_bits, output);
+    size_t offset = output.size();
+    output.resize(offset + number_of_bytes);
+    
+    if (number_of_bytes != 0)
+    {
+        std::memcpy(&output[offset], stream_words[0].data(), number_of_bytes);
+    }
+    
+    return true;
+}
+
+void block_compressor::append_end_of_stream(const block_index& index,
+                                            std::vector<int8_t>& output) const
+{
+    output.push_back((int8_t) block_format::END_OF_STREAM);
+    index.append_trailer(output);
+}
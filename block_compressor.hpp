@@ -0,0 +1,336 @@
+#ifndef BLOCK_COMPRESSOR_HPP
+#define BLOCK_COMPRESSOR_HPP
+
+#include "block_format.hpp"
+#include "block_index.hpp"
+#include "code_table.hpp"
+#include "context_model.hpp"
+#include "histogram.hpp"
+#include "lz77.hpp"
+#include "huffman_dictionary.hpp"
+#include "pipeline_statistics.hpp"
+#include "thread_pool.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+class block_compressor {
+public:
+    
+    // The memory a single thread reuses from block to block and from call to
+    // call:
+    struct scratch {
+        
+        // The words of each encoded stream:
+        std::vector<std::vector<uint64_t>> stream_words;
+        
+        // The payload bytes preceding the streams:
+        std::vector<int8_t> payload_header;
+        
+        // The block being compressed and the index of the stream:
+        std::vector<int8_t> block;
+        block_index index;
+        
+        // The order-1 statistics and the code tables of a context block:
+        context_model model;
+        std::vector<code_table> context_tables;
+        
+        // The match finder and the parts of an LZ77 block:
+        lz77_matcher matcher;
+        std::vector<lz77_sequence> sequences;
+        std::vector<int8_t> literals;
+        std::vector<int8_t> codes;
+    };
+    
+    // The entropy coders a block can be compressed with:
+    enum class codec {
+        
+        // The Huffman code of the block character counts or the dictionary:
+        HUFFMAN,
+        
+        // The adaptive Huffman code, which codes the block in a single pass
+        // without storing a code table:
+        ADAPTIVE_HUFFMAN,
+        
+        // A few Huffman codes, each coding the characters following the
+        // characters of a cluster of similar contexts:
+        CONTEXT_HUFFMAN,
+        
+        // The LZ77 matches and the literals coded with Huffman codes:
+        LZ77_HUFFMAN
+    };
+    
+    // The smallest code word length limit that fits all the characters:
+    static const size_t MIN_MAX_CODE_LENGTH;
+    
+    /************************************************************************
+    * Constructs a compressor cutting the input into blocks of              *
+    * '2^block_size_log2' bytes. Each block is coded as 'number_of_streams' *
+    * interleaved streams unless 'number_of_streams' is 1. No code word is  *
+    * longer than 'max_code_length' bits.                                   *
+    ************************************************************************/
+    explicit block_compressor(
+                size_t block_size_log2 = block_format::DEFAULT_BLOCK_SIZE_LOG2,
+                size_t number_of_streams = 1,
+                size_t max_code_length = code_table::MAX_CODE_WORD_LENGTH);
+    
+    /**************************************************************************
+    * Compresses the whole 'in' into 'out' holding at most one block of input *
+    * and one block of output in memory at a time.                            *
+    **************************************************************************/
+    void compress(std::istream& in, std::ostream& out);
+    
+    /************************************************************************
+    * Compresses the whole 'in' into 'out' compressing the blocks on the    *
+    * threads of 'pool'. The output is identical to the one of the          *
+    * single-threaded 'compress'. At most two blocks per thread are held in *
+    * memory at a time.                                                     *
+    ************************************************************************/
+    void compress(std::istream& in, std::ostream& out, thread_pool& pool);
+    
+    /**************************************************************************
+    * Compresses the 'length' bytes starting at 'text' into 'out'. The blocks *
+    * are coded straight from 'text', which may be a memory-mapped file, so   *
+    * no input is copied.                                                     *
+    **************************************************************************/
+    void compress(const int8_t* text, size_t length, std::ostream& out);
+    
+    /**************************************************************************
+    * Compresses the 'length' bytes starting at 'text' into 'out' compressing *
+    * the blocks on the threads of 'pool'. The output is identical to the one *
+    * of the single-threaded 'compress'.                                      *
+    **************************************************************************/
+    void compress(const int8_t* text,
+                  size_t length,
+                  std::ostream& out,
+                  thread_pool& pool);
+    
+    /*************************************************************************
+    * Compresses the 'length' bytes starting at 'text' into the caller-owned *
+    * buffer of 'capacity' bytes at 'output' and returns the length of the   *
+    * stream. No buffer of the size of the input or the output is allocated. *
+    * Throws 'std::invalid_argument' if the stream does not fit, which never *
+    * happens when 'capacity' is at least 'compress_bound(length)'.          *
+    *************************************************************************/
+    size_t compress(const int8_t* text,
+                    size_t length,
+                    int8_t* output,
+                    size_t capacity);
+    
+    /************************************************************************
+    * Does the same reusing the memory in 'block_scratch', so that repeated *
+    * calls stop allocating once the scratch has grown to their sizes.      *
+    ************************************************************************/
+    size_t compress(const int8_t* text,
+                    size_t length,
+                    int8_t* output,
+                    size_t capacity,
+                    scratch& block_scratch);
+    
+    /**********************************************************************
+    * Returns the maximum length of the stream compressing 'length' bytes *
+    * produces.                                                           *
+    **********************************************************************/
+    size_t compress_bound(size_t length) const;
+    
+    /*****************************************
+    * Appends the stream header to 'output'. *
+    *****************************************/
+    void append_stream_header(std::vector<int8_t>& output) const;
+    
+    /*************************************************************************
+    * Compresses the 'length' bytes starting at 'text' into a block appended *
+    * to 'output'. 'length' must not exceed the block size.                  *
+    *************************************************************************/
+    void compress_block(const int8_t* text,
+                        size_t length,
+                        std::vector<int8_t>& output) const;
+    
+    /*******************************************************
+    * Does the same reusing the memory in 'block_scratch'. *
+    *******************************************************/
+    void compress_block(const int8_t* text,
+                        size_t length,
+                        std::vector<int8_t>& output,
+                        scratch& block_scratch) const;
+    
+    /*******************************************************************
+    * Appends the end of stream block followed by the block 'index' to *
+    * 'output'.                                                        *
+    *******************************************************************/
+    void append_end_of_stream(const block_index& index,
+                              std::vector<int8_t>& output) const;
+    
+    /**************************************************
+    * Returns the maximum number of bytes in a block. *
+    **************************************************/
+    size_t get_block_size() const;
+    
+    /***********************************************************
+    * Returns the number of the interleaved streams per block. *
+    ***********************************************************/
+    size_t get_number_of_streams() const;
+    
+    /***************************************************************************
+    * Returns the number of the encoded text bits of all the blocks compressed *
+    * so far.                                                                  *
+    ***************************************************************************/
+    uint64_t get_number_of_encoded_bits() const;
+    
+    /***************************************************************************
+    * Returns the number of the encoded text bits the blocks compressed so far *
+    * would take without the code word length limit.                           *
+    ***************************************************************************/
+    uint64_t get_number_of_unlimited_bits() const;
+    
+    /**********************************************************************
+    * Makes the compressor add its stage times and sizes to 'statistics'. *
+    * Passing null stops the collection.                                  *
+    **********************************************************************/
+    void set_statistics(pipeline_statistics* statistics);
+    
+    /**************************************************************************
+    * Makes the compressor code all the blocks with 'dictionary' instead of   *
+    * the code tables of their own. Passing null goes back to the own tables. *
+    * The dictionary must outlive the compression.                            *
+    **************************************************************************/
+    void set_dictionary(const huffman_dictionary* dictionary);
+    
+    /*************************************************************************
+    * Makes the compressor code the blocks with 'block_codec'. The adaptive  *
+    * and the context codes ignore the number of streams and the dictionary. *
+    * A block they would not code better is coded with the Huffman code.     *
+    *************************************************************************/
+    void set_codec(codec block_codec);
+    
+    /*****************************************************************
+    * Sets the effort level of the LZ77 match finder, from           *
+    * 'lz77_matcher::MIN_LEVEL' to 'lz77_matcher::MAX_LEVEL'. Throws *
+    * 'std::runtime_error' if the level is out of range.             *
+    *****************************************************************/
+    void set_lz77_level(size_t level);
+    
+private:
+    
+    // A block queued for the pool. 'text' points either into the input or
+    // into the 'buffer' the block was read into:
+    struct pending_block {
+        std::vector<int8_t> buffer;
+        const int8_t* text;
+        size_t length;
+        std::vector<int8_t> output;
+        std::future<void> done;
+    };
+    
+    // The base two logarithm of the block size:
+    size_t block_size_log2;
+    
+    // The number of the interleaved streams per block:
+    size_t number_of_streams;
+    
+    // The maximum length of a code word:
+    size_t max_code_length;
+    
+    // The totals behind the cost of the code word length limit, updated by
+    // the concurrent 'compress_block' calls:
+    mutable std::atomic<uint64_t> number_of_encoded_bits;
+    mutable std::atomic<uint64_t> number_of_unlimited_bits;
+    
+    // Where to report the stage times, or null:
+    pipeline_statistics* statistics;
+    
+    // The shared code table, or null:
+    const huffman_dictionary* dictionary;
+    
+    // The coder of the blocks:
+    codec block_codec;
+    
+    // The effort level of the match finder:
+    size_t lz77_level;
+    
+    // The scratch of each worker of the pool compressing the blocks, kept
+    // from call to call:
+    std::vector<scratch> worker_scratch;
+    
+    // Reads up to 'length' bytes of input timing the read:
+    size_t read_input(std::istream& in, int8_t* text, size_t length) const;
+    
+    // Writes the 'output' timing the write:
+    void write_output(std::ostream& out,
+                      const std::vector<int8_t>& output) const;
+    
+    // Appends the 'block' to the 'output_size' bytes of the 'capacity' byte
+    // 'output':
+    void copy_output(const std::vector<int8_t>& block,
+                     int8_t* output,
+                     size_t capacity,
+                     size_t& output_size) const;
+    
+    // Appends the block of the character 'counts' coded with the adaptive
+    // code to 'output' unless its payload would be no shorter than the text,
+    // in which case returns false:
+    bool compress_adaptive_block(const int8_t* text,
+                                 size_t length,
+                                 const histogram& counts,
+                                 std::vector<int8_t>& output,
+                                 scratch& block_scratch) const;
+    
+    // Appends the block coded with the context tables to 'output' unless
+    // they would not beat the single code table, in which case returns
+    // false:
+    bool compress_context_block(const int8_t* text,
+                                size_t length,
+                                const histogram& counts,
+                                std::vector<int8_t>& output,
+                                scratch& block_scratch) const;
+    
+    // Appends the block coded with LZ77 to 'output' unless it would not
+    // beat the single code table, in which case returns false:
+    bool compress_lz77_block(const int8_t* text,
+                             size_t length,
+                             const histogram& counts,
+                             std::vector<int8_t>& output,
+                             scratch& block_scratch) const;
+    
+    // Returns about the bytes of the payload coding the characters counted
+    // in 'counts' with a single code table, serializing it into 'buffer':
+    size_t estimate_single_table_length(const histogram& counts,
+                                        std::vector<int8_t>& buffer) const;
+    
+    // Builds the code of 'counts' obeying the code word length limit and
+    // computes the bits of the text with and without the limit:
+    code_table build_code(const histogram& counts,
+                          uint64_t& unlimited_bits,
+                          uint64_t& encoded_bits) const;
+    
+    // Appends the block holding the 'length' bytes of 'text' as they are:
+    void append_stored_block(const int8_t* text,
+                             size_t length,
+                             const histogram& counts,
+                             std::vector<int8_t>& output) const;
+    
+    // Appends the block repeating the first character of 'text' 'length'
+    // times:
+    void append_run_block(const int8_t* text,
+                          size_t length,
+                          const histogram& counts,
+                          std::vector<int8_t>& output) const;
+    
+    // Adds the bits of a compressed block to the totals and the statistics:
+    void add_block_statistics(const histogram& counts,
+                              uint64_t unlimited_bits,
+                              uint64_t encoded_bits) const;
+    
+    // Compresses the blocks 'next_block' describes on the threads of 'pool'
+    // until it returns false:
+    void compress_blocks(
+                const std::function<bool(pending_block&)>& next_block,
+                std::ostream& out,
+                thread_pool& pool);
+};
+
+#endif // BLOCK_COMPRESSOR_HPP
@@ -0,0 +1,1427 @@
+#include "adaptive_huffman_coder.hpp"
+#include "block_decompressor.hpp"
+#include "byte_counts.hpp"
+#include "context_model.hpp"
+#include "file_format_error.h"
+#include "huffman_decode_table.hpp"
+#include "huffman_decoder.hpp"
+#include "huffman_deserializer.hpp"
+#include "lz77.hpp"
+#include "pipeline_statistics.hpp"
+#include "varint.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+block_decompressor::block_decompressor()
+:
+    statistics{nullptr},
+    dictionary{nullptr}
+{}
+
+void block_decompressor::set_statistics(pipeline_statistics* statistics)
+{
+    this->statistics = statistics;
+}
+
+void block_decompressor::set_dictionary(const huffman_dictionary* dictionary)
+{
+    this->dictionary = dictionary;
+}
+
+void block_decompressor::write_output(std::ostream& out,
+                                      const std::vector<int8_t>& text) const
+{
+    pipeline_statistics::stage_timer timer(statistics,
+                                           pipeline_statistics::WRITE,
+                                           text.size());
+    out.write((const char*) text.data(), text.size());
+    
+    if (statistics != nullptr)
+    {
+        statistics->add_uncompressed_bytes(text.size());
+    }
+}
+
+size_t block_decompressor::read_stream_header(std::istream& in,
+                                              uint8_t& flags)
+{
+    int8_t header[block_format::STREAM_HEADER_SIZE];
+    in.read((char*) header, sizeof(header));
+    return read_stream_header(header, (size_t) in.gcount(), flags);
+}
+
+size_t block_decompressor::read_stream_header(const int8_t* header,
+                                              size_t size,
+                                              uint8_t& flags)
+{
+    if (size < block_format::STREAM_HEADER_SIZE)
+    {
+        throw file_format_error{"The stream is too short to contain the "
+                                "stream header."};
+    }
+    
+    for (size_t i = 0; i != sizeof(block_format::MAGIC); ++i)
+    {
+        if (header[i] != block_format::MAGIC[i])
+        {
+            throw file_format_error("Bad file type signature.");
+        }
+    }
+    
+    size_t block_size_log2 = (uint8_t) header[4];
+    
+    if (block_size_log2 < block_format::MIN_BLOCK_SIZE_LOG2 ||
+        block_size_log2 > block_format::MAX_BLOCK_SIZE_LOG2)
+    {
+        throw file_format_error{"Bad block size."};
+    }
+    
+    flags = (uint8_t) header[5];
+    
+    if ((flags & ~block_format::HAS_BLOCK_INDEX) != 0)
+    {
+        throw file_format_error{"Unknown stream flags."};
+    }
+    
+    return block_size_log2;
+}
+
+void block_decompressor::decompress(std::istream& in, std::ostream& out)
+{
+    uint8_t flags;
+    size_t block_size = (size_t) 1 << read_stream_header(in, flags);
+    decompress_blocks(in, out, block_size, flags);
+}
+
+void block_decompressor::decompress_blocks(std::istream& in,
+                                           std::ostream& out,
+                                           size_t block_size,
+                                           uint8_t flags)
+{
+    block_index observed_index;
+    std::vector<int8_t> payload;
+    std::vector<int8_t> text;
+    scratch block_scratch;
+    
+    while (true)
+    {
+        int type = in.get();
+        
+        if (type == std::char_traits<char>::eof())
+        {
+            throw file_format_error{"The stream ends without the end of "
+                                    "stream block."};
+        }
+        
+        if (type == block_format::END_OF_STREAM)
+        {
+            break;
+        }
+        
+        size_t length = read_varint(in);
+        size_t payload_length = read_varint(in);
+        
+        if (length == 0 || length > block_size)
+        {
+            std::stringstream ss;
+            ss << "Bad block length: " << length << ".";
+            std::string err_msg = ss.str();
+            throw file_format_error{err_msg.c_str()};
+        }
+        
+        if (payload_length > block_size + block_format::MAX_PAYLOAD_OVERHEAD)
+        {
+            std::stringstream ss;
+            ss << "Bad block payload length: " << payload_length << ".";
+            std::string err_msg = ss.str();
+            throw file_format_error{err_msg.c_str()};
+        }
+        
+        payload.resize(payload_length);
+        
+        {
+            pipeline_statistics::stage_timer timer(statistics,
+                                                   pipeline_statistics::READ,
+                                                   payload_length);
+            in.read((char*) payload.data(), payload_length);
+        }
+        
+        if ((size_t) in.gcount() != payload_length)
+        {
+            throw file_format_error{"The stream ends in the middle of a "
+                                    "block."};
+        }
+        
+        text.resize(length);
+        decompress_block((block_format::block_type) type,
+                         payload.data(),
+                         payload.size(),
+                         text.data(),
+                         length,
+                         block_scratch);
+        write_output(out, text);
+        observed_index.add_block(1 + varint_length(length)
+                                   + varint_length(payload_length)
+                                   + payload_length,
+                                 length);
+    }
+    
+    
+    // The blocks are followed by the end of stream block:
+    uint64_t stream_size = observed_index.get_end_of_blocks_offset() + 1;
+    
+    if ((flags & block_format::HAS_BLOCK_INDEX) != 0)
+    {
+        // The stored index must describe exactly the blocks just decoded:
+        std::vector<int8_t> expected_trailer;
+        observed_index.append_trailer(expected_trailer);
+        stream_size += expected_trailer.size();
+        std::vector<int8_t> trailer(expected_trailer.size());
+        in.read((char*) trailer.data(), trailer.size());
+        
+        if ((size_t) in.gcount() != trailer.size() ||
+            trailer != expected_trailer)
+        {
+            throw file_format_error{"The block index does not match the "
+                                    "blocks."};
+        }
+    }
+    
+    if (statistics != nullptr)
+    {
+        statistics->add_compressed_bytes(stream_size);
+    }
+    
+    if (!out)
+    {
+        throw std::runtime_error{"Could not write the decompressed stream."};
+    }
+}
+
+void block_decompressor::decompress(std::istream& in,
+                                    std::ostream& out,
+                                    thread_pool& pool)
+{
+    std::streampos stream_start = in.tellg();
+    uint8_t flags;
+    size_t block_size = (size_t) 1 << read_stream_header(in, flags);
+    
+    if ((flags & block_format::HAS_BLOCK_INDEX) == 0 ||
+        stream_start == std::streampos(-1))
+    {
+        decompress_blocks(in, out, block_size, flags);
+        return;
+    }
+    
+    block_index index = block_index::read_trailer(in,
+                                                  (uint64_t) stream_start,
+                                                  block_size);
+    
+    in.seekg(stream_start + (std::streamoff) index.get_end_of_blocks_offset());
+    
+    if (in.get() != block_format::END_OF_STREAM)
+    {
+        throw file_format_error{"The stream ends without the end of "
+                                "stream block."};
+    }
+    
+    struct pending_block {
+        std::vector<int8_t> block;
+        std::vector<int8_t> text;
+        std::future<void> done;
+    };
+    
+    const size_t max_pending_blocks = 2 * pool.size();
+    std::deque<std::unique_ptr<pending_block>> pending_blocks;
+    size_t next_block_number = 0;
+    
+    // Each worker reuses its own scratch, so no block allocates anew:
+    if (worker_scratch.size() < pool.size())
+    {
+        worker_scratch.resize(pool.size());
+    }
+    
+    try
+    {
+        while (true)
+        {
+            // Keep the pool busy with the blocks following the oldest one:
+            while (next_block_number != index.number_of_blocks() &&
+                   pending_blocks.size() < max_pending_blocks)
+            {
+                const block_index::entry& e =
+                    index.get_entry(next_block_number++);
+                
+                std::unique_ptr<pending_block> block(new pending_block);
+                block->block.resize(e.compressed_size);
+                block->text.resize(e.decompressed_size);
+                in.seekg(stream_start + (std::streamoff) e.compressed_offset);
+                
+                {
+                    pipeline_statistics::stage_timer timer(
+                                                statistics,
+                                                pipeline_statistics::READ,
+                                                e.compressed_size);
+                    in.read((char*) block->block.data(),
+                            block->block.size());
+                }
+                
+                if ((size_t) in.gcount() != block->block.size())
+                {
+                    throw file_format_error{"The stream ends in the middle "
+                                            "of a block."};
+                }
+                
+                pending_block* p = block.get();
+                const block_index::entry* pe = &e;
+                p->done = pool.submit([this, p, pe]() {
+                    decompress_indexed_block(
+                        p->block.data(),
+                        *pe,
+                        p->text.data(),
+                        worker_scratch[thread_pool::get_worker_index()]);
+                });
+                
+                pending_blocks.push_back(std::move(block));
+            }
+            
+            if (pending_blocks.empty())
+            {
+                break;
+            }
+            
+            // The blocks are written in order, each at its indexed offset:
+            pending_block& oldest = *pending_blocks.front();
+            oldest.done.get();
+            write_output(out, oldest.text);
+            pending_blocks.pop_front();
+        }
+    }
+    catch (...)
+    {
+        // Do not free the buffers the workers may still be using:
+        for (std::unique_ptr<pending_block>& block : pending_blocks)
+        {
+            if (block->done.valid())
+            {
+                block->done.wait();
+            }
+        }
+        
+        throw;
+    }
+    
+    if (statistics != nullptr)
+    {
+        std::streampos stream_end = in.seekg(0, std::ios::end).tellg();
+        statistics->add_compressed_bytes((uint64_t)(stream_end
+                                                    - stream_start));
+    }
+    
+    if (!out)
+    {
+        throw std::runtime_error{"Could not write the decompressed stream."};
+    }
+}
+
+bool block_decompressor::read_block_index(const int8_t* data,
+                                          size_t size,
+                                          block_index& index)
+{
+    uint8_t flags;
+    size_t block_size = (size_t) 1 << read_stream_header(data, size, flags);
+    
+    if ((flags & block_format::HAS_BLOCK_INDEX) == 0)
+    {
+        return false;
+    }
+    
+    index.load_trailer(data, size, block_size);
+    
+    if (data[index.get_end_of_blocks_offset()] != block_format::END_OF_STREAM)
+    {
+        throw file_format_error{"The stream ends without the end of "
+                                "stream block."};
+    }
+    
+    // The caller sizes the output by the index, so the index may not claim
+    // more text than the blocks themselves do:
+    for (size_t i = 0; i != index.number_of_blocks(); ++i)
+    {
+        const block_index::entry& e = index.get_entry(i);
+        read_indexed_block_header(data + e.compressed_offset, e);
+    }
+    
+    return true;
+}
+
+void block_decompressor::decompress(const int8_t* data,
+                                    size_t size,
+                                    const block_index& index,
+                                    int8_t* text)
+{
+    scratch block_scratch;
+    decompress_indexed_blocks(data, index, text, block_scratch);
+    add_mapped_sizes(size, index);
+}
+
+void block_decompressor::decompress_indexed_blocks(const int8_t* data,
+                                                   const block_index& index,
+                                                   int8_t* text,
+                                                   scratch& block_scratch)
+{
+    for (size_t i = 0; i != index.number_of_blocks(); ++i)
+    {
+        const block_index::entry& e = index.get_entry(i);
+        decompress_indexed_block(data + e.compressed_offset,
+                                 e,
+                                 text + e.decompressed_offset,
+                                 block_scratch);
+    }
+}
+
+void block_decompressor::decompress(const int8_t* data,
+                                    size_t size,
+                                    const block_index& index,
+                                    int8_t* text,
+                                    thread_pool& pool)
+{
+    // Each block decodes straight into its own part of 'text', so no block
+    // waits for another:
+    std::vector<std::future<void>> blocks_done;
+    blocks_done.reserve(index.number_of_blocks());
+    
+    // Each worker reuses its own scratch, so no block allocates anew:
+    if (worker_scratch.size() < pool.size())
+    {
+        worker_scratch.resize(pool.size());
+    }
+    
+    try
+    {
+        for (size_t i = 0; i != index.number_of_blocks(); ++i)
+        {
+            const block_index::entry* e = &index.get_entry(i);
+            blocks_done.push_back(pool.submit([this, data, e, text]() {
+                decompress_indexed_block(
+                    data + e->compressed_offset,
+                    *e,
+                    text + e->decompressed_offset,
+                    worker_scratch[thread_pool::get_worker_index()]);
+            }));
+        }
+        
+        for (std::future<void>& done : blocks_done)
+        {
+            done.get();
+        }
+    }
+    catch (...)
+    {
+        // Do not let the caller free the buffers the workers may still be
+        // using:
+        for (std::future<void>& done : blocks_done)
+        {
+            if (done.valid())
+            {
+                done.wait();
+            }
+        }
+        
+        throw;
+    }
+    
+    add_mapped_sizes(size, index);
+}
+
+size_t block_decompressor::decompress(const int8_t* data,
+                                      size_t size,
+                                      int8_t* text,
+                                      size_t capacity)
+{
+    scratch block_scratch;
+    return decompress(data, size, text, capacity, block_scratch);
+}
+
+size_t block_decompressor::decompress(const int8_t* data,
+                                      size_t size,
+                                      int8_t* text,
+                                      size_t capacity,
+                                      scratch& block_scratch)
+{
+    block_index& index = block_scratch.index;
+    locate_blocks(data, size, index);
+    
+    if (index.get_decompressed_size() > capacity)
+    {
+        throw std::invalid_argument{"The output buffer is too small for the "
+                                    "decompressed text."};
+    }
+    
+    decompress_indexed_blocks(data, index, text, block_scratch);
+    add_mapped_sizes(size, index);
+    return index.get_decompressed_size();
+}
+
+uint64_t block_decompressor::get_decompressed_size(const int8_t* data,
+                                                   size_t size)
+{
+    block_index index;
+    locate_blocks(data, size, index);
+    return index.get_decompressed_size();
+}
+
+void block_decompressor::locate_blocks(const int8_t* data,
+                                       size_t size,
+                                       block_index& index)
+{
+    if (read_block_index(data, size, index))
+    {
+        return;
+    }
+    
+    index.clear();
+    
+    uint8_t flags;
+    size_t block_size = (size_t) 1 << read_stream_header(data, size, flags);
+    size_t position = block_format::STREAM_HEADER_SIZE;
+    
+    try
+    {
+        while (true)
+        {
+            if (position == size)
+            {
+                throw file_format_error{"The stream ends without the end of "
+                                        "stream block."};
+            }
+            
+            if (data[position] == block_format::END_OF_STREAM)
+            {
+                return;
+            }
+            
+            size_t block_start = position++;
+            uint64_t length = extract_varint(data, size, position);
+            uint64_t payload_length = extract_varint(data, size, position);
+            
+            if (length == 0 || length > block_size ||
+                payload_length > size - position)
+            {
+                throw file_format_error{"Bad block lengths."};
+            }
+            
+            position += payload_length;
+            index.add_block(position - block_start, length);
+        }
+    }
+    catch (std::out_of_range& error)
+    {
+        throw file_format_error{"The stream ends in the middle of a block."};
+    }
+}
+
+uint64_t block_decompressor::decompress_range(std::istream& in,
+                                              std::ostream& out,
+                                              uint64_t offset,
+                                              uint64_t length)
+{
+    std::streampos stream_start = in.tellg();
+    uint8_t flags;
+    size_t block_size = (size_t) 1 << read_stream_header(in, flags);
+    
+    if (stream_start == std::streampos(-1))
+    {
+        throw std::runtime_error{"Decompressing a range requires a seekable "
+                                 "stream."};
+    }
+    
+    block_index index = (flags & block_format::HAS_BLOCK_INDEX) != 0
+                      ? block_index::read_trailer(in,
+                                                  (uint64_t) stream_start,
+                                                  block_size)
+                      : scan_blocks(in, block_size);
+    std::vector<int8_t> block;
+    
+    uint64_t range_length = decompress_range_blocks(
+        index,
+        offset,
+        length,
+        [&](const block_index::entry& e) {
+            block.resize(e.compressed_size);
+            in.seekg(stream_start + (std::streamoff) e.compressed_offset);
+            
+            {
+                pipeline_statistics::stage_timer timer(
+                                                statistics,
+                                                pipeline_statistics::READ,
+                                                e.compressed_size);
+                in.read((char*) block.data(), block.size());
+            }
+            
+            if ((size_t) in.gcount() != block.size())
+            {
+                throw file_format_error{"The stream ends in the middle of a "
+                                        "block."};
+            }
+            
+            return (const int8_t*) block.data();
+        },
+        [&](const int8_t* text, size_t text_length) {
+            out.write((const char*) text, text_length);
+        });
+    
+    if (!out)
+    {
+        throw std::runtime_error{"Could not write the decompressed stream."};
+    }
+    
+    return range_length;
+}
+
+size_t block_decompressor::decompress_range(const int8_t* data,
+                                            size_t size,
+                                            uint64_t offset,
+                                            size_t length,
+                                            int8_t* text)
+{
+    block_index index;
+    locate_blocks(data, size, index);
+    size_t text_written = 0;
+    
+    return (size_t) decompress_range_blocks(
+        index,
+        offset,
+        length,
+        [data](const block_index::entry& e) {
+            return data + e.compressed_offset;
+        },
+        [text, &text_written](const int8_t* block_text, size_t text_length) {
+            std::memcpy(text + text_written, block_text, text_length);
+            text_written += text_length;
+        });
+}
+
+block_index block_decompressor::scan_blocks(std::istream& in,
+                                            size_t block_size)
+{
+    block_index index;
+    
+    while (true)
+    {
+        int type = in.get();
+        
+        if (type == std::char_traits<char>::eof())
+        {
+            throw file_format_error{"The stream ends without the end of "
+                                    "stream block."};
+        }
+        
+        if (type == block_format::END_OF_STREAM)
+        {
+            return index;
+        }
+        
+        uint64_t length = read_varint(in);
+        uint64_t payload_length = read_varint(in);
+        
+        if (length == 0 || length > block_size ||
+            payload_length > block_size + block_format::MAX_PAYLOAD_OVERHEAD)
+        {
+            throw file_format_error{"Bad block lengths."};
+        }
+        
+        in.seekg((std::streamoff) payload_length, std::ios::cur);
+        index.add_block(1 + varint_length(length)
+                          + varint_length(payload_length)
+                          + payload_length,
+                        length);
+    }
+}
+
+uint64_t block_decompressor::decompress_range_blocks(
+            const block_index& index,
+            uint64_t offset,
+            uint64_t length,
+            const std::function<const int8_t*(const block_index::entry&)>&
+                read_block,
+            const std::function<void(const int8_t*, size_t)>& write_text)
+{
+    if (offset > index.get_decompressed_size())
+    {
+        throw std::out_of_range{"The range starts past the end of the text."};
+    }
+    
+    uint64_t range_end = offset + std::min(length,
+                                           index.get_decompressed_size()
+                                           - offset);
+    
+    if (range_end == offset)
+    {
+        return 0;
+    }
+    
+    scratch block_scratch;
+    std::vector<int8_t> text;
+    
+    for (size_t i = index.find_block(offset);
+         i != index.number_of_blocks() &&
+         index.get_entry(i).decompressed_offset < range_end;
+         ++i)
+    {
+        const block_index::entry& e = index.get_entry(i);
+        text.resize(e.decompressed_size);
+        decompress_indexed_block(read_block(e),
+                                 e,
+                                 text.data(),
+                                 block_scratch);
+        
+        // Only the first and the last block may stick out of the range:
+        uint64_t text_begin = std::max(offset, e.decompressed_offset);
+        uint64_t text_end = std::min(range_end,
+                                     e.decompressed_offset
+                                     + e.decompressed_size);
+        write_text(text.data() + (text_begin - e.decompressed_offset),
+                   (size_t)(text_end - text_begin));
+        
+        if (statistics != nullptr)
+        {
+            statistics->add_compressed_bytes(e.compressed_size);
+            statistics->add_uncompressed_bytes(text_end - text_begin);
+        }
+    }
+    
+    return range_end - offset;
+}
+
+void block_decompressor::check_dictionary(const int8_t* payload,
+                                          size_t payload_length,
+                                          size_t& payload_index) const
+{
+    if (payload_length - payload_index < 4)
+    {
+        throw std::out_of_range{"No dictionary identifier."};
+    }
+    
+    uint32_t id = 0;
+    
+    for (size_t i = 0; i != 4; ++i)
+    {
+        id |= (uint32_t)(uint8_t) payload[payload_index++] << (8 * i);
+    }
+    
+    if (dictionary == nullptr || dictionary->get_id() != id)
+    {
+        std::stringstream ss;
+        ss << "The block is coded with the dictionary "
+           << std::hex
+           << id
+           << ", which is not given.";
+        std::string err_msg = ss.str();
+        throw file_format_error{err_msg.c_str()};
+    }
+}
+
+void block_decompressor::add_mapped_sizes(size_t size,
+                                          const block_index& index) const
+{
+    if (statistics != nullptr)
+    {
+        statistics->add_compressed_bytes(size);
+        statistics->add_uncompressed_bytes(index.get_decompressed_size());
+    }
+}
+
+size_t block_decompressor::read_indexed_block_header(
+                                        const int8_t* block,
+                                        const block_index::entry& e) const
+{
+    size_t index = 1;
+    uint64_t length;
+    uint64_t payload_length;
+    
+    try
+    {
+        length = extract_varint(block, e.compressed_size, index);
+        payload_length = extract_varint(block, e.compressed_size, index);
+    }
+    catch (std::out_of_range& error)
+    {
+        throw file_format_error{"The block is too short to contain its "
+                                "lengths."};
+    }
+    
+    if (length != e.decompressed_size ||
+        payload_length != e.compressed_size - index)
+    {
+        throw file_format_error{"The block does not match the block index."};
+    }
+    
+    return index;
+}
+
+void block_decompressor::decompress_indexed_block(
+                                        const int8_t* block,
+                                        const block_index::entry& e,
+                                        int8_t* text,
+                                        scratch& block_scratch) const
+{
+    size_t header_length = read_indexed_block_header(block, e);
+    
+    decompress_block((block_format::block_type) block[0],
+                     block + header_length,
+                     e.compressed_size - header_length,
+                     text,
+                     e.decompressed_size,
+                     block_scratch);
+}
+
+void block_decompressor::decompress_block(block_format::block_type type,
+                                          const int8_t* payload,
+                                          size_t payload_length,
+                                          int8_t* text,
+                                          size_t length) const
+{
+    scratch block_scratch;
+    decompress_block(type,
+                     payload,
+                     payload_length,
+                     text,
+                     length,
+                     block_scratch);
+}
+
+void block_decompressor::decompress_block(block_format::block_type type,
+                                          const int8_t* payload,
+                                          size_t payload_length,
+                                          int8_t* text,
+                                          size_t length,
+                                          scratch& block_scratch) const
+{
+    if (type != block_format::HUFFMAN_BLOCK &&
+        type != block_format::INTERLEAVED_HUFFMAN_BLOCK &&
+        type != block_format::DICTIONARY_HUFFMAN_BLOCK &&
+        type != block_format::ADAPTIVE_HUFFMAN_BLOCK &&
+        type != block_format::STORED_BLOCK &&
+        type != block_format::RUN_BLOCK &&
+        type != block_format::CONTEXT_HUFFMAN_BLOCK &&
+        type != block_format::LZ77_HUFFMAN_BLOCK)
+    {
+        std::stringstream ss;
+        ss << "Unknown block type: " << (int) type << ".";
+        std::string err_msg = ss.str();
+        throw file_format_error{err_msg.c_str()};
+    }
+    
+    if (type == block_format::ADAPTIVE_HUFFMAN_BLOCK)
+    {
+        decompress_adaptive_block(payload, payload_length, text, length);
+        return;
+    }
+    
+    if (type == block_format::STORED_BLOCK ||
+        type == block_format::RUN_BLOCK)
+    {
+        decompress_uncoded_block(type, payload, payload_length, text, length);
+        return;
+    }
+    
+    if (type == block_format::LZ77_HUFFMAN_BLOCK)
+    {
+        decompress_lz77_block(payload,
+                              payload_length,
+                              text,
+                              length,
+                              block_scratch);
+        return;
+    }
+    
+    if (type == block_format::CONTEXT_HUFFMAN_BLOCK)
+    {
+        decompress_context_block(payload,
+                                 payload_length,
+                                 text,
+                                 length,
+                                 block_scratch);
+        return;
+    }
+    
+    pipeline_statistics::stage_timer build_timer(
+                                        statistics,
+                                        pipeline_statistics::BUILD_DECODE_TABLE,
+                                        length);
+    code_table table;
+    std::vector<size_t>& numbers_of_bits = block_scratch.numbers_of_bits;
+    numbers_of_bits.clear();
+    size_t payload_index = 0;
+    size_t number_of_streams = 1;
+    
+    try
+    {
+        if (type == block_format::DICTIONARY_HUFFMAN_BLOCK)
+        {
+            check_dictionary(payload, payload_length, payload_index);
+        }
+        else
+        {
+            huffman_deserializer deserializer;
+            table = deserializer.extract_code_table(payload,
+                                                    payload_length,
+                                                    payload_index);
+        }
+        
+        if (type != block_format::HUFFMAN_BLOCK)
+        {
+            if (payload_index == payload_length)
+            {
+                throw std::out_of_range{"No number of streams."};
+            }
+            
+            number_of_streams = (uint8_t) payload[payload_index++];
+            
+            // A dictionary block may have a single stream:
+            size_t min_number_of_streams =
+                type == block_format::DICTIONARY_HUFFMAN_BLOCK
+                ? 1
+                : block_format::MIN_INTERLEAVED_STREAMS;
+            
+            if (number_of_streams < min_number_of_streams ||
+                number_of_streams > block_format::MAX_INTERLEAVED_STREAMS)
+            {
+                std::stringstream ss;
+                ss << "Bad number of streams: " << number_of_streams << ".";
+                std::string err_msg = ss.str();
+                throw file_format_error{err_msg.c_str()};
+            }
+        }
+        
+        for (size_t stream = 0; stream != number_of_streams; ++stream)
+        {
+            numbers_of_bits.push_back(extract_varint(payload,
+                                                     payload_length,
+                                                     payload_index));
+        }
+    }
+    catch (std::out_of_range& error)
+    {
+        throw file_format_error{"The block is too short to contain the code "
+                                "word lengths."};
+    }
+    
+    size_t number_of_bytes = 0;
+    
+    for (size_t number_of_stream_bits : numbers_of_bits)
+    {
+        size_t number_of_stream_bytes = number_of_stream_bits / CHAR_BIT
+                                      + (number_of_stream_bits % CHAR_BIT != 0);
+        
+        if (number_of_stream_bytes >
+            payload_length - payload_index - number_of_bytes)
+        {
+            throw file_format_error{"The block is too short to contain the "
+                                    "encoded text."};
+        }
+        
+        number_of_bytes += number_of_stream_bytes;
+    }
+    
+    const huffman_decode_table* decode_table;
+    
+    if (type == block_format::DICTIONARY_HUFFMAN_BLOCK)
+    {
+        decode_table = &dictionary->get_decode_table();
+    }
+    else
+    {
+        block_scratch.decode_table.assign(table);
+        decode_table = &block_scratch.decode_table;
+    }
+    
+    build_timer.stop();
+    
+    {
+        pipeline_statistics::stage_timer timer(statistics,
+                                               pipeline_statistics::DECODE,
+                                               length);
+        huffman_decoder decoder;
+        
+        if (number_of_streams == 1)
+        {
+            decoder.decode(*decode_table,
+                           payload + payload_index,
+                           numbers_of_bits[0],
+                           text,
+                           length);
+        }
+        else
+        {
+            decoder.decode_interleaved(*decode_table,
+                                       payload + payload_index,
+                                       numbers_of_bits,
+                                       text,
+                                       length);
+        }
+    }
+    
+    if (statistics != nullptr)
+    {
+        uint64_t encoded_bits = 0;
+        
+        for (size_t number_of_stream_bits : numbers_of_bits)
+        {
+            encoded_bits += number_of_stream_bits;
+        }
+        
+        // The entropy of the decoded text is only needed for the report:
+        statistics->add_counts(compute_byte_histogram(text, length));
+        statistics->add_encoded_bits(encoded_bits);
+    }
+}
+
+void block_decompressor::decompress_adaptive_block(const int8_t* payload,
+                                                   size_t payload_length,
+                                                   int8_t* text,
+                                                   size_t length) const
+{
+    size_t payload_index = 0;
+    size_t number_of_bits;
+    
+    try
+    {
+        number_of_bits = extract_varint(payload, payload_length, payload_index);
+    }
+    catch (std::out_of_range& error)
+    {
+        throw file_format_error{"The block is too short to contain the "
+                                "number of bits."};
+    }
+    
+    if (number_of_bits / CHAR_BIT + (number_of_bits % CHAR_BIT != 0) >
+        payload_length - payload_index)
+    {
+        throw file_format_error{"The block is too short to contain the "
+                                "encoded text."};
+    }
+    
+    {
+        pipeline_statistics::stage_timer timer(statistics,
+                                               pipeline_statistics::DECODE,
+                                               length);
+        adaptive_huffman_coder coder;
+        coder.decode(payload + payload_index, number_of_bits, text, length);
+    }
+    
+    if (statistics != nullptr)
+    {
+        statistics->add_counts(compute_byte_histogram(text, length));
+        statistics->add_encoded_bits(number_of_bits);
+    }
+}
+
+void block_decompressor::decompress_uncoded_block(
+                                        block_format::block_type type,
+                                        const int8_t* payload,
+                                        size_t payload_length,
+                                        int8_t* text,
+                                        size_t length) const
+{
+    size_t expected_payload_length =
+        type == block_format::STORED_BLOCK ? length : 1;
+    
+    if (payload_length != expected_payload_length)
+    {
+        throw file_format_error{"The block payload does not match the block "
+                                "length."};
+    }
+    
+    {
+        pipeline_statistics::stage_timer timer(statistics,
+                                               pipeline_statistics::DECODE,
+                                               length);
+        
+        if (type == block_format::STORED_BLOCK)
+        {
+            std::memcpy(text, payload, length);
+        }
+        else
+        {
+            std::memset(text, payload[0], length);
+        }
+    }
+    
+    if (statistics != nullptr)
+    {
+        statistics->add_counts(compute_byte_histogram(text, length));
+        statistics->add_encoded_bits((uint64_t) CHAR_BIT * payload_length);
+    }
+}
+
+void block_decompressor::decompress_context_block(
+                                        const int8_t* payload,
+                                        size_t payload_length,
+                                        int8_t* text,
+                                        size_t length,
+                                        scratch& block_scratch) const
+{
+    pipeline_statistics::stage_timer build_timer(
+                                        statistics,
+                                        pipeline_statistics::BUILD_DECODE_TABLE,
+                                        length);
+    std::vector<huffman_decode_table>& decode_tables =
+        block_scratch.context_decode_tables;
+    uint8_t context_map[context_model::NUMBER_OF_CONTEXTS];
+    size_t payload_index = 0;
+    size_t number_of_tables;
+    size_t number_of_bits;
+    
+    try
+    {
+        if (payload_length == 0)
+        {
+            throw std::out_of_range{"No number of tables."};
+        }
+        
+        number_of_tables = (uint8_t) payload[payload_index++];
+        
+        if (number_of_tables == 0 ||
+            number_of_tables > block_format::MAX_CONTEXT_TABLES)
+        {
+            std::stringstream ss;
+            ss << "Bad number of tables: " << number_of_tables << ".";
+            std::string err_msg = ss.str();
+            throw file_format_error{err_msg.c_str()};
+        }
+        
+        for (size_t context = 0;
+             context != context_model::NUMBER_OF_CONTEXTS; )
+        {
+            if (payload_index == payload_length)
+            {
+                throw std::out_of_range{"No context run."};
+            }
+            
+            uint8_t table = (uint8_t) payload[payload_index++];
+            uint64_t run_length = extract_varint(payload,
+                                                 payload_length,
+                                                 payload_index);
+            
+            if (table >= number_of_tables ||
+                run_length == 0 ||
+                run_length > context_model::NUMBER_OF_CONTEXTS - context)
+            {
+                throw file_format_error{"Bad context map."};
+            }
+            
+            std::fill(context_map + context,
+                      context_map + context + run_length,
+                      table);
+            context += run_length;
+        }
+        
+        if (decode_tables.size() < number_of_tables)
+        {
+            decode_tables.resize(number_of_tables);
+        }
+        
+        for (size_t table = 0; table != number_of_tables; ++table)
+        {
+            huffman_deserializer deserializer;
+            decode_tables[table].assign(
+                deserializer.extract_code_table(payload,
+                                                payload_length,
+                                                payload_index));
+        }
+        
+        number_of_bits = extract_varint(payload, payload_length, payload_index);
+    }
+    catch (std::out_of_range& error)
+    {
+        throw file_format_error{"The block is too short to contain the code "
+                                "word lengths."};
+    }
+    
+    if (number_of_bits / CHAR_BIT + (number_of_bits % CHAR_BIT != 0) >
+        payload_length - payload_index)
+    {
+        throw file_format_error{"The block is too short to contain the "
+                                "encoded text."};
+    }
+    
+    build_timer.stop();
+    
+    {
+        pipeline_statistics::stage_timer timer(statistics,
+                                               pipeline_statistics::DECODE,
+                                               length);
+        huffman_decoder decoder;
+        decoder.decode_with_contexts(decode_tables.data(),
+                                     context_map,
+                                     payload + payload_index,
+                                     number_of_bits,
+                                     text,
+                                     length);
+    }
+    
+    if (statistics != nullptr)
+    {
+        statistics->add_counts(compute_byte_histogram(text, length));
+        statistics->add_encoded_bits(number_of_bits);
+    }
+}
+
+// Reads the extra bits of the LZ77 codes:
+class extra_bit_reader {
+public:
+    
+    extra_bit_reader(const int8_t* data, size_t number_of_bits)
+    :
+        data{(const uint8_t*) data},
+        number_of_bits{number_of_bits},
+        position{0}
+    {}
+    
+    uint32_t read(size_t count)
+    {
+        if (count > number_of_bits - position)
+        {
+            throw file_format_error{"The extra bits of the LZ77 codes run "
+                                    "out."};
+        }
+        
+        uint32_t value = 0;
+        
+        for (size_t bit = 0; bit != count; ++bit, ++position)
+        {
+            value |= (uint32_t)((data[position / CHAR_BIT]
+                                 >> (position % CHAR_BIT)) & 1) << bit;
+        }
+        
+        return value;
+    }
+    
+    bool is_used_up() const
+    {
+        return position == number_of_bits;
+    }
+    
+private:
+    
+    const uint8_t* data;
+    size_t number_of_bits;
+    size_t position;
+};
+
+// Returns the value of the LZ77 'code' of the kind starting at 'first_code'
+// reading its extra bits from 'extra_bits':
+static uint64_t decode_lz77_value(uint8_t code,
+                                  uint8_t first_code,
+                                  extra_bit_reader& extra_bits)
+{
+    if (code < first_code ||
+        code - first_code >= (int) LZ77_NUMBER_OF_VALUE_CODES)
+    {
+        throw file_format_error{"Unexpected LZ77 code."};
+    }
+    
+    size_t number_of_extra_bits;
+    uint64_t base = lz77_code_base(code - first_code, number_of_extra_bits);
+    return base + extra_bits.read(number_of_extra_bits);
+}
+
+void block_decompressor::decompress_lz77_block(const int8_t* payload,
+                                               size_t payload_length,
+                                               int8_t* text,
+                                               size_t length,
+                                               scratch& block_scratch) const
+{
+    pipeline_statistics::stage_timer build_timer(
+                                        statistics,
+                                        pipeline_statistics::BUILD_DECODE_TABLE,
+                                        length);
+    std::vector<int8_t>& literals = block_scratch.literals;
+    std::vector<int8_t>& codes = block_scratch.codes;
+    size_t payload_index = 0;
+    size_t numbers_of_bits[3];
+    
+    try
+    {
+        uint64_t number_of_literals = extract_varint(payload,
+                                                     payload_length,
+                                                     payload_index);
+        uint64_t number_of_codes = extract_varint(payload,
+                                                  payload_length,
+                                                  payload_index);
+        
+        // Each sequence takes a literal or the match of at least four:
+        if (number_of_literals > length ||
+            number_of_codes == 0 ||
+            number_of_codes > length + 1)
+        {
+            throw file_format_error{"Bad number of LZ77 literals or codes."};
+        }
+        
+        literals.resize(number_of_literals);
+        codes.resize(number_of_codes);
+        huffman_deserializer deserializer;
+        
+        if (number_of_literals != 0)
+        {
+            block_scratch.decode_table.assign(
+                deserializer.extract_code_table(payload,
+                                                payload_length,
+                                                payload_index));
+        }
+        
+        block_scratch.codes_decode_table.assign(
+            deserializer.extract_code_table(payload,
+                                            payload_length,
+                                            payload_index));
+        
+        for (size_t& number_of_bits : numbers_of_bits)
+        {
+            number_of_bits = extract_varint(payload,
+                                            payload_length,
+                                            payload_index);
+        }
+    }
+    catch (std::out_of_range& error)
+    {
+        throw file_format_error{"The block is too short to contain the code "
+                                "word lengths."};
+    }
+    
+    const int8_t* streams[3];
+    
+    for (size_t stream = 0; stream != 3; ++stream)
+    {
+        size_t number_of_bytes = numbers_of_bits[stream] / CHAR_BIT
+                               + (numbers_of_bits[stream] % CHAR_BIT != 0);
+        
+        if (number_of_bytes > payload_length - payload_index)
+        {
+            throw file_format_error{"The block is too short to contain the "
+                                    "encoded text."};
+        }
+        
+        streams[stream] = payload + payload_index;
+        payload_index += number_of_bytes;
+    }
+    
+    build_timer.stop();
+    
+    pipeline_statistics::stage_timer timer(statistics,
+                                           pipeline_statistics::DECODE,
+                                           length);
+    huffman_decoder decoder;
+    
+    if (!literals.empty())
+    {
+        decoder.decode(block_scratch.decode_table,
+                       streams[0],
+                       numbers_of_bits[0],
+                       literals.data(),
+                       literals.size());
+    }
+    else if (numbers_of_bits[0] != 0)
+    {
+        throw file_format_error{"The number of encoded bits does not match "
+                                "the number of characters."};
+    }
+    
+    decoder.decode(block_scratch.codes_decode_table,
+                   streams[1],
+                   numbers_of_bits[1],
+                   codes.data(),
+                   codes.size());
+    
+    // Replay the sequences:
+    extra_bit_reader extra_bits(streams[2], numbers_of_bits[2]);
+    size_t position = 0;
+    size_t literal_index = 0;
+    size_t code_index = 0;
+    
+    while (true)
+    {
+        uint64_t literal_length = decode_lz77_value(codes[code_index++],
+                                                    LZ77_LITERAL_LENGTH_CODES,
+                                                    extra_bits);
+        
+        if (literal_length > literals.size() - literal_index ||
+            literal_length > length - position)
+        {
+            throw file_format_error{"Too many LZ77 literals."};
+        }
+        
+        std::memcpy(text + position,
+                    literals.data() + literal_index,
+                    literal_length);
+        position += literal_length;
+        literal_index += literal_length;
+        
+        if (code_index == codes.size())
+        {
+            break;
+        }
+        
+        if (codes.size() - code_index < 2)
+        {
+            throw file_format_error{"The LZ77 codes end in a sequence."};
+        }
+        
+        uint64_t match_length = decode_lz77_value(codes[code_index++],
+                                                  LZ77_MATCH_LENGTH_CODES,
+                                                  extra_bits)
+                              + lz77_matcher::MIN_MATCH_LENGTH;
+        uint64_t distance = decode_lz77_value(codes[code_index++],
+                                              LZ77_DISTANCE_CODES,
+                                              extra_bits) + 1;
+        
+        if (distance > position || match_length > length - position)
+        {
+            throw file_format_error{"Bad LZ77 match."};
+        }
+        
+        const int8_t* source = text + position - distance;
+        int8_t* target = text + position;
+        
+        if (distance >= match_length)
+        {
+            std::memcpy(target, source, match_length);
+        }
+        else
+        {
+            // The match repeats the characters it produces:
+            for (size_t i = 0; i != match_length; ++i)
+            {
+                target[i] = source[i];
+            }
+        }
+        
+        position += match_length;
+    }
+    
+    if (position != length ||
+        literal_index != literals.size() ||
+        !extra_bits.is_used_up())
+    {
+        throw file_format_error{"The LZ77 sequences do not match the block "
+                                "length."};
+    }
+    
+    timer.stop();
+    
+    if (statistics != nullptr)
+    {
+        statistics->add_counts(compute_byte_histogram(text, length));
+        statistics->add_encoded_bits(numbers_of_bits[0]
+                                     + numbers_of_bits[1]
+                                     + numbers_of_bits[2]);
+    }
+}
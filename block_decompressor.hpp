@@ -0,0 +1,281 @@
+#ifndef BLOCK_DECOMPRESSOR_HPP
+#define BLOCK_DECOMPRESSOR_HPP
+
+#include "block_format.hpp"
+#include "block_index.hpp"
+#include "huffman_decode_table.hpp"
+#include "huffman_dictionary.hpp"
+#include "pipeline_statistics.hpp"
+#include "thread_pool.hpp"
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+class block_decompressor {
+public:
+    
+    // The memory a single thread reuses from block to block and from call to
+    // call:
+    struct scratch {
+        block_index index;
+        huffman_decode_table decode_table;
+        std::vector<size_t> numbers_of_bits;
+        
+        // The decode tables of a context block:
+        std::vector<huffman_decode_table> context_decode_tables;
+        
+        // The decode table of the codes and the decoded parts of an LZ77
+        // block:
+        huffman_decode_table codes_decode_table;
+        std::vector<int8_t> literals;
+        std::vector<int8_t> codes;
+    };
+    
+    /******************************************************
+    * Constructs a decompressor collecting no statistics. *
+    ******************************************************/
+    block_decompressor();
+    
+    /**************************************************************************
+    * Decompresses the whole block stream 'in' into 'out' holding at most one *
+    * block of input and one block of output in memory at a time. The block   *
+    * index, if present, is checked against the blocks.                       *
+    **************************************************************************/
+    void decompress(std::istream& in, std::ostream& out);
+    
+    /**************************************************************************
+    * Decompresses the whole block stream 'in' into 'out' decoding the blocks *
+    * listed in the block index on the threads of 'pool'. Falls back to the   *
+    * sequential decompression if the stream has no index or 'in' is not      *
+    * seekable.                                                               *
+    **************************************************************************/
+    void decompress(std::istream& in, std::ostream& out, thread_pool& pool);
+    
+    /*************************************************************************
+    * Decompresses the 'length' characters starting at 'offset' of the text  *
+    * of the seekable block stream 'in' into 'out' and returns their number, *
+    * which is smaller than 'length' if the text ends first. Reads and       *
+    * decodes only the blocks covering the range. Throws 'std::out_of_range' *
+    * if 'offset' is past the end of the text.                               *
+    *************************************************************************/
+    uint64_t decompress_range(std::istream& in,
+                              std::ostream& out,
+                              uint64_t offset,
+                              uint64_t length);
+    
+    /************************************************************************
+    * Reads and validates the stream header. Returns the base two logarithm *
+    * of the maximum block size and stores the stream flags in 'flags'.     *
+    ************************************************************************/
+    size_t read_stream_header(std::istream& in, uint8_t& flags);
+    
+    /******************************************************************
+    * Validates the stream header at the start of the 'size' bytes at *
+    * 'header' in the same way.                                       *
+    ******************************************************************/
+    size_t read_stream_header(const int8_t* header,
+                              size_t size,
+                              uint8_t& flags);
+    
+    /*************************************************************************
+    * Reads the block index of the whole 'size' byte stream at 'data', such  *
+    * as a memory-mapped file, into 'index'. Returns false if the stream has *
+    * no index. Each block is checked to record the lengths its entry does,  *
+    * so that the output can be sized by the index.                          *
+    *************************************************************************/
+    bool read_block_index(const int8_t* data,
+                          size_t size,
+                          block_index& index);
+    
+    /***********************************************************************
+    * Decompresses the 'size' byte stream at 'data' with the block 'index' *
+    * into 'text', which must hold 'index.get_decompressed_size()' bytes.  *
+    * Each block is decoded straight into its place in 'text'.             *
+    ***********************************************************************/
+    void decompress(const int8_t* data,
+                    size_t size,
+                    const block_index& index,
+                    int8_t* text);
+    
+    /************************************************************************
+    * Decompresses the 'size' byte stream at 'data' into 'text' in the same *
+    * way decoding the blocks on the threads of 'pool'.                     *
+    ************************************************************************/
+    void decompress(const int8_t* data,
+                    size_t size,
+                    const block_index& index,
+                    int8_t* text,
+                    thread_pool& pool);
+    
+    /***************************************************************************
+    * Decompresses the whole 'size' byte stream at 'data' into the             *
+    * caller-owned buffer of 'capacity' bytes at 'text' and returns the length *
+    * of the text. No buffer of the size of the input or the output is         *
+    * allocated. Throws 'std::invalid_argument' if the text does not fit.      *
+    ***************************************************************************/
+    size_t decompress(const int8_t* data,
+                      size_t size,
+                      int8_t* text,
+                      size_t capacity);
+    
+    /************************************************************************
+    * Does the same reusing the memory in 'block_scratch', so that repeated *
+    * calls stop allocating once the scratch has grown to their sizes.      *
+    ************************************************************************/
+    size_t decompress(const int8_t* data,
+                      size_t size,
+                      int8_t* text,
+                      size_t capacity,
+                      scratch& block_scratch);
+    
+    /************************************************************************
+    * Returns the length of the text the whole 'size' byte stream at 'data' *
+    * decompresses to. Reads only the header and the block index unless the *
+    * stream has no index.                                                  *
+    ************************************************************************/
+    uint64_t get_decompressed_size(const int8_t* data, size_t size);
+    
+    /************************************************************************
+    * Decompresses the 'length' characters starting at 'offset' of the text *
+    * of the 'size' byte stream at 'data' into 'text' in the same way and   *
+    * returns their number.                                                 *
+    ************************************************************************/
+    size_t decompress_range(const int8_t* data,
+                            size_t size,
+                            uint64_t offset,
+                            size_t length,
+                            int8_t* text);
+    
+    /**********************************************************************
+    * Decodes the 'payload_length' byte payload of a block of type 'type' *
+    * starting at 'payload' into the 'length' bytes starting at 'text'.   *
+    **********************************************************************/
+    void decompress_block(block_format::block_type type,
+                          const int8_t* payload,
+                          size_t payload_length,
+                          int8_t* text,
+                          size_t length) const;
+    
+    /*******************************************************
+    * Does the same reusing the memory in 'block_scratch'. *
+    *******************************************************/
+    void decompress_block(block_format::block_type type,
+                          const int8_t* payload,
+                          size_t payload_length,
+                          int8_t* text,
+                          size_t length,
+                          scratch& block_scratch) const;
+    
+    /************************************************************************
+    * Makes the decompressor add its stage times and sizes to 'statistics'. *
+    * Passing null stops the collection.                                    *
+    ************************************************************************/
+    void set_statistics(pipeline_statistics* statistics);
+    
+    /***********************************************************************
+    * Makes the decompressor decode the blocks coded with 'dictionary'.    *
+    * Passing null makes such blocks fail. The dictionary must outlive the *
+    * decompression.                                                       *
+    ***********************************************************************/
+    void set_dictionary(const huffman_dictionary* dictionary);
+    
+private:
+    
+    // Where to report the stage times, or null:
+    pipeline_statistics* statistics;
+    
+    // The shared code table, or null:
+    const huffman_dictionary* dictionary;
+    
+    // The scratch of each worker of the pool decompressing the blocks, kept
+    // from call to call:
+    std::vector<scratch> worker_scratch;
+    
+    // Writes the decoded 'text' timing the write:
+    void write_output(std::ostream& out,
+                      const std::vector<int8_t>& text) const;
+    
+    // Decompresses the blocks following the stream header:
+    void decompress_blocks(std::istream& in,
+                           std::ostream& out,
+                           size_t block_size,
+                           uint8_t flags);
+    
+    // Checks that the lengths at the start of 'block' match the index entry
+    // 'e' and returns the number of the bytes they take with the type byte:
+    size_t read_indexed_block_header(const int8_t* block,
+                                     const block_index::entry& e) const;
+    
+    // Decodes the whole 'block' described by the index entry 'e':
+    void decompress_indexed_block(const int8_t* block,
+                                  const block_index::entry& e,
+                                  int8_t* text,
+                                  scratch& block_scratch) const;
+    
+    // Decodes all the blocks of 'index' one after another:
+    void decompress_indexed_blocks(const int8_t* data,
+                                   const block_index& index,
+                                   int8_t* text,
+                                   scratch& block_scratch);
+    
+    // Stores the index of the 'size' byte stream at 'data' in 'index',
+    // walking the blocks if the stream has none:
+    void locate_blocks(const int8_t* data, size_t size, block_index& index);
+    
+    // Walks the block headers of the stream 'in' positioned right after the
+    // stream header:
+    block_index scan_blocks(std::istream& in, size_t block_size);
+    
+    // Decodes the blocks of 'index' covering the 'length' characters from
+    // 'offset' and passes the characters in the range to 'write_text'.
+    // 'read_block' returns the bytes of a block. Returns the number of the
+    // characters passed:
+    uint64_t decompress_range_blocks(
+            const block_index& index,
+            uint64_t offset,
+            uint64_t length,
+            const std::function<const int8_t*(const block_index::entry&)>&
+                read_block,
+            const std::function<void(const int8_t*, size_t)>& write_text);
+    
+    // Reads the dictionary identifier of a dictionary block and checks that
+    // the dictionary is the given one:
+    void check_dictionary(const int8_t* payload,
+                          size_t payload_length,
+                          size_t& payload_index) const;
+    
+    // Copies the text of a stored block or repeats the character of a run
+    // block:
+    void decompress_uncoded_block(block_format::block_type type,
+                                  const int8_t* payload,
+                                  size_t payload_length,
+                                  int8_t* text,
+                                  size_t length) const;
+    
+    // Decodes the payload of a context Huffman block:
+    void decompress_context_block(const int8_t* payload,
+                                  size_t payload_length,
+                                  int8_t* text,
+                                  size_t length,
+                                  scratch& block_scratch) const;
+    
+    // Decodes the payload of an LZ77 block:
+    void decompress_lz77_block(const int8_t* payload,
+                               size_t payload_length,
+                               int8_t* text,
+                               size_t length,
+                               scratch& block_scratch) const;
+    
+    // Decodes the payload of an adaptive Huffman block:
+    void decompress_adaptive_block(const int8_t* payload,
+                                   size_t payload_length,
+                                   int8_t* text,
+                                   size_t length) const;
+    
+    // Adds the sizes of a stream decompressed from memory to the statistics:
+    void add_mapped_sizes(size_t size, const block_index& index) const;
+};
+
+#endif // BLOCK_DECOMPRESSOR_HPP
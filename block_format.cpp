@@ -0,0 +1,23 @@
+#include "block_format.hpp"
+
+const int8_t block_format::MAGIC[4] = { (int8_t) 0xC0,
+                                        (int8_t) 0xDE,
+                                        (int8_t) 0x0D,
+                                        (int8_t) 0xE3 };
+
+const int8_t block_format::INDEX_MAGIC[4] = { (int8_t) 0xC0,
+                                              (int8_t) 0xDE,
+                                              (int8_t) 0x0D,
+                                              (int8_t) 0xE4 };
+
+const size_t block_format::MIN_BLOCK_SIZE_LOG2     = 17;
+const size_t block_format::MAX_BLOCK_SIZE_LOG2     = 22;
+const size_t block_format::DEFAULT_BLOCK_SIZE_LOG2 = 20;
+const size_t block_format::STREAM_HEADER_SIZE      = 6;
+const size_t block_format::MAX_PAYLOAD_OVERHEAD    = 1024;
+const size_t block_format::INDEX_FOOTER_SIZE       = 8;
+const size_t block_format::MIN_INTERLEAVED_STREAMS = 2;
+const size_t block_format::MAX_INTERLEAVED_STREAMS = 8;
+const size_t block_format::MAX_CONTEXT_TABLES      = 8;
+
+const uint8_t block_format::HAS_BLOCK_INDEX = 0x01;
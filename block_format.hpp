@@ -0,0 +1,99 @@
+#ifndef BLOCK_FORMAT_HPP
+#define BLOCK_FORMAT_HPP
+
+#include <cstdint>
+#include <cstdlib>
+
+/******************************************************************************
+* The constants of the block format. A stream starts with the magic, the      *
+* base two logarithm of the maximum block size and a byte of flags. Then come *
+* the blocks, each starting with a block type byte. All the blocks but the    *
+* end of stream continue with the varint number of the characters in the      *
+* block, the varint payload length and the payload itself. Each block is      *
+* coded independently of the others.                                          *
+*                                                                             *
+* If the stream has the 'HAS_BLOCK_INDEX' flag, the end of stream block is    *
+* followed by the block index: the varint number of blocks and, for each      *
+* block, the varint number of its bytes in the stream and the varint number   *
+* of the characters in it. The index is closed by a footer of the 32-bit      *
+* little-endian byte length of the index followed by 'INDEX_MAGIC', so that   *
+* it can be located from the end of the stream.                               *
+******************************************************************************/
+class block_format {
+public:
+    
+    static const int8_t MAGIC[4];
+    static const int8_t INDEX_MAGIC[4];
+    
+    static const size_t MIN_BLOCK_SIZE_LOG2;
+    static const size_t MAX_BLOCK_SIZE_LOG2;
+    static const size_t DEFAULT_BLOCK_SIZE_LOG2;
+    
+    // The bytes of a stream header:
+    static const size_t STREAM_HEADER_SIZE;
+    
+    // The number of bytes a payload may exceed the block size with:
+    static const size_t MAX_PAYLOAD_OVERHEAD;
+    
+    // The numbers of streams of an interleaved block:
+    static const size_t MIN_INTERLEAVED_STREAMS;
+    static const size_t MAX_INTERLEAVED_STREAMS;
+    
+    // The most code tables of a context block:
+    static const size_t MAX_CONTEXT_TABLES;
+    
+    // The bytes of the footer closing the block index:
+    static const size_t INDEX_FOOTER_SIZE;
+    
+    // The stream flags:
+    static const uint8_t HAS_BLOCK_INDEX;
+    
+    enum block_type : uint8_t {
+        
+        // Terminates the stream. Has no length nor payload.
+        END_OF_STREAM = 0,
+        
+        // The payload holds the code word lengths in the layout of the version
+        // 2 format, the varint number of encoded bits and the encoded bits.
+        HUFFMAN_BLOCK = 1,
+        
+        // The payload holds the code word lengths as above, a byte with the
+        // number of streams, the varint number of bits of each stream and
+        // the streams, each starting at a byte boundary. The character at
+        // index 'i' is in the stream 'i % number of streams'.
+        INTERLEAVED_HUFFMAN_BLOCK = 2,
+        
+        // The payload holds the 32-bit little-endian identifier of the
+        // dictionary the block is coded with, a byte with the number of
+        // streams and then the numbers of bits and the streams as above.
+        DICTIONARY_HUFFMAN_BLOCK = 3,
+        
+        // The payload holds the varint number of bits and the text coded
+        // with the adaptive Huffman code, which needs no code table.
+        ADAPTIVE_HUFFMAN_BLOCK = 4,
+        
+        // The payload holds the text as is. Chosen for the text the code
+        // would not shrink, such as already compressed data.
+        STORED_BLOCK = 5,
+        
+        // The payload holds the single character the whole block repeats.
+        RUN_BLOCK = 6,
+        
+        // The payload holds a byte with the number of tables, the table of
+        // each previous character context as runs of a table byte and a
+        // varint run length, the code word lengths of each table as above,
+        // the varint number of encoded bits and the encoded bits.
+        CONTEXT_HUFFMAN_BLOCK = 7,
+        
+        // The text as LZ77 sequences. Each sequence is the code of its
+        // number of literals and, unless it is the last one, the codes of
+        // its match length and distance. The payload holds the varint
+        // numbers of the literals and the codes, the code word lengths of
+        // the literals unless there are none and of the codes as above, the
+        // varint numbers of bits of the literals, the codes and the extra
+        // bits of the codes, and these three streams.
+        LZ77_HUFFMAN_BLOCK = 8
+    };
+};
+
+#endif // BLOCK_FORMAT_HPP
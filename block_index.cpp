@@ -0,0 +1,277 @@
+#include "block_format.hpp"
+#include "block_index.hpp"
+#include "file_format_error.h"
+#include "varint.hpp"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+block_index::block_index()
+:
+    next_compressed_offset{block_format::STREAM_HEADER_SIZE},
+    next_decompressed_offset{0}
+{}
+
+void block_index::add_block(uint64_t compressed_size,
+                            uint64_t decompressed_size)
+{
+    entry e;
+    e.compressed_offset   = next_compressed_offset;
+    e.compressed_size     = compressed_size;
+    e.decompressed_offset = next_decompressed_offset;
+    e.decompressed_size   = decompressed_size;
+    entries.push_back(e);
+    
+    next_compressed_offset   += compressed_size;
+    next_decompressed_offset += decompressed_size;
+}
+
+void block_index::clear()
+{
+    entries.clear();
+    next_compressed_offset = block_format::STREAM_HEADER_SIZE;
+    next_decompressed_offset = 0;
+}
+
+size_t block_index::number_of_blocks() const
+{
+    return entries.size();
+}
+
+const block_index::entry& block_index::get_entry(size_t block_number) const
+{
+    return entries.at(block_number);
+}
+
+uint64_t block_index::get_decompressed_size() const
+{
+    return next_decompressed_offset;
+}
+
+size_t block_index::find_block(uint64_t decompressed_offset) const
+{
+    if (decompressed_offset >= next_decompressed_offset)
+    {
+        throw std::out_of_range{"The offset is past the end of the text."};
+    }
+    
+    // Find the first block starting after the offset:
+    std::vector<entry>::const_iterator next =
+        std::upper_bound(entries.begin(),
+                         entries.end(),
+                         decompressed_offset,
+                         [](uint64_t offset, const entry& e) {
+                             return offset < e.decompressed_offset;
+                         });
+    
+    return (size_t)(next - entries.begin()) - 1;
+}
+
+uint64_t block_index::get_end_of_blocks_offset() const
+{
+    return next_compressed_offset;
+}
+
+void block_index::append_body(std::vector<int8_t>& output) const
+{
+    append_varint(entries.size(), output);
+    
+    for (const entry& e : entries)
+    {
+        append_varint(e.compressed_size, output);
+        append_varint(e.decompressed_size, output);
+    }
+}
+
+void block_index::append_trailer(std::vector<int8_t>& output) const
+{
+    size_t body_start = output.size();
+    append_body(output);
+    uint32_t body_length = (uint32_t)(output.size() - body_start);
+    
+    for (size_t i = 0; i != 4; ++i)
+    {
+        output.push_back((int8_t)(body_length >> (8 * i)));
+    }
+    
+    for (int8_t magic_byte : block_format::INDEX_MAGIC)
+    {
+        output.push_back(magic_byte);
+    }
+}
+
+// The smallest stream holds the header, the end of stream block, the varint
+// zero block count and the footer:
+static const uint64_t MIN_STREAM_SIZE = block_format::STREAM_HEADER_SIZE + 2
+                                      + block_format::INDEX_FOOTER_SIZE;
+
+block_index block_index::read_trailer(std::istream& in,
+                                      uint64_t stream_start,
+                                      size_t block_size)
+{
+    in.seekg(0, std::ios::end);
+    uint64_t stream_end = (uint64_t) in.tellg();
+    
+    if (!in || stream_end < stream_start + MIN_STREAM_SIZE)
+    {
+        throw file_format_error{"The stream is too short to contain the "
+                                "block index."};
+    }
+    
+    int8_t footer[block_format::INDEX_FOOTER_SIZE];
+    in.seekg(stream_end - sizeof(footer));
+    in.read((char*) footer, sizeof(footer));
+    
+    if ((size_t) in.gcount() != sizeof(footer))
+    {
+        throw file_format_error{"Could not read the block index footer."};
+    }
+    
+    uint64_t stream_size = stream_end - stream_start;
+    uint64_t body_length = parse_footer(footer, stream_size);
+    uint64_t body_offset = stream_size - sizeof(footer) - body_length;
+    std::vector<int8_t> body(body_length);
+    in.seekg(stream_start + body_offset);
+    in.read((char*) body.data(), body.size());
+    
+    if ((size_t) in.gcount() != body.size())
+    {
+        throw file_format_error{"Could not read the block index."};
+    }
+    
+    block_index index;
+    index.parse_body(body.data(), body.size(), body_offset, block_size);
+    return index;
+}
+
+block_index block_index::read_trailer(const int8_t* stream,
+                                      size_t stream_size,
+                                      size_t block_size)
+{
+    block_index index;
+    index.load_trailer(stream, stream_size, block_size);
+    return index;
+}
+
+void block_index::load_trailer(const int8_t* stream,
+                               size_t stream_size,
+                               size_t block_size)
+{
+    if (stream_size < MIN_STREAM_SIZE)
+    {
+        throw file_format_error{"The stream is too short to contain the "
+                                "block index."};
+    }
+    
+    const int8_t* footer = stream + stream_size
+                                  - block_format::INDEX_FOOTER_SIZE;
+    uint64_t body_length = parse_footer(footer, stream_size);
+    uint64_t body_offset = stream_size - block_format::INDEX_FOOTER_SIZE
+                                       - body_length;
+    parse_body(stream + body_offset, body_length, body_offset, block_size);
+}
+
+uint64_t block_index::parse_footer(const int8_t* footer, uint64_t stream_size)
+{
+    for (size_t i = 0; i != sizeof(block_format::INDEX_MAGIC); ++i)
+    {
+        if (footer[4 + i] != block_format::INDEX_MAGIC[i])
+        {
+            throw file_format_error{"Bad block index signature."};
+        }
+    }
+    
+    uint64_t body_length = 0;
+    
+    for (size_t i = 0; i != 4; ++i)
+    {
+        body_length |= (uint64_t)(uint8_t) footer[i] << (8 * i);
+    }
+    
+    if (body_length > stream_size - MIN_STREAM_SIZE + 1)
+    {
+        throw file_format_error{"Bad block index length."};
+    }
+    
+    return body_length;
+}
+
+void block_index::parse_body(const int8_t* body,
+                             size_t body_length,
+                             uint64_t body_offset,
+                             size_t block_size)
+{
+    const uint64_t max_block_bytes = block_size
+                                   + block_format::MAX_PAYLOAD_OVERHEAD
+                                   + 1 + 2 * MAX_VARINT_BYTES;
+    size_t body_index = 0;
+    clear();
+    
+    try
+    {
+        uint64_t number_of_blocks = extract_varint(body,
+                                                   body_length,
+                                                   body_index);
+        
+        // Each block takes at least two bytes of the index:
+        if (number_of_blocks > body_length / 2)
+        {
+            throw file_format_error{"Bad number of blocks in the index."};
+        }
+        
+        for (uint64_t i = 0; i != number_of_blocks; ++i)
+        {
+            uint64_t compressed_size = extract_varint(body,
+                                                      body_length,
+                                                      body_index);
+            uint64_t decompressed_size = extract_varint(body,
+                                                        body_length,
+                                                        body_index);
+            
+            if (compressed_size == 0 || compressed_size > max_block_bytes ||
+                decompressed_size == 0 || decompressed_size > block_size)
+            {
+                std::stringstream ss;
+                ss << "Bad block index entry " << i << ".";
+                std::string err_msg = ss.str();
+                throw file_format_error{err_msg.c_str()};
+            }
+            
+            add_block(compressed_size, decompressed_size);
+        }
+    }
+    catch (std::out_of_range& error)
+    {
+        throw file_format_error{"The block index is truncated."};
+    }
+    
+    // The blocks and the end of stream block must end where the index
+    // starts:
+    if (body_index != body_length ||
+        next_compressed_offset + 1 != body_offset)
+    {
+        throw file_format_error{"The block index does not match the "
+                                "stream."};
+    }
+}
+
+bool block_index::operator==(const block_index& other) const
+{
+    if (entries.size() != other.entries.size())
+    {
+        return false;
+    }
+    
+    for (size_t i = 0; i != entries.size(); ++i)
+    {
+        if (entries[i].compressed_size != other.entries[i].compressed_size ||
+            entries[i].decompressed_size !=
+                other.entries[i].decompressed_size)
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
@@ -0,0 +1,128 @@
+#ifndef BLOCK_INDEX_HPP
+#define BLOCK_INDEX_HPP
+
+#include <cstdint>
+#include <istream>
+#include <vector>
+
+/******************************************************************************
+* The index of the blocks of a block stream. Knows where each block starts in *
+* the stream and where its characters go in the decompressed text.            *
+******************************************************************************/
+class block_index {
+public:
+    
+    struct entry {
+        
+        // The position of the block type byte relative to the stream start:
+        uint64_t compressed_offset;
+        
+        // The bytes of the block including its type byte and lengths:
+        uint64_t compressed_size;
+        
+        // The position of the first character of the block in the text:
+        uint64_t decompressed_offset;
+        
+        // The number of characters in the block:
+        uint64_t decompressed_size;
+    };
+    
+    /**************************************
+    * Constructs an index with no blocks. *
+    **************************************/
+    block_index();
+    
+    /***********************************************
+    * Adds the block following the last added one. *
+    ***********************************************/
+    void add_block(uint64_t compressed_size, uint64_t decompressed_size);
+    
+    /***************************************************************
+    * Removes all the blocks keeping the memory for the next ones. *
+    ***************************************************************/
+    void clear();
+    
+    /********************************************
+    * Returns the number of the indexed blocks. *
+    ********************************************/
+    size_t number_of_blocks() const;
+    
+    /*************************************************
+    * Returns the entry of the block 'block_number'. *
+    *************************************************/
+    const entry& get_entry(size_t block_number) const;
+    
+    /*****************************************************
+    * Returns the length of the whole decompressed text. *
+    *****************************************************/
+    uint64_t get_decompressed_size() const;
+    
+    /***********************************************************************
+    * Returns the number of the block holding the character at             *
+    * 'decompressed_offset' of the text. Throws 'std::out_of_range' if the *
+    * offset is past the end of the text.                                  *
+    ***********************************************************************/
+    size_t find_block(uint64_t decompressed_offset) const;
+    
+    /***********************************************************************
+    * Returns the offset of the end of stream block relative to the stream *
+    * start.                                                               *
+    ***********************************************************************/
+    uint64_t get_end_of_blocks_offset() const;
+    
+    /************************************************
+    * Appends the index and its footer to 'output'. *
+    ************************************************/
+    void append_trailer(std::vector<int8_t>& output) const;
+    
+    /*************************************************************************
+    * Reads the index from the end of the seekable stream 'in' whose header  *
+    * starts at 'stream_start'. The blocks are checked to fill the stream up *
+    * to the index; none of them may hold more than 'block_size' characters. *
+    *************************************************************************/
+    static block_index read_trailer(std::istream& in,
+                                    uint64_t stream_start,
+                                    size_t block_size);
+    
+    /************************************************************************
+    * Reads the index from the end of the 'stream_size' bytes of the stream *
+    * starting at 'stream', checking it in the same way.                    *
+    ************************************************************************/
+    static block_index read_trailer(const int8_t* stream,
+                                    size_t stream_size,
+                                    size_t block_size);
+    
+    /***********************************************************************
+    * Replaces the blocks of this index with the ones 'read_trailer' reads *
+    * from the same stream, reusing the memory of this index.              *
+    ***********************************************************************/
+    void load_trailer(const int8_t* stream,
+                      size_t stream_size,
+                      size_t block_size);
+    
+    bool operator==(const block_index& other) const;
+    
+private:
+    
+    std::vector<entry> entries;
+    
+    // Where the next block starts in the stream and in the text:
+    uint64_t next_compressed_offset;
+    uint64_t next_decompressed_offset;
+    
+    // Appends the index without its footer:
+    void append_body(std::vector<int8_t>& output) const;
+    
+    // Checks the footer of a 'stream_size' byte stream and returns the length
+    // of the index body it describes:
+    static uint64_t parse_footer(const int8_t* footer, uint64_t stream_size);
+    
+    // Replaces the blocks with the ones of the index body found
+    // 'body_offset' bytes into the stream:
+    void parse_body(const int8_t* body,
+                    size_t body_length,
+                    uint64_t body_offset,
+                    size_t block_size);
+};
+
+#endif // BLOCK_INDEX_HPP
@@ -1,20 +1,121 @@
-#include "huffman_tree.hpp"
+#include "byte_counts.hpp"
 #include <cstdint>
+#include <cstring>
 #include <map>
 #include <vector>
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 using std::map;
 using std::vector;
 
+// The number of interleaved counter lanes:
+static const size_t NUMBER_OF_LANES = 8;
+
 std::map<int8_t, uint32_t> compute_byte_counts(std::vector<int8_t>& text)
 {
-    std::map<int8_t, uint32_t> map;
+    return compute_byte_histogram(text).to_count_map();
+}
+
+histogram compute_byte_histogram(const std::vector<int8_t>& text)
+{
+    return compute_byte_histogram(text.data(), text.size());
+}
+
+// Sums the lanes into 'counts':
+static void merge_lanes(
+        const uint32_t lanes[NUMBER_OF_LANES][histogram::NUMBER_OF_CHARACTERS],
+        uint32_t counts[histogram::NUMBER_OF_CHARACTERS])
+{
+#ifdef __AVX2__
+    for (size_t i = 0; i != histogram::NUMBER_OF_CHARACTERS; i += 8)
+    {
+        __m256i sum = _mm256_loadu_si256((const __m256i*) &lanes[0][i]);
+        
+        for (size_t lane = 1; lane != NUMBER_OF_LANES; ++lane)
+        {
+            sum = _mm256_add_epi32(
+                    sum,
+                    _mm256_loadu_si256((const __m256i*) &lanes[lane][i]));
+        }
+        
+        _mm256_storeu_si256((__m256i*) &counts[i], sum);
+    }
+#else
+    for (size_t i = 0; i != histogram::NUMBER_OF_CHARACTERS; ++i)
+    {
+        uint32_t sum = 0;
+        
+        for (size_t lane = 0; lane != NUMBER_OF_LANES; ++lane)
+        {
+            sum += lanes[lane][i];
+        }
+        
+        counts[i] = sum;
+    }
+#endif
+}
+
+// Counts the eight bytes of 'word' into the lanes:
+static inline void count_word(
+        uint32_t lanes[NUMBER_OF_LANES][histogram::NUMBER_OF_CHARACTERS],
+        uint64_t word)
+{
+    lanes[0][(uint8_t)  word       ]++;
+    lanes[1][(uint8_t) (word >>  8)]++;
+    lanes[2][(uint8_t) (word >> 16)]++;
+    lanes[3][(uint8_t) (word >> 24)]++;
+    lanes[4][(uint8_t) (word >> 32)]++;
+    lanes[5][(uint8_t) (word >> 40)]++;
+    lanes[6][(uint8_t) (word >> 48)]++;
+    lanes[7][(uint8_t) (word >> 56)]++;
+}
+
+histogram compute_byte_histogram(const int8_t* text, size_t length)
+{
+    uint32_t lanes[NUMBER_OF_LANES][histogram::NUMBER_OF_CHARACTERS] = {};
+    const uint8_t* bytes = (const uint8_t*) text;
+    size_t index = 0;
+    
+    for (; index + 2 * sizeof(uint64_t) <= length;
+           index += 2 * sizeof(uint64_t))
+    {
+        uint64_t word1;
+        uint64_t word2;
+        std::memcpy(&word1, bytes + index, sizeof(uint64_t));
+        std::memcpy(&word2, bytes + index + sizeof(uint64_t), sizeof(uint64_t));
+        count_word(lanes, word1);
+        count_word(lanes, word2);
+    }
+    
+    for (; index != length; ++index)
+    {
+        lanes[0][bytes[index]]++;
+    }
     
-    for (auto byte : text)
+    uint32_t counts[histogram::NUMBER_OF_CHARACTERS];
+    merge_lanes(lanes, counts);
+    
+    histogram ret;
+    
+    for (size_t i = 0; i != histogram::NUMBER_OF_CHARACTERS; ++i)
     {
-        map[byte] += 1;
+        ret.set_count((int8_t) i, counts[i]);
     }
     
-    return map;
+    return ret;
 }
 
+histogram compute_byte_histogram_reference(const int8_t* text, size_t length)
+{
+    histogram counts;
+    
+    for (size_t index = 0; index != length; ++index)
+    {
+        counts.increment(text[index]);
+    }
+    
+    return counts;
+}
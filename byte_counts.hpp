@@ -3,9 +3,11 @@
 #ifndef BYTE_COUNTS_HPP
 #define BYTE_COUNTS_HPP
 
+#include "histogram.hpp"
 #include "huffman_tree.hpp"
 #include <cstdint>
 #include <map>
+#include <vector>
 
 /***********************************************************************
 * Counts relative frequencies of each character represented by a byte. *
@@ -13,4 +15,22 @@
 std::map<int8_t, uint32_t>
 compute_byte_counts(std::vector<int8_t>& text);
 
+/************************************************************************
+* Counts the occurrences of each byte value in 'text' into a histogram. *
+************************************************************************/
+histogram compute_byte_histogram(const std::vector<int8_t>& text);
+
+/******************************************************************************
+* Counts the occurrences of each byte value in the 'length' bytes starting at *
+* 'text'. Reads 64 bits at a time and counts into several interleaved lanes,  *
+* so that consecutive increments of the same byte value do not wait for each  *
+* other, and merges the lanes at the end.                                     *
+******************************************************************************/
+histogram compute_byte_histogram(const int8_t* text, size_t length);
+
+/***************************************************************************
+* The byte-at-a-time reference implementation of 'compute_byte_histogram'. *
+***************************************************************************/
+histogram compute_byte_histogram_reference(const int8_t* text, size_t length);
+
 #endif // BYTE_WEIGHTS_HPP
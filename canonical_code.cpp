@@ -0,0 +1,81 @@
+#include "canonical_code.hpp"
+#include "file_format_error.h"
+#include <sstream>
+#include <string>
+
+static uint64_t reverse_bits(uint64_t bits, size_t length)
+{
+    uint64_t reversed = 0;
+    
+    for (size_t i = 0; i != length; ++i)
+    {
+        reversed = (reversed << 1) | ((bits >> i) & 1);
+    }
+    
+    return reversed;
+}
+
+void assign_canonical_code_words(code_table& table)
+{
+    const size_t max_length = code_table::MAX_CODE_WORD_LENGTH;
+    uint64_t length_counts[max_length + 1] = {};
+    uint64_t kraft_sum = 0;
+    
+    for (size_t value = 0; value != code_table::NUMBER_OF_CHARACTERS; ++value)
+    {
+        size_t length = table.get_length((int8_t) value);
+        
+        if (length == 0)
+        {
+            continue;
+        }
+        
+        if (length > max_length)
+        {
+            std::stringstream ss;
+            ss << "Bad code word length: " << length << ".";
+            std::string err_msg = ss.str();
+            throw file_format_error{err_msg.c_str()};
+        }
+        
+        length_counts[length]++;
+        kraft_sum += 1ULL << (max_length - length);
+        
+        if (kraft_sum > (1ULL << max_length))
+        {
+            throw file_format_error{"The code word lengths do not describe "
+                                    "a prefix code."};
+        }
+    }
+    
+    // Compute the first code word of each length:
+    uint64_t next_code_word[max_length + 1] = {};
+    uint64_t code_word = 0;
+    
+    for (size_t length = 1; length <= max_length; ++length)
+    {
+        code_word = (code_word + length_counts[length - 1]) << 1;
+        next_code_word[length] = code_word;
+    }
+    
+    // Visit the characters in the order of their unsigned values:
+    for (size_t value = 0; value != code_table::NUMBER_OF_CHARACTERS; ++value)
+    {
+        size_t length = table.get_length((int8_t) value);
+        
+        if (length != 0)
+        {
+            table.set_code_word((int8_t) value,
+                                reverse_bits(next_code_word[length]++, length),
+                                length);
+        }
+    }
+}
+
+std::map<int8_t, bit_string>
+infer_canonical_encoder_map(const std::map<int8_t, uint8_t>& code_length_map)
+{
+    code_table table(code_length_map);
+    assign_canonical_code_words(table);
+    return table.to_encoder_map();
+}
@@ -0,0 +1,24 @@
+#ifndef CANONICAL_CODE_HPP
+#define CANONICAL_CODE_HPP
+
+#include "bit_string.hpp"
+#include "code_table.hpp"
+#include <cstdint>
+#include <map>
+
+/******************************************************************************
+* Replaces the code words in 'table' with the canonical code words of the     *
+* same lengths. The code words are ordered by length and then by the unsigned *
+* value of the character. Each code word holds its first bit at the lowest    *
+* position, which is the order the bits are appended to the encoded text.     *
+* Throws 'file_format_error' if the lengths do not describe a prefix code.    *
+******************************************************************************/
+void assign_canonical_code_words(code_table& table);
+
+/***************************************************************************
+* Builds the encoder map of the canonical code words for the code lengths. *
+***************************************************************************/
+std::map<int8_t, bit_string>
+infer_canonical_encoder_map(const std::map<int8_t, uint8_t>& code_length_map);
+
+#endif // CANONICAL_CODE_HPP
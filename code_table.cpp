@@ -0,0 +1,115 @@
+#include "code_table.hpp"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+code_table::code_table()
+:
+    bits{},
+    lengths{}
+{}
+
+code_table::code_table(const std::map<int8_t, bit_string>& encoder_map)
+:
+    bits{},
+    lengths{}
+{
+    for (const auto& entry : encoder_map)
+    {
+        const bit_string& code_word = entry.second;
+        uint64_t code_word_bits = 0;
+        
+        if (code_word.length() > MAX_CODE_WORD_LENGTH)
+        {
+            std::stringstream ss;
+            ss << "The code word is too long: " << code_word.length() << ".";
+            throw std::runtime_error{ss.str()};
+        }
+        
+        for (size_t i = 0; i != code_word.length(); ++i)
+        {
+            if (code_word.read_bit(i))
+            {
+                code_word_bits |= 1ULL << i;
+            }
+        }
+        
+        set_code_word(entry.first, code_word_bits, code_word.length());
+    }
+}
+
+code_table::code_table(const std::map<int8_t, uint8_t>& code_length_map)
+:
+    bits{},
+    lengths{}
+{
+    for (const auto& entry : code_length_map)
+    {
+        set_code_word(entry.first, 0, entry.second);
+    }
+}
+
+void code_table::set_code_word(int8_t character, uint64_t code_word_bits,
+                               size_t length)
+{
+    bits[(uint8_t) character]    = code_word_bits;
+    lengths[(uint8_t) character] = (uint8_t) length;
+}
+
+size_t code_table::number_of_code_words() const
+{
+    return NUMBER_OF_CHARACTERS - std::count(lengths,
+                                             lengths + NUMBER_OF_CHARACTERS,
+                                             0);
+}
+
+size_t code_table::max_length() const
+{
+    return *std::max_element(lengths, lengths + NUMBER_OF_CHARACTERS);
+}
+
+std::map<int8_t, bit_string> code_table::to_encoder_map() const
+{
+    std::map<int8_t, bit_string> encoder_map;
+    
+    for (size_t i = 0; i != NUMBER_OF_CHARACTERS; ++i)
+    {
+        if (lengths[i] == 0)
+        {
+            continue;
+        }
+        
+        bit_string code_word;
+        
+        for (size_t bit = 0; bit != lengths[i]; ++bit)
+        {
+            code_word.append_bit(((bits[i] >> bit) & 1) != 0);
+        }
+        
+        encoder_map[(int8_t) i] = std::move(code_word);
+    }
+    
+    return encoder_map;
+}
+
+std::map<int8_t, uint8_t> code_table::to_code_length_map() const
+{
+    std::map<int8_t, uint8_t> code_length_map;
+    
+    for (size_t i = 0; i != NUMBER_OF_CHARACTERS; ++i)
+    {
+        if (lengths[i] != 0)
+        {
+            code_length_map[(int8_t) i] = lengths[i];
+        }
+    }
+    
+    return code_length_map;
+}
+
+bool code_table::operator==(const code_table& other) const
+{
+    return std::equal(bits, bits + NUMBER_OF_CHARACTERS, other.bits) &&
+           std::equal(lengths, lengths + NUMBER_OF_CHARACTERS, other.lengths);
+}
@@ -0,0 +1,84 @@
+#ifndef CODE_TABLE_HPP
+#define CODE_TABLE_HPP
+
+#include "bit_string.hpp"
+#include <cstdint>
+#include <map>
+
+class code_table {
+public:
+    
+    constexpr static size_t NUMBER_OF_CHARACTERS = 256;
+    constexpr static size_t MAX_CODE_WORD_LENGTH = 57;
+    
+    /*****************************************
+    * Constructs a table with no code words. *
+    *****************************************/
+    code_table();
+    
+    /******************************************************************
+    * Constructs the table holding the code words of the encoder map. *
+    ******************************************************************/
+    explicit code_table(const std::map<int8_t, bit_string>& encoder_map);
+    
+    /**************************************************************************
+    * Constructs the table holding the code word lengths of the map. The bits *
+    * of the code words are left zero.                                        *
+    **************************************************************************/
+    explicit code_table(const std::map<int8_t, uint8_t>& code_length_map);
+    
+    /***********************************************************************
+    * Sets the code word of 'character'. The first bit of the code word is *
+    * the lowest bit of 'bits'.                                            *
+    ***********************************************************************/
+    void set_code_word(int8_t character, uint64_t bits, size_t length);
+    
+    /****************************************************
+    * Returns the bits of the code word of 'character'. *
+    ****************************************************/
+    uint64_t get_bits(int8_t character) const
+    {
+        return bits[(uint8_t) character];
+    }
+    
+    /*********************************************************************
+    * Returns the length of the code word of 'character', or zero if the *
+    * character has no code word.                                        *
+    *********************************************************************/
+    size_t get_length(int8_t character) const
+    {
+        return lengths[(uint8_t) character];
+    }
+    
+    /**********************************************************
+    * Returns the number of characters that have a code word. *
+    **********************************************************/
+    size_t number_of_code_words() const;
+    
+    /***********************************************
+    * Returns the length of the longest code word. *
+    ***********************************************/
+    size_t max_length() const;
+    
+    /********************************************************
+    * Returns the map from each character to its code word. *
+    ********************************************************/
+    std::map<int8_t, bit_string> to_encoder_map() const;
+    
+    /**********************************************************************
+    * Returns the map from each character to the length of its code word. *
+    **********************************************************************/
+    std::map<int8_t, uint8_t> to_code_length_map() const;
+    
+    bool operator==(const code_table& other) const;
+    
+private:
+    
+    // The code words indexed by the unsigned character values:
+    uint64_t bits[NUMBER_OF_CHARACTERS];
+    
+    // The code word lengths indexed by the unsigned character values:
+    uint8_t lengths[NUMBER_OF_CHARACTERS];
+};
+
+#endif // CODE_TABLE_HPP
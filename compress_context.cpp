@@ -0,0 +1,53 @@
+#include "compress_context.hpp"
+
+compress_context::compress_context(size_t block_size_log2,
+                                   size_t number_of_streams,
+                                   size_t max_code_length)
+:
+    compressor{block_size_log2, number_of_streams, max_code_length}
+{}
+
+size_t compress_context::compress(const int8_t* text,
+                                  size_t length,
+                                  int8_t* output,
+                                  size_t capacity)
+{
+    return compressor.compress(text, length, output, capacity, block_scratch);
+}
+
+size_t compress_context::compress_bound(size_t length) const
+{
+    return compressor.compress_bound(length);
+}
+
+void compress_context::reset()
+{
+    for (std::vector<uint64_t>& words : block_scratch.stream_words)
+    {
+        words.clear();
+    }
+    
+    block_scratch.payload_header.clear();
+    block_scratch.block.clear();
+    block_scratch.index.clear();
+}
+
+void compress_context::set_statistics(pipeline_statistics* statistics)
+{
+    compressor.set_statistics(statistics);
+}
+
+void compress_context::set_dictionary(const huffman_dictionary* dictionary)
+{
+    compressor.set_dictionary(dictionary);
+}
+
+void compress_context::set_codec(block_compressor::codec block_codec)
+{
+    compressor.set_codec(block_codec);
+}
+
+void compress_context::set_lz77_level(size_t level)
+{
+    compressor.set_lz77_level(level);
+}
@@ -0,0 +1,78 @@
+#ifndef COMPRESS_CONTEXT_HPP
+#define COMPRESS_CONTEXT_HPP
+
+#include "block_compressor.hpp"
+#include <cstdint>
+
+/****************************************************************************
+* A compressor for many messages in a row between caller-owned buffers. The *
+* context keeps the memory of the previous calls, so that once it has grown *
+* to the largest message no call allocates any more. A context serves one   *
+* thread at a time.                                                         *
+****************************************************************************/
+class compress_context {
+public:
+    
+    /**************************************************************************
+    * Constructs a context producing the same streams as a 'block_compressor' *
+    * constructed with the same arguments.                                    *
+    **************************************************************************/
+    explicit compress_context(
+                size_t block_size_log2 = block_format::DEFAULT_BLOCK_SIZE_LOG2,
+                size_t number_of_streams = 1,
+                size_t max_code_length = code_table::MAX_CODE_WORD_LENGTH);
+    
+    compress_context(const compress_context&) = delete;
+    compress_context& operator=(const compress_context&) = delete;
+    
+    /***********************************************************************
+    * Compresses the 'length' bytes starting at 'text' into the 'capacity' *
+    * byte buffer at 'output' and returns the length of the stream. Throws *
+    * 'std::invalid_argument' if the stream does not fit.                  *
+    ***********************************************************************/
+    size_t compress(const int8_t* text,
+                    size_t length,
+                    int8_t* output,
+                    size_t capacity);
+    
+    /**********************************************************************
+    * Returns the maximum length of the stream compressing 'length' bytes *
+    * produces.                                                           *
+    **********************************************************************/
+    size_t compress_bound(size_t length) const;
+    
+    /********************************************************************
+    * Forgets everything left from the previous calls while keeping the *
+    * memory, so that the next call starts as on a fresh context.       *
+    ********************************************************************/
+    void reset();
+    
+    /*******************************************************************
+    * Makes the context add its stage times and sizes to 'statistics'. *
+    * Passing null stops the collection.                               *
+    *******************************************************************/
+    void set_statistics(pipeline_statistics* statistics);
+    
+    /************************************************************************
+    * Makes the context code the blocks with 'dictionary', or stop doing so *
+    * if it is null. The dictionary must outlive the context.               *
+    ************************************************************************/
+    void set_dictionary(const huffman_dictionary* dictionary);
+    
+    /********************************************************
+    * Makes the context code the blocks with 'block_codec'. *
+    ********************************************************/
+    void set_codec(block_compressor::codec block_codec);
+    
+    /*****************************************************************
+    * Sets the effort level of the LZ77 match finder of the context. *
+    *****************************************************************/
+    void set_lz77_level(size_t level);
+    
+private:
+    
+    block_compressor compressor;
+    block_compressor::scratch block_scratch;
+};
+
+#endif // COMPRESS_CONTEXT_HPP
@@ -0,0 +1,252 @@
+#include "context_model.hpp"
+#include <algorithm>
+#include <cmath>
+
+// About the bits the lengths of the code words of a table take:
+static const double TABLE_COST_IN_BITS = 512.0;
+
+// The extra bits of a character a table has no code word for:
+static const double MISSING_CHARACTER_COST_IN_BITS = 8.0;
+
+context_model::context_model()
+:
+    context_counts(NUMBER_OF_CONTEXTS),
+    number_of_tables{1},
+    number_of_contexts{0}
+{
+    std::fill(context_map, context_map + NUMBER_OF_CONTEXTS, 0);
+}
+
+void context_model::count(const int8_t* text, size_t length)
+{
+    std::fill(context_counts.begin(), context_counts.end(), histogram());
+    uint8_t context = 0;
+    
+    for (size_t i = 0; i != length; ++i)
+    {
+        context_counts[context].increment(text[i]);
+        context = (uint8_t) text[i];
+    }
+}
+
+// Computes the ideal code word lengths of the characters counted in
+// 'counts':
+static void compute_ideal_lengths(const histogram& counts, double* lengths)
+{
+    double total = (double) counts.total_count();
+    double log2_total = std::log2(std::max(total, 1.0));
+    
+    for (size_t value = 0; value != histogram::NUMBER_OF_CHARACTERS; ++value)
+    {
+        uint32_t count = counts.get_count((int8_t) value);
+        lengths[value] = count == 0
+                       ? log2_total + MISSING_CHARACTER_COST_IN_BITS
+                       : log2_total - std::log2((double) count);
+    }
+}
+
+// Returns the bits the characters counted in 'counts' take with the code
+// word lengths 'lengths':
+static double compute_cost(const histogram& counts, const double* lengths)
+{
+    double cost = 0.0;
+    
+    for (size_t value = 0; value != histogram::NUMBER_OF_CHARACTERS; ++value)
+    {
+        uint32_t count = counts.get_count((int8_t) value);
+        
+        if (count != 0)
+        {
+            cost += count * lengths[value];
+        }
+    }
+    
+    return cost;
+}
+
+void context_model::cluster(size_t max_tables)
+{
+    if (max_tables == 0 || max_tables > MAX_TABLES)
+    {
+        max_tables = MAX_TABLES;
+    }
+    
+    // All the buffers are members, so that clustering allocates nothing:
+    number_of_contexts = 0;
+    
+    for (size_t context = 0; context != NUMBER_OF_CONTEXTS; ++context)
+    {
+        if (context_counts[context].total_count() != 0)
+        {
+            contexts[number_of_contexts++] = context;
+        }
+    }
+    
+    std::fill(context_map, context_map + NUMBER_OF_CONTEXTS, 0);
+    
+    if (number_of_contexts == 0)
+    {
+        number_of_tables = 1;
+        sum_table_counts();
+        return;
+    }
+    
+    // Seed the tables with the heaviest context and then, one by one, with
+    // the context the seeds so far code the worst:
+    double lengths[histogram::NUMBER_OF_CHARACTERS];
+    double own_cost[NUMBER_OF_CONTEXTS];
+    double best_cost[NUMBER_OF_CONTEXTS];
+    size_t seeds[MAX_TABLES];
+    size_t number_of_seeds = 0;
+    size_t next_seed = contexts[0];
+    
+    for (size_t i = 0; i != number_of_contexts; ++i)
+    {
+        size_t context = contexts[i];
+        compute_ideal_lengths(context_counts[context], lengths);
+        own_cost[context] = compute_cost(context_counts[context], lengths);
+        best_cost[context] = HUGE_VAL;
+        
+        if (context_counts[context].total_count() >
+            context_counts[next_seed].total_count())
+        {
+            next_seed = context;
+        }
+    }
+    
+    while (true)
+    {
+        seeds[number_of_seeds++] = next_seed;
+        compute_ideal_lengths(context_counts[next_seed], lengths);
+        double max_loss = 0.0;
+        
+        for (size_t i = 0; i != number_of_contexts; ++i)
+        {
+            size_t context = contexts[i];
+            best_cost[context] =
+                std::min(best_cost[context],
+                         compute_cost(context_counts[context], lengths));
+            
+            if (best_cost[context] - own_cost[context] > max_loss)
+            {
+                max_loss = best_cost[context] - own_cost[context];
+                next_seed = context;
+            }
+        }
+        
+        if (number_of_seeds == max_tables || max_loss <= TABLE_COST_IN_BITS)
+        {
+            break;
+        }
+    }
+    
+    for (size_t table = 0; table != number_of_seeds; ++table)
+    {
+        table_counts[table] = context_counts[seeds[table]];
+    }
+    
+    // Move each context to the table that codes it best until no context
+    // moves:
+    number_of_tables = number_of_seeds;
+    
+    for (size_t iteration = 0; iteration != 8; ++iteration)
+    {
+        for (size_t table = 0; table != number_of_tables; ++table)
+        {
+            compute_ideal_lengths(
+                table_counts[table],
+                &table_lengths[table * histogram::NUMBER_OF_CHARACTERS]);
+        }
+        
+        bool moved = false;
+        
+        for (size_t i = 0; i != number_of_contexts; ++i)
+        {
+            size_t context = contexts[i];
+            size_t best_table = 0;
+            double min_cost = HUGE_VAL;
+            
+            for (size_t table = 0; table != number_of_tables; ++table)
+            {
+                double cost = compute_cost(
+                    context_counts[context],
+                    &table_lengths[table * histogram::NUMBER_OF_CHARACTERS]);
+                
+                if (cost < min_cost)
+                {
+                    min_cost = cost;
+                    best_table = table;
+                }
+            }
+            
+            moved |= iteration == 0 || context_map[context] != best_table;
+            context_map[context] = (uint8_t) best_table;
+        }
+        
+        // Drop the tables left without contexts:
+        uint8_t renumbered[NUMBER_OF_CONTEXTS];
+        bool used[NUMBER_OF_CONTEXTS] = {};
+        
+        for (size_t i = 0; i != number_of_contexts; ++i)
+        {
+            size_t context = contexts[i];
+            used[context_map[context]] = true;
+        }
+        
+        size_t number_of_used_tables = 0;
+        
+        for (size_t table = 0; table != number_of_tables; ++table)
+        {
+            renumbered[table] = (uint8_t) number_of_used_tables;
+            number_of_used_tables += used[table];
+        }
+        
+        for (size_t i = 0; i != number_of_contexts; ++i)
+        {
+            size_t context = contexts[i];
+            context_map[context] = renumbered[context_map[context]];
+        }
+        
+        number_of_tables = number_of_used_tables;
+        sum_table_counts();
+        
+        if (!moved)
+        {
+            break;
+        }
+    }
+    
+    // The contexts that never occur continue the run of the preceding one:
+    for (size_t context = 1; context != NUMBER_OF_CONTEXTS; ++context)
+    {
+        if (context_counts[context].total_count() == 0)
+        {
+            context_map[context] = context_map[context - 1];
+        }
+    }
+}
+
+void context_model::sum_table_counts()
+{
+    std::fill(table_counts, table_counts + number_of_tables, histogram());
+    
+    for (size_t context = 0; context != NUMBER_OF_CONTEXTS; ++context)
+    {
+        table_counts[context_map[context]].add(context_counts[context]);
+    }
+}
+
+size_t context_model::get_number_of_tables() const
+{
+    return number_of_tables;
+}
+
+const uint8_t* context_model::get_context_map() const
+{
+    return context_map;
+}
+
+const histogram& context_model::get_table_counts(size_t table) const
+{
+    return table_counts[table];
+}
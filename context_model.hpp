@@ -0,0 +1,83 @@
+#ifndef CONTEXT_MODEL_HPP
+#define CONTEXT_MODEL_HPP
+
+#include "histogram.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/******************************************************************************
+* The order-1 statistics of a text: the counts of the characters following    *
+* each character, which is their context. The first character of a text has  *
+* the context 0. The contexts are clustered into a few tables, so that each   *
+* character can be coded with the code of the table of its context at the     *
+* cost of a handful of code tables.                                          *
+******************************************************************************/
+class context_model {
+public:
+    
+    constexpr static size_t NUMBER_OF_CONTEXTS = 256;
+    
+    // The most tables a clustering produces:
+    constexpr static size_t MAX_TABLES = 8;
+    
+    /******************************************
+    * Constructs the model of the empty text. *
+    ******************************************/
+    context_model();
+    
+    /************************************************************************
+    * Replaces the counts with the ones of the 'length' characters starting *
+    * at 'text'.                                                            *
+    ************************************************************************/
+    void count(const int8_t* text, size_t length);
+    
+    /**************************************************************************
+    * Groups the contexts into at most 'max_tables' tables of similar         *
+    * statistics, and into 'MAX_TABLES' tables at most. A table is only added *
+    * if it saves more bits than a code table takes. The contexts that never  *
+    * occur join the table of the preceding context, so that the context map  *
+    * consists of long runs.                                                  *
+    **************************************************************************/
+    void cluster(size_t max_tables);
+    
+    /*****************************************************************
+    * Returns the number of the tables the last clustering produced. *
+    *****************************************************************/
+    size_t get_number_of_tables() const;
+    
+    /*************************************
+    * Returns the table of each context. *
+    *************************************/
+    const uint8_t* get_context_map() const;
+    
+    /***********************************************************************
+    * Returns the counts of the characters of all the contexts of 'table'. *
+    ***********************************************************************/
+    const histogram& get_table_counts(size_t table) const;
+    
+private:
+    
+    // The counts of the characters following each context:
+    std::vector<histogram> context_counts;
+    
+    // The counts of each table, of which the first 'number_of_tables' are in
+    // use:
+    histogram table_counts[MAX_TABLES];
+    size_t number_of_tables;
+    
+    // The table of each context:
+    uint8_t context_map[NUMBER_OF_CONTEXTS];
+    
+    // The contexts that occur in the text:
+    size_t contexts[NUMBER_OF_CONTEXTS];
+    size_t number_of_contexts;
+    
+    // The ideal code word lengths of the characters of each table:
+    double table_lengths[MAX_TABLES * histogram::NUMBER_OF_CHARACTERS];
+    
+    // Sums the counts of the contexts of each table:
+    void sum_table_counts();
+};
+
+#endif // CONTEXT_MODEL_HPP
@@ -0,0 +1,35 @@
+#include "decompress_context.hpp"
+
+decompress_context::decompress_context()
+{}
+
+size_t decompress_context::decompress(const int8_t* data,
+                                      size_t size,
+                                      int8_t* text,
+                                      size_t capacity)
+{
+    return decompressor.decompress(data, size, text, capacity, block_scratch);
+}
+
+uint64_t decompress_context::get_decompressed_size(const int8_t* data,
+                                                   size_t size)
+{
+    return decompressor.get_decompressed_size(data, size);
+}
+
+void decompress_context::reset()
+{
+    // The decode table is rebuilt from scratch for every block anyway:
+    block_scratch.index.clear();
+    block_scratch.numbers_of_bits.clear();
+}
+
+void decompress_context::set_statistics(pipeline_statistics* statistics)
+{
+    decompressor.set_statistics(statistics);
+}
+
+void decompress_context::set_dictionary(const huffman_dictionary* dictionary)
+{
+    decompressor.set_dictionary(dictionary);
+}
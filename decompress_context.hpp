@@ -0,0 +1,61 @@
+#ifndef DECOMPRESS_CONTEXT_HPP
+#define DECOMPRESS_CONTEXT_HPP
+
+#include "block_decompressor.hpp"
+#include <cstdint>
+
+/*****************************************************************************
+* A decompressor for many streams in a row between caller-owned buffers. The *
+* context keeps the index, the decode table and the other memory of the      *
+* previous calls, so that once it has grown to the largest stream no call    *
+* allocates any more. A context serves one thread at a time.                 *
+*****************************************************************************/
+class decompress_context {
+public:
+    
+    decompress_context();
+    
+    decompress_context(const decompress_context&) = delete;
+    decompress_context& operator=(const decompress_context&) = delete;
+    
+    /**************************************************************************
+    * Decompresses the whole 'size' byte stream at 'data' into the 'capacity' *
+    * byte buffer at 'text' and returns the length of the text. Throws        *
+    * 'std::invalid_argument' if the text does not fit.                       *
+    **************************************************************************/
+    size_t decompress(const int8_t* data,
+                      size_t size,
+                      int8_t* text,
+                      size_t capacity);
+    
+    /******************************************************************
+    * Returns the length of the text the 'size' byte stream at 'data' *
+    * decompresses to.                                                *
+    ******************************************************************/
+    uint64_t get_decompressed_size(const int8_t* data, size_t size);
+    
+    /********************************************************************
+    * Forgets everything left from the previous calls while keeping the *
+    * memory, so that the next call starts as on a fresh context.       *
+    ********************************************************************/
+    void reset();
+    
+    /*******************************************************************
+    * Makes the context add its stage times and sizes to 'statistics'. *
+    * Passing null stops the collection.                               *
+    *******************************************************************/
+    void set_statistics(pipeline_statistics* statistics);
+    
+    /*******************************************************************
+    * Makes the context decode the blocks coded with 'dictionary'. The *
+    * dictionary must outlive the context.                             *
+    *******************************************************************/
+    void set_dictionary(const huffman_dictionary* dictionary);
+    
+private:
+    
+    block_decompressor decompressor;
+    block_decompressor::scratch block_scratch;
+};
+
+#endif // DECOMPRESS_CONTEXT_HPP
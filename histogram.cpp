@@ -0,0 +1,64 @@
+#include "histogram.hpp"
+#include <algorithm>
+
+histogram::histogram()
+:
+    counts{}
+{}
+
+histogram::histogram(const std::map<int8_t, uint32_t>& count_map)
+:
+    counts{}
+{
+    for (const auto& entry : count_map)
+    {
+        set_count(entry.first, entry.second);
+    }
+}
+
+void histogram::add(const histogram& other)
+{
+    for (size_t i = 0; i != NUMBER_OF_CHARACTERS; ++i)
+    {
+        counts[i] += other.counts[i];
+    }
+}
+
+size_t histogram::number_of_characters() const
+{
+    return NUMBER_OF_CHARACTERS - std::count(counts,
+                                             counts + NUMBER_OF_CHARACTERS,
+                                             0);
+}
+
+uint64_t histogram::total_count() const
+{
+    uint64_t total = 0;
+    
+    for (uint32_t count : counts)
+    {
+        total += count;
+    }
+    
+    return total;
+}
+
+std::map<int8_t, uint32_t> histogram::to_count_map() const
+{
+    std::map<int8_t, uint32_t> count_map;
+    
+    for (size_t i = 0; i != NUMBER_OF_CHARACTERS; ++i)
+    {
+        if (counts[i] != 0)
+        {
+            count_map[(int8_t) i] = counts[i];
+        }
+    }
+    
+    return count_map;
+}
+
+bool histogram::operator==(const histogram& other) const
+{
+    return std::equal(counts, counts + NUMBER_OF_CHARACTERS, other.counts);
+}
@@ -0,0 +1,75 @@
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+class histogram {
+public:
+    
+    constexpr static size_t NUMBER_OF_CHARACTERS = 256;
+    
+    /******************************************************
+    * Constructs a histogram with all counts set to zero. *
+    ******************************************************/
+    histogram();
+    
+    /****************************************************************
+    * Constructs the histogram holding the counts of the count map. *
+    ****************************************************************/
+    explicit histogram(const std::map<int8_t, uint32_t>& count_map);
+    
+    /************************************
+    * Returns the count of 'character'. *
+    ************************************/
+    uint32_t get_count(int8_t character) const
+    {
+        return counts[(uint8_t) character];
+    }
+    
+    /*********************************
+    * Sets the count of 'character'. *
+    *********************************/
+    void set_count(int8_t character, uint32_t count)
+    {
+        counts[(uint8_t) character] = count;
+    }
+    
+    /**********************************************
+    * Increments the count of 'character' by one. *
+    **********************************************/
+    void increment(int8_t character)
+    {
+        ++counts[(uint8_t) character];
+    }
+    
+    /************************************************
+    * Adds the counts of 'other' to this histogram. *
+    ************************************************/
+    void add(const histogram& other);
+    
+    /**********************************************************
+    * Returns the number of characters with a positive count. *
+    **********************************************************/
+    size_t number_of_characters() const;
+    
+    /*************************************
+    * Returns the sum of all the counts. *
+    *************************************/
+    uint64_t total_count() const;
+    
+    /**************************************************************************
+    * Returns the map from each character with a positive count to its count. *
+    **************************************************************************/
+    std::map<int8_t, uint32_t> to_count_map() const;
+    
+    bool operator==(const histogram& other) const;
+    
+private:
+    
+    // The counts indexed by the unsigned character values:
+    uint32_t counts[NUMBER_OF_CHARACTERS];
+};
+
+#endif // HISTOGRAM_HPP
@@ -0,0 +1,194 @@
+#include "canonical_code.hpp"
+#include "file_format_error.h"
+#include "huffman_decode_table.hpp"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+huffman_decode_table::huffman_decode_table()
+{
+    build(nullptr, 0);
+}
+
+huffman_decode_table::huffman_decode_table(const code_table& table)
+{
+    assign(table);
+}
+
+void huffman_decode_table::assign(const code_table& table)
+{
+    code_word code_words[code_table::NUMBER_OF_CHARACTERS];
+    size_t number_of_code_words = 0;
+    
+    for (size_t value = 0; value != code_table::NUMBER_OF_CHARACTERS; ++value)
+    {
+        code_word cw;
+        cw.bits      = table.get_bits((int8_t) value);
+        cw.length    = table.get_length((int8_t) value);
+        cw.character = (int8_t) value;
+        
+        if (cw.length == 0)
+        {
+            continue;
+        }
+        
+        if (cw.length > MAX_CODE_WORD_LENGTH)
+        {
+            std::stringstream ss;
+            ss << "Unsupported code word length: " << cw.length << ".";
+            throw std::runtime_error{ss.str()};
+        }
+        
+        code_words[number_of_code_words++] = cw;
+    }
+    
+    build(code_words, number_of_code_words);
+}
+
+huffman_decode_table::huffman_decode_table(
+                            const std::map<int8_t, bit_string>& encoder_map)
+:
+    huffman_decode_table(code_table(encoder_map))
+{}
+
+// Builds the canonical code words of the code word lengths:
+static code_table canonical_code_table(
+                            const std::map<int8_t, uint8_t>& code_length_map)
+{
+    code_table table(code_length_map);
+    assign_canonical_code_words(table);
+    return table;
+}
+
+huffman_decode_table::huffman_decode_table(
+                            const std::map<int8_t, uint8_t>& code_length_map)
+:
+    huffman_decode_table(canonical_code_table(code_length_map))
+{}
+
+void huffman_decode_table::build(const code_word* code_words,
+                                 size_t number_of_code_words)
+{
+    // Reuse the storage of the previous table:
+    entry invalid_entry = { 0, 0, entry_kind::INVALID };
+    entries.assign(1ULL << PRIMARY_BITS, invalid_entry);
+    long_code_words.clear();
+    
+    // Find out how long second-level tables each primary slot requires:
+    uint8_t max_length_by_prefix[1ULL << PRIMARY_BITS] = {};
+    
+    for (size_t i = 0; i != number_of_code_words; ++i)
+    {
+        const code_word& cw = code_words[i];
+        
+        if (cw.length <= PRIMARY_BITS)
+        {
+            entry e = { (uint32_t)(uint8_t) cw.character,
+                        (uint8_t) cw.length,
+                        entry_kind::SYMBOL };
+            
+            for (uint64_t index = cw.bits;
+                 index < entries.size();
+                 index += 1ULL << cw.length)
+            {
+                entries[index] = e;
+            }
+        }
+        else
+        {
+            uint8_t& max_length = max_length_by_prefix[cw.bits & PRIMARY_MASK];
+            max_length = std::max(max_length, (uint8_t) cw.length);
+        }
+    }
+    
+    // A copy, since 'std::min' would bind the member to a reference:
+    const size_t max_subtable_bits = MAX_SECONDARY_BITS;
+    
+    for (size_t prefix = 0; prefix != (1ULL << PRIMARY_BITS); ++prefix)
+    {
+        if (max_length_by_prefix[prefix] == 0)
+        {
+            continue;
+        }
+        
+        size_t subtable_bits = std::min(max_length_by_prefix[prefix]
+                                        - PRIMARY_BITS,
+                                        max_subtable_bits);
+        size_t offset = entries.size();
+        entries[prefix].value  = (uint32_t) offset;
+        entries[prefix].length = (uint8_t) subtable_bits;
+        entries[prefix].kind   = entry_kind::SUBTABLE;
+        entries.resize(offset + (1ULL << subtable_bits), invalid_entry);
+    }
+    
+    for (size_t i = 0; i != number_of_code_words; ++i)
+    {
+        const code_word& cw = code_words[i];
+        
+        if (cw.length <= PRIMARY_BITS)
+        {
+            continue;
+        }
+        
+        const entry& subtable = entries[cw.bits & PRIMARY_MASK];
+        size_t offset         = subtable.value;
+        size_t subtable_bits  = subtable.length;
+        size_t rest_length    = cw.length - PRIMARY_BITS;
+        uint64_t rest_bits    = cw.bits >> PRIMARY_BITS;
+        
+        if (rest_length > subtable_bits)
+        {
+            uint64_t mask = (1ULL << subtable_bits) - 1;
+            entries[offset + (rest_bits & mask)].kind = entry_kind::LONG_CODE;
+            long_code_words.push_back(cw);
+            continue;
+        }
+        
+        entry e = { (uint32_t)(uint8_t) cw.character,
+                    (uint8_t) cw.length,
+                    entry_kind::SYMBOL };
+        
+        for (uint64_t index = rest_bits;
+             index < (1ULL << subtable_bits);
+             index += 1ULL << rest_length)
+        {
+            entries[offset + index] = e;
+        }
+    }
+    
+    short_code_lookup.assign(1ULL << PRIMARY_BITS, 0);
+    
+    for (size_t index = 0; index != short_code_lookup.size(); ++index)
+    {
+        if (entries[index].kind == entry_kind::SYMBOL)
+        {
+            short_code_lookup[index] = entries[index].value
+                                     | (uint32_t) entries[index].length << 8;
+        }
+    }
+    
+    // Try the shorter, that is, more probable long code words first:
+    std::sort(long_code_words.begin(),
+              long_code_words.end(),
+              [](const code_word& lhs, const code_word& rhs) {
+                  return lhs.length < rhs.length;
+              });
+}
+
+int8_t huffman_decode_table::decode_slow(uint64_t window,
+                                         size_t& code_length) const
+{
+    for (const code_word& cw : long_code_words)
+    {
+        uint64_t mask = (1ULL << cw.length) - 1;
+        
+        if ((window & mask) == cw.bits)
+        {
+            code_length = cw.length;
+            return cw.character;
+        }
+    }
+    
+    throw file_format_error{"Invalid code word in the encoded text."};
+}
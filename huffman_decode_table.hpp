@@ -0,0 +1,128 @@
+#ifndef HUFFMAN_DECODE_TABLE_HPP
+#define HUFFMAN_DECODE_TABLE_HPP
+
+#include "bit_string.hpp"
+#include "code_table.hpp"
+#include <cstdint>
+#include <map>
+#include <vector>
+
+class huffman_decode_table {
+public:
+    
+    // The number of bits the primary table is indexed by:
+    constexpr static size_t PRIMARY_BITS = 11;
+    
+    // The maximum number of bits a second-level table is indexed by:
+    constexpr static size_t MAX_SECONDARY_BITS = 12;
+    
+    // The longest code word the decoder can peek at once:
+    constexpr static size_t MAX_CODE_WORD_LENGTH = 57;
+    
+    /************************************************************************
+    * Builds the decode table of no code words, which rejects every stream. *
+    ************************************************************************/
+    huffman_decode_table();
+    
+    /**********************************************************
+    * Builds the decode table from the code words of 'table'. *
+    **********************************************************/
+    explicit huffman_decode_table(const code_table& table);
+    
+    /***********************************************************************
+    * Rebuilds the decode table from the code words of 'table' reusing the *
+    * memory of the current table.                                         *
+    ***********************************************************************/
+    void assign(const code_table& table);
+    
+    /***************************************************************************
+    * Builds the decode table from the encoder map. The bit at index 0 of each *
+    * code word is the first bit read from the stream.                         *
+    ***************************************************************************/
+    explicit huffman_decode_table(
+                            const std::map<int8_t, bit_string>& encoder_map);
+    
+    /***************************************************************************
+    * Builds the decode table of the canonical code described by the code word *
+    * lengths alone.                                                           *
+    ***************************************************************************/
+    explicit huffman_decode_table(
+                            const std::map<int8_t, uint8_t>& code_length_map);
+    
+    /**************************************************************************
+    * Decodes the next character from the 'window', which holds at least      *
+    * 'MAX_CODE_WORD_LENGTH' next bits of the stream starting from its lowest *
+    * bit. Stores the length of the decoded code word in 'code_length'.       *
+    **************************************************************************/
+    int8_t decode(uint64_t window, size_t& code_length) const
+    {
+        const entry* e = &entries[window & PRIMARY_MASK];
+        
+        if (e->kind == entry_kind::SUBTABLE)
+        {
+            uint64_t mask = (1ULL << e->length) - 1;
+            e = &entries[e->value + ((window >> PRIMARY_BITS) & mask)];
+        }
+        
+        if (e->kind == entry_kind::SYMBOL)
+        {
+            code_length = e->length;
+            return (int8_t) e->value;
+        }
+        
+        return decode_slow(window, code_length);
+    }
+    
+    /*************************************************************************
+    * Returns the table of '2^PRIMARY_BITS' words indexed by the lowest bits *
+    * of the window. A word holds the character in its lowest byte and the   *
+    * code word length in the next one, or is zero if the code word is       *
+    * longer than 'PRIMARY_BITS' bits. Meant for vectorized decoders.        *
+    *************************************************************************/
+    const uint32_t* get_short_code_lookup() const
+    {
+        return short_code_lookup.data();
+    }
+    
+private:
+    
+    constexpr static uint64_t PRIMARY_MASK = (1ULL << PRIMARY_BITS) - 1;
+    
+    enum class entry_kind : uint8_t {
+        INVALID,   // No code word starts with these bits.
+        SYMBOL,    // 'value' is the character, 'length' is the code length.
+        SUBTABLE,  // 'value' is the subtable offset, 'length' is its bits.
+        LONG_CODE  // The code word is too long for the tables.
+    };
+    
+    // The actual table entry:
+    struct entry {
+        uint32_t   value;
+        uint8_t    length;
+        entry_kind kind;
+    };
+    
+    // A code word with its first bit stored at the lowest position:
+    struct code_word {
+        uint64_t bits;
+        size_t   length;
+        int8_t   character;
+    };
+    
+    // The primary table followed by all the second-level tables:
+    std::vector<entry> entries;
+    
+    // The code words that do not fit in the two table levels:
+    std::vector<code_word> long_code_words;
+    
+    // The primary table packed for gather loads:
+    std::vector<uint32_t> short_code_lookup;
+    
+    // Fills the table entries for the given code words:
+    void build(const code_word* code_words, size_t number_of_code_words);
+    
+    // Handles the long code words and the invalid bit patterns:
+    int8_t decode_slow(uint64_t window, size_t& code_length) const;
+};
+
+#endif // HUFFMAN_DECODE_TABLE_HPP
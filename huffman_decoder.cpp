@@ -1,18 +1,413 @@
+#include "file_format_error.h"
 #include "huffman_decoder.hpp"
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+const size_t huffman_decoder::MAX_NUMBER_OF_STREAMS = 8;
+
+// Returns the bits of the stream starting from the bit 'bit_index'. The result
+// holds at least 57 valid bits unless the storage ends earlier:
+static inline uint64_t peek_bits(const uint8_t* bytes,
+                                 size_t number_of_bytes,
+                                 size_t bit_index)
+{
+    size_t byte_index = bit_index / CHAR_BIT;
+    uint64_t word = 0;
+    
+    if (byte_index + sizeof(uint64_t) <= number_of_bytes)
+    {
+        std::memcpy(&word, bytes + byte_index, sizeof(uint64_t));
+    }
+    else
+    {
+        for (size_t i = 0; byte_index + i < number_of_bytes; ++i)
+        {
+            word |= (uint64_t) bytes[byte_index + i] << (CHAR_BIT * i);
+        }
+    }
+    
+    return word >> (bit_index % CHAR_BIT);
+}
 
 std::vector<int8_t>
 huffman_decoder::decode(huffman_tree& tree,
                         bit_string& encoded_text)
 {
-    size_t index = 0;
+    huffman_decode_table table(tree.infer_encoder_map());
+    return decode(table, encoded_text);
+}
+
+std::vector<int8_t>
+huffman_decoder::decode(const huffman_decode_table& table,
+                        const bit_string& encoded_text)
+{
+    const uint8_t* bytes = (const uint8_t*) encoded_text.data();
+    size_t number_of_bytes = encoded_text.number_of_words() * sizeof(uint64_t);
     size_t bit_string_length = encoded_text.length();
+    size_t index = 0;
     std::vector<int8_t> decoded_text;
+    decoded_text.reserve(bit_string_length / CHAR_BIT);
     
     while (index < bit_string_length)
     {
-        int8_t character = tree.decode_bit_string(index, encoded_text);
-        decoded_text.push_back(character);
+        size_t code_length;
+        uint64_t window = peek_bits(bytes, number_of_bytes, index);
+        decoded_text.push_back(table.decode(window, code_length));
+        index += code_length;
+    }
+    
+    if (index != bit_string_length)
+    {
+        throw file_format_error{"The encoded text ends in a partial code "
+                                "word."};
     }
     
     return decoded_text;
 }
+
+void huffman_decoder::decode(const huffman_decode_table& table,
+                             const int8_t* encoded_text,
+                             size_t number_of_bits,
+                             int8_t* text,
+                             size_t text_length)
+{
+    const uint8_t* bytes = (const uint8_t*) encoded_text;
+    size_t number_of_bytes =
+        number_of_bits / CHAR_BIT + ((number_of_bits % CHAR_BIT == 0) ? 0 : 1);
+    size_t index = 0;
+    
+    for (size_t i = 0; i != text_length; ++i)
+    {
+        size_t code_length;
+        uint64_t window = peek_bits(bytes, number_of_bytes, index);
+        text[i] = table.decode(window, code_length);
+        index += code_length;
+    }
+    
+    if (index != number_of_bits)
+    {
+        throw file_format_error{"The number of encoded bits does not match "
+                                "the number of characters."};
+    }
+}
+
+void huffman_decoder::decode_with_contexts(const huffman_decode_table* tables,
+                                           const uint8_t* context_map,
+                                           const int8_t* encoded_text,
+                                           size_t number_of_bits,
+                                           int8_t* text,
+                                           size_t text_length)
+{
+    const uint8_t* bytes = (const uint8_t*) encoded_text;
+    size_t number_of_bytes =
+        number_of_bits / CHAR_BIT + ((number_of_bits % CHAR_BIT == 0) ? 0 : 1);
+    size_t index = 0;
+    const huffman_decode_table* table = &tables[context_map[0]];
+    
+    for (size_t i = 0; i != text_length; ++i)
+    {
+        size_t code_length;
+        uint64_t window = peek_bits(bytes, number_of_bytes, index);
+        text[i] = table->decode(window, code_length);
+        table = &tables[context_map[(uint8_t) text[i]]];
+        index += code_length;
+    }
+    
+    if (index != number_of_bits)
+    {
+        throw file_format_error{"The number of encoded bits does not match "
+                                "the number of characters."};
+    }
+}
+
+// Where a stream of an interleaved text is being decoded:
+struct stream_cursor {
+    const uint8_t* bytes;
+    size_t number_of_bytes;
+    size_t bit_index;
+};
+
+// Decodes the rounds 'first_round' to 'last_round' (exclusive) taking one
+// character from each of the 'N' streams per round:
+template<size_t N>
+static void decode_rounds(const huffman_decode_table& table,
+                          stream_cursor* cursors,
+                          int8_t* text,
+                          size_t first_round,
+                          size_t last_round)
+{
+    for (size_t round = first_round; round != last_round; ++round)
+    {
+        for (size_t stream = 0; stream != N; ++stream)
+        {
+            stream_cursor& cursor = cursors[stream];
+            size_t code_length;
+            uint64_t window = peek_bits(cursor.bytes,
+                                        cursor.number_of_bytes,
+                                        cursor.bit_index);
+            text[round * N + stream] = table.decode(window, code_length);
+            cursor.bit_index += code_length;
+        }
+    }
+}
+
+#ifdef __AVX2__
+// Decodes rounds four streams per vector starting from 'first_round' while
+// the primary table resolves every code word and all the loads stay inside
+// the streams. Returns the round it stopped at:
+template<size_t N>
+static size_t decode_rounds_avx2(const huffman_decode_table& table,
+                                 const uint8_t* base,
+                                 stream_cursor* cursors,
+                                 int8_t* text,
+                                 size_t first_round,
+                                 size_t last_round)
+{
+    constexpr size_t NUMBER_OF_GROUPS = N / 4;
+    const int* lookup = (const int*) table.get_short_code_lookup();
+    
+    // The bit positions relative to 'base' and the last byte offsets a
+    // 64-bit load may start from:
+    int64_t positions[N];
+    int64_t limits[N];
+    
+    for (size_t stream = 0; stream != N; ++stream)
+    {
+        int64_t start = cursors[stream].bytes - base;
+        positions[stream] = CHAR_BIT * start + cursors[stream].bit_index;
+        limits[stream] = start + (int64_t) cursors[stream].number_of_bytes
+                       - (int64_t) sizeof(uint64_t);
+    }
+    
+    __m256i position_vectors[NUMBER_OF_GROUPS];
+    __m256i limit_vectors[NUMBER_OF_GROUPS];
+    
+    for (size_t group = 0; group != NUMBER_OF_GROUPS; ++group)
+    {
+        position_vectors[group] =
+            _mm256_loadu_si256((const __m256i*) &positions[4 * group]);
+        limit_vectors[group] =
+            _mm256_loadu_si256((const __m256i*) &limits[4 * group]);
+    }
+    
+    const __m256i bit_offset_mask = _mm256_set1_epi64x(CHAR_BIT - 1);
+    const __m256i primary_mask =
+        _mm256_set1_epi64x((1LL << huffman_decode_table::PRIMARY_BITS) - 1);
+    const __m128i length_mask = _mm_set1_epi32(0xFF);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i low_bytes = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1,
+                                            -1, -1, -1, -1, -1, -1, -1, -1);
+    size_t round = first_round;
+    
+    for (; round != last_round; ++round)
+    {
+        __m256i next_positions[NUMBER_OF_GROUPS];
+        uint32_t characters[NUMBER_OF_GROUPS];
+        bool resolved = true;
+        
+        for (size_t group = 0; group != NUMBER_OF_GROUPS; ++group)
+        {
+            __m256i byte_offsets =
+                _mm256_srli_epi64(position_vectors[group], 3);
+            __m256i out_of_bounds =
+                _mm256_cmpgt_epi64(byte_offsets, limit_vectors[group]);
+            
+            if (!_mm256_testz_si256(out_of_bounds, out_of_bounds))
+            {
+                resolved = false;
+                break;
+            }
+            
+            __m256i words = _mm256_i64gather_epi64((const long long*) base,
+                                                   byte_offsets,
+                                                   1);
+            __m256i windows = _mm256_srlv_epi64(
+                                    words,
+                                    _mm256_and_si256(position_vectors[group],
+                                                     bit_offset_mask));
+            __m128i entries =
+                _mm256_i64gather_epi32(lookup,
+                                       _mm256_and_si256(windows,
+                                                        primary_mask),
+                                       4);
+            __m128i lengths = _mm_and_si128(_mm_srli_epi32(entries, 8),
+                                            length_mask);
+            
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(lengths, zero)) != 0)
+            {
+                resolved = false;
+                break;
+            }
+            
+            next_positions[group] =
+                _mm256_add_epi64(position_vectors[group],
+                                 _mm256_cvtepu32_epi64(lengths));
+            characters[group] = (uint32_t) _mm_cvtsi128_si32(
+                                    _mm_shuffle_epi8(entries, low_bytes));
+        }
+        
+        if (!resolved)
+        {
+            break;
+        }
+        
+        for (size_t group = 0; group != NUMBER_OF_GROUPS; ++group)
+        {
+            position_vectors[group] = next_positions[group];
+            std::memcpy(text + round * N + 4 * group,
+                        &characters[group],
+                        sizeof(uint32_t));
+        }
+    }
+    
+    for (size_t group = 0; group != NUMBER_OF_GROUPS; ++group)
+    {
+        _mm256_storeu_si256((__m256i*) &positions[4 * group],
+                            position_vectors[group]);
+    }
+    
+    for (size_t stream = 0; stream != N; ++stream)
+    {
+        int64_t start = cursors[stream].bytes - base;
+        cursors[stream].bit_index = positions[stream] - CHAR_BIT * start;
+    }
+    
+    return round;
+}
+#endif
+
+// Decodes all the full rounds of the 'N' streams:
+template<size_t N>
+static void decode_all_rounds(const huffman_decode_table& table,
+                              const uint8_t* base,
+                              stream_cursor* cursors,
+                              int8_t* text,
+                              size_t number_of_rounds)
+{
+#ifdef __AVX2__
+    // Without 'if constexpr' the vector branch must compile for any 'N', hence
+    // the dummy template argument below:
+    if (N % 4 == 0)
+    {
+        size_t round = 0;
+        
+        // Step over the rounds the vector loop cannot handle one by one:
+        while (true)
+        {
+            round = decode_rounds_avx2<N % 4 == 0 ? N : 4>(table,
+                                                           base,
+                                                           cursors,
+                                                           text,
+                                                           round,
+                                                           number_of_rounds);
+            
+            if (round == number_of_rounds)
+            {
+                return;
+            }
+            
+            decode_rounds<N>(table, cursors, text, round, round + 1);
+            ++round;
+        }
+    }
+#else
+    // Only the vector loop needs the start of the streams:
+    (void) base;
+#endif
+    
+    decode_rounds<N>(table, cursors, text, 0, number_of_rounds);
+}
+
+void huffman_decoder::decode_interleaved(
+                                    const huffman_decode_table& table,
+                                    const int8_t* encoded_text,
+                                    const std::vector<size_t>& numbers_of_bits,
+                                    int8_t* text,
+                                    size_t text_length)
+{
+    size_t number_of_streams = numbers_of_bits.size();
+    
+    if (number_of_streams == 0 || number_of_streams > MAX_NUMBER_OF_STREAMS)
+    {
+        throw std::invalid_argument{"Bad number of interleaved streams."};
+    }
+    
+    const uint8_t* base = (const uint8_t*) encoded_text;
+    stream_cursor cursors[MAX_NUMBER_OF_STREAMS];
+    size_t offset = 0;
+    
+    for (size_t stream = 0; stream != number_of_streams; ++stream)
+    {
+        size_t number_of_bytes = numbers_of_bits[stream] / CHAR_BIT
+                               + (numbers_of_bits[stream] % CHAR_BIT != 0);
+        cursors[stream].bytes = base + offset;
+        cursors[stream].number_of_bytes = number_of_bytes;
+        cursors[stream].bit_index = 0;
+        offset += number_of_bytes;
+    }
+    
+    size_t number_of_rounds = text_length / number_of_streams;
+    
+    switch (number_of_streams)
+    {
+        case 1:
+            decode_all_rounds<1>(table, base, cursors, text, number_of_rounds);
+            break;
+            
+        case 2:
+            decode_all_rounds<2>(table, base, cursors, text, number_of_rounds);
+            break;
+            
+        case 3:
+            decode_all_rounds<3>(table, base, cursors, text, number_of_rounds);
+            break;
+            
+        case 4:
+            decode_all_rounds<4>(table, base, cursors, text, number_of_rounds);
+            break;
+            
+        case 5:
+            decode_all_rounds<5>(table, base, cursors, text, number_of_rounds);
+            break;
+            
+        case 6:
+            decode_all_rounds<6>(table, base, cursors, text, number_of_rounds);
+            break;
+            
+        case 7:
+            decode_all_rounds<7>(table, base, cursors, text, number_of_rounds);
+            break;
+            
+        default:
+            decode_all_rounds<8>(table, base, cursors, text, number_of_rounds);
+            break;
+    }
+    
+    // The last characters that do not make up a full round:
+    for (size_t index = number_of_rounds * number_of_streams;
+         index != text_length;
+         ++index)
+    {
+        stream_cursor& cursor = cursors[index % number_of_streams];
+        size_t code_length;
+        uint64_t window = peek_bits(cursor.bytes,
+                                    cursor.number_of_bytes,
+                                    cursor.bit_index);
+        text[index] = table.decode(window, code_length);
+        cursor.bit_index += code_length;
+    }
+    
+    for (size_t stream = 0; stream != number_of_streams; ++stream)
+    {
+        if (cursors[stream].bit_index != numbers_of_bits[stream])
+        {
+            throw file_format_error{"The number of encoded bits does not "
+                                    "match the number of characters."};
+        }
+    }
+}
@@ -2,12 +2,65 @@
 #define HUFFMAN_DECODER_HPP
 
 #include "bit_string.hpp"
+#include "huffman_decode_table.hpp"
 #include "huffman_tree.hpp"
 #include <vector>
 
 class huffman_decoder {
 public:
+    
+    // The maximum number of interleaved streams:
+    static const size_t MAX_NUMBER_OF_STREAMS;
+    
+    /**************************************************************************
+    * Decodes the 'encoded_text' using the code words of the 'tree'. Builds a *
+    * decode table and delegates to the table-driven decoder.                 *
+    **************************************************************************/
     std::vector<int8_t> decode(huffman_tree& tree, bit_string& encoded_text);
+    
+    /*********************************************************************
+    * Decodes the 'encoded_text' resolving a code word per table lookup. *
+    *********************************************************************/
+    std::vector<int8_t> decode(const huffman_decode_table& table,
+                               const bit_string& encoded_text);
+    
+    /************************************************************************
+    * Decodes exactly 'text_length' characters into 'text' from the         *
+    * 'number_of_bits' bits stored in the bytes starting at 'encoded_text'. *
+    * Throws 'file_format_error' unless the code words use up exactly       *
+    * 'number_of_bits' bits.                                                *
+    ************************************************************************/
+    void decode(const huffman_decode_table& table,
+                const int8_t* encoded_text,
+                size_t number_of_bits,
+                int8_t* text,
+                size_t text_length);
+    
+    /***************************************************************************
+    * Decodes exactly 'text_length' characters into 'text' from interleaved    *
+    * streams stored back to back from 'encoded_text', each starting at a byte *
+    * boundary. The stream 'k' is 'numbers_of_bits[k]' bits long and holds the *
+    * characters at the indices 'i' with 'i % numbers_of_bits.size() == k'.    *
+    * All the streams are advanced in the same loop. Throws                    *
+    * 'file_format_error' unless every stream is used up exactly.              *
+    ***************************************************************************/
+    void decode_interleaved(const huffman_decode_table& table,
+                            const int8_t* encoded_text,
+                            const std::vector<size_t>& numbers_of_bits,
+                            int8_t* text,
+                            size_t text_length);
+    
+    /************************************************************************
+    * Decodes exactly 'text_length' characters like 'decode', decoding each *
+    * character with the table 'tables[context_map[c]]', where 'c' is the   *
+    * preceding character, or 0 for the first one.                          *
+    ************************************************************************/
+    void decode_with_contexts(const huffman_decode_table* tables,
+                              const uint8_t* context_map,
+                              const int8_t* encoded_text,
+                              size_t number_of_bits,
+                              int8_t* text,
+                              size_t text_length);
 };
 
 #endif // HUFFMAN_DECODER_HPP
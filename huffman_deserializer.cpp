@@ -1,30 +1,184 @@
+#include "canonical_code.hpp"
 #include "huffman_deserializer.hpp"
+#include "huffman_tree.hpp"
+#include "varint.hpp"
 #include "huffman_serializer.hpp"
 #include "file_format_error.h"
 
+#include <algorithm>
+#include <climits>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 
+huffman_decode_table huffman_deserializer::result::build_decode_table()
+{
+    if (code_words.number_of_code_words() != 0)
+    {
+        return huffman_decode_table(code_words);
+    }
+    
+    huffman_tree tree(counts);
+    return huffman_decode_table(tree.infer_code_table());
+}
+
 huffman_deserializer::result
 huffman_deserializer::deserialize(std::vector<int8_t> &data)
 {
+    if (data.size() >= sizeof(huffman_serializer::MAGIC_V2)
+        && std::equal(data.begin(),
+                      data.begin() + sizeof(huffman_serializer::MAGIC_V2),
+                      huffman_serializer::MAGIC_V2))
+    {
+        return deserialize_v2(data);
+    }
+    
     check_signature(data);
     // The number of code words is the same as the number of mappings in the
     // deserialized weight map.
     size_t number_of_code_words = extract_number_of_code_words(data);
     size_t number_of_text_bits  = extract_number_of_encoded_text_bits(data);
-    std::map<int8_t, uint32_t> count_map =
-                extract_count_map(data, number_of_code_words);
+    histogram counts = extract_count_map(data, number_of_code_words);
+    
+    size_t omitted_bytes =
+        sizeof(huffman_serializer::MAGIC) +
+        huffman_serializer::BYTES_PER_BIT_COUNT_ENTRY +
+        huffman_serializer::BYTES_PER_CODE_WORD_COUNT_ENTRY +
+        number_of_code_words * huffman_serializer::BYTES_PER_WEIGHT_MAP_ENTRY;
     
     bit_string encoded_text = extract_encoded_text(data,
-                                                   count_map,
+                                                   omitted_bytes,
                                                    number_of_text_bits);
     result ret;
-    ret.count_map    = std::move(count_map);
+    ret.counts       = counts;
     ret.encoded_text = std::move(encoded_text);
     return ret;
 }
 
+huffman_deserializer::result
+huffman_deserializer::deserialize_v2(std::vector<int8_t>& data)
+{
+    size_t data_byte_index = sizeof(huffman_serializer::MAGIC_V2);
+    uint64_t number_of_text_bits = 0;
+    result ret;
+    
+    try
+    {
+        number_of_text_bits = extract_varint(data, data_byte_index);
+        ret.code_words = extract_code_table(data, data_byte_index);
+    }
+    catch (std::out_of_range& error)
+    {
+        std::stringstream ss;
+        ss << "The input data is too short in order to recover the code word "
+              "lengths. "
+        << error.what();
+        std::string err_msg = ss.str();
+        throw file_format_error{err_msg.c_str()};
+    }
+    
+    ret.encoded_text = extract_encoded_text(data,
+                                            data_byte_index,
+                                            number_of_text_bits);
+    return ret;
+}
+
+code_table huffman_deserializer::
+extract_code_table(const std::vector<int8_t>& data, size_t& data_byte_index)
+{
+    return extract_code_table(data.data(), data.size(), data_byte_index);
+}
+
+// Returns 'data[index]' of the 'size' bytes at 'data' checking the index:
+static int8_t byte_at(const int8_t* data, size_t size, size_t index)
+{
+    if (index >= size)
+    {
+        throw std::out_of_range{"The data ends in the middle of the code "
+                                "table."};
+    }
+    
+    return data[index];
+}
+
+code_table huffman_deserializer::extract_code_table(const int8_t* data,
+                                                    size_t size,
+                                                    size_t& data_byte_index)
+{
+    size_t number_of_characters =
+        (uint8_t) byte_at(data, size, data_byte_index++) + 1;
+    uint8_t characters[code_table::NUMBER_OF_CHARACTERS];
+    size_t number_of_listed_characters = 0;
+    
+    if (number_of_characters <= huffman_serializer::MAX_LISTED_CHARACTERS)
+    {
+        for (size_t i = 0; i != number_of_characters; ++i)
+        {
+            characters[number_of_listed_characters++] =
+                (uint8_t) byte_at(data, size, data_byte_index++);
+        }
+    }
+    else
+    {
+        for (size_t value = 0; value != 256; ++value)
+        {
+            uint8_t bitmap_byte = byte_at(data,
+                                          size,
+                                          data_byte_index + value / CHAR_BIT);
+            
+            if ((bitmap_byte & (1 << (value % CHAR_BIT))) != 0)
+            {
+                characters[number_of_listed_characters++] = (uint8_t) value;
+            }
+        }
+        
+        data_byte_index += huffman_serializer::BYTES_PER_CHARACTER_BITMAP;
+    }
+    
+    if (number_of_listed_characters != number_of_characters)
+    {
+        throw file_format_error{"The character bitmap does not match the "
+                                "number of characters."};
+    }
+    
+    size_t max_code_length = (uint8_t) byte_at(data, size, data_byte_index++);
+    code_table table;
+    
+    for (size_t i = 0; i != number_of_characters; ++i)
+    {
+        uint8_t code_length;
+        
+        if (max_code_length <= huffman_serializer::MAX_NIBBLE_CODE_WORD_LENGTH)
+        {
+            uint8_t byte = byte_at(data, size, data_byte_index + i / 2);
+            code_length = (i % 2 == 0) ? (byte & 0x0F) : (byte >> 4);
+        }
+        else
+        {
+            code_length = byte_at(data, size, data_byte_index + i);
+        }
+        
+        if (code_length == 0 || code_length > max_code_length)
+        {
+            throw file_format_error{"Bad code word length."};
+        }
+        
+        table.set_code_word((int8_t) characters[i], 0, code_length);
+    }
+    
+    if (max_code_length <= huffman_serializer::MAX_NIBBLE_CODE_WORD_LENGTH)
+    {
+        data_byte_index += (number_of_characters + 1) / 2;
+    }
+    else
+    {
+        data_byte_index += number_of_characters;
+    }
+    
+    assign_canonical_code_words(table);
+    return table;
+}
+
 void huffman_deserializer::check_signature(std::vector<int8_t>& data)
 {
     if (data.size() < sizeof(huffman_serializer::MAGIC))
@@ -103,10 +257,10 @@ size_t huffman_deserializer
     return t.num;
 }
 
-std::map<int8_t, uint32_t> huffman_deserializer::
+histogram huffman_deserializer::
 extract_count_map(std::vector<int8_t>& data, size_t number_of_code_words)
 {
-    std::map<int8_t, uint32_t> count_map;
+    histogram counts;
     
     try
     {
@@ -131,7 +285,7 @@ extract_count_map(std::vector<int8_t>& data, size_t number_of_code_words)
             count_bytes.bytes[2] = data.at(data_byte_index++);
             count_bytes.bytes[3] = data.at(data_byte_index++);
             
-            count_map[byte] = count_bytes.count;
+            counts.set_count(byte, count_bytes.count);
         }
     }
     catch (std::out_of_range& error)
@@ -144,52 +298,31 @@ extract_count_map(std::vector<int8_t>& data, size_t number_of_code_words)
         throw file_format_error{err_msg.c_str()};
     }
     
-    return count_map;
+    return counts;
 }
 
 bit_string huffman_deserializer
 ::extract_encoded_text(const std::vector<int8_t>& data,
-                       const std::map<int8_t, uint32_t>& count_map,
+                       const size_t omitted_bytes,
                        const size_t number_of_encoded_text_bits)
 {
-    size_t omitted_bytes =
-        sizeof(huffman_serializer::MAGIC) +
-        huffman_serializer::BYTES_PER_BIT_COUNT_ENTRY +
-        huffman_serializer::BYTES_PER_CODE_WORD_COUNT_ENTRY;
-    
-    omitted_bytes +=
-        count_map.size() * huffman_serializer::BYTES_PER_WEIGHT_MAP_ENTRY;
-    
-    bit_string encoded_text;
-    size_t current_byte_index = omitted_bytes;
-    size_t current_bit_index = 0;
+    size_t number_of_bytes =
+        number_of_encoded_text_bits / CHAR_BIT +
+        ((number_of_encoded_text_bits % CHAR_BIT == 0) ? 0 : 1);
     
-    try
-    {
-        for (size_t bit_index = 0;
-             bit_index != number_of_encoded_text_bits;
-             bit_index++)
-        {
-            bool bit =
-                (data.at(current_byte_index) & (1 << current_bit_index)) != 0;
-            
-            encoded_text.append_bit(bit);
-            
-            if (++current_bit_index == CHAR_BIT)
-            {
-                current_bit_index = 0;
-                current_byte_index++;
-            }
-        }
-    }
-    catch (std::out_of_range& error)
+    if (omitted_bytes > data.size()
+        || data.size() - omitted_bytes < number_of_bytes)
     {
         std::stringstream ss;
         ss << "The input data is too short in order to recover encoded text. "
-           << error.what();
+           << "Expected " << number_of_bytes << " bytes, got "
+           << (omitted_bytes > data.size() ? 0 : data.size() - omitted_bytes)
+           << ".";
         std::string err_msg = ss.str();
         throw file_format_error{err_msg.c_str()};
     }
     
+    bit_string encoded_text(data.data() + omitted_bytes,
+                            number_of_encoded_text_bits);
     return encoded_text;
 }
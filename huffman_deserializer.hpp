@@ -2,6 +2,9 @@
 #define HUFFMAN_DESERIALIZER_HPP
 
 #include "bit_string.hpp"
+#include "code_table.hpp"
+#include "histogram.hpp"
+#include "huffman_decode_table.hpp"
 #include <map>
 #include <cstdint>
 #include <vector>
@@ -11,7 +14,17 @@ public:
     
     struct result {
         bit_string encoded_text;
-        std::map<int8_t, uint32_t> count_map;
+        
+        // The character counts. Present only in the version 1 format.
+        histogram counts;
+        
+        // The canonical code words. Present only in the version 2 format.
+        code_table code_words;
+        
+        /****************************************************
+        * Builds the table for decoding the 'encoded_text'. *
+        ****************************************************/
+        huffman_decode_table build_decode_table();
     };
     
     /********************************************************************
@@ -20,11 +33,31 @@ public:
     ********************************************************************/
     result deserialize(std::vector<int8_t>& data);
     
+    /************************************************************************
+    * Extracts the code word lengths in the layout of the version 2 format  *
+    * starting at 'data[data_byte_index]', assigns the canonical code words *
+    * and advances 'data_byte_index' past the lengths. Throws               *
+    * 'std::out_of_range' if the data is too short.                         *
+    ************************************************************************/
+    code_table extract_code_table(const std::vector<int8_t>& data,
+                                  size_t& data_byte_index);
+    
+    /************************************************************************
+    * Extracts the code word lengths from the 'size' bytes at 'data' in the *
+    * same way.                                                             *
+    ************************************************************************/
+    code_table extract_code_table(const int8_t* data,
+                                  size_t size,
+                                  size_t& data_byte_index);
+    
 private:
     
     // Make sure that the data contains the magic signature:
     void check_signature(std::vector<int8_t>& data);
     
+    // Deserializes the data in the version 2 format:
+    result deserialize_v2(std::vector<int8_t>& data);
+    
     // Make sure that the data describes the number of code words in the stream
     // and returns that number:
     size_t extract_number_of_code_words(std::vector<int8_t>& data);
@@ -34,13 +67,13 @@ private:
     size_t extract_number_of_encoded_text_bits(std::vector<int8_t>& data);
     
     // Extracts the actual encoder map from the stream:
-    std::map<int8_t, uint32_t>
+    histogram
     extract_count_map(std::vector<int8_t>& data, size_t number_of_code_words);
     
-    // Extracts the actual encoded text from the stream:
+    // Extracts the actual encoded text starting at the byte 'omitted_bytes':
     bit_string extract_encoded_text(
                                 const std::vector<int8_t>& data,
-                                const std::map<int8_t, uint32_t>& weight_map,
+                                const size_t omitted_bytes,
                                 const size_t number_of_encoded_text_bits);
 };
 
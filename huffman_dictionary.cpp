@@ -0,0 +1,147 @@
+#include "file_format_error.h"
+#include "huffman_deserializer.hpp"
+#include "huffman_dictionary.hpp"
+#include "huffman_serializer.hpp"
+#include "length_limited_code.hpp"
+#include "minimum_redundancy_code.hpp"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+const int8_t huffman_dictionary::MAGIC[4] = { (int8_t) 0xC0,
+                                              (int8_t) 0xDE,
+                                              (int8_t) 0x0D,
+                                              (int8_t) 0xD1 };
+
+// Gives every character a positive count:
+static histogram smooth_counts(const histogram& counts)
+{
+    histogram smoothed = counts;
+    
+    for (size_t value = 0; value != histogram::NUMBER_OF_CHARACTERS; ++value)
+    {
+        if (counts.get_count((int8_t) value) == 0)
+        {
+            smoothed.set_count((int8_t) value, 1);
+        }
+    }
+    
+    return smoothed;
+}
+
+// Builds the code of the smoothed counts within the length limit:
+static code_table build_dictionary_code(const histogram& counts,
+                                        size_t max_code_length)
+{
+    histogram smoothed = smooth_counts(counts);
+    code_table table = build_minimum_redundancy_code(smoothed);
+    
+    if (table.max_length() > max_code_length)
+    {
+        table = build_length_limited_code(smoothed, max_code_length);
+    }
+    
+    return table;
+}
+
+huffman_dictionary::huffman_dictionary(const histogram& counts,
+                                       size_t max_code_length)
+:
+    huffman_dictionary(build_dictionary_code(counts, max_code_length))
+{}
+
+huffman_dictionary::huffman_dictionary(const code_table& table)
+:
+    id{compute_id(table)},
+    table{table},
+    decode_table{table}
+{}
+
+huffman_dictionary huffman_dictionary::load(std::istream& in)
+{
+    std::vector<int8_t> data((std::istreambuf_iterator<char>(in)),
+                             std::istreambuf_iterator<char>());
+    size_t index = sizeof(MAGIC) + 4;
+    
+    if (data.size() < index ||
+        !std::equal(MAGIC, MAGIC + sizeof(MAGIC), data.begin()))
+    {
+        throw file_format_error{"Not a dictionary file."};
+    }
+    
+    uint32_t id = 0;
+    
+    for (size_t i = 0; i != 4; ++i)
+    {
+        id |= (uint32_t)(uint8_t) data[sizeof(MAGIC) + i] << (8 * i);
+    }
+    
+    code_table table;
+    
+    try
+    {
+        huffman_deserializer deserializer;
+        table = deserializer.extract_code_table(data, index);
+    }
+    catch (std::out_of_range& error)
+    {
+        throw file_format_error{"The dictionary file is too short to contain "
+                                "the code word lengths."};
+    }
+    
+    if (table.number_of_code_words() != code_table::NUMBER_OF_CHARACTERS ||
+        index != data.size() ||
+        compute_id(table) != id)
+    {
+        throw file_format_error{"The dictionary file is corrupt."};
+    }
+    
+    return huffman_dictionary(table);
+}
+
+void huffman_dictionary::save(std::ostream& out) const
+{
+    std::vector<int8_t> data(MAGIC, MAGIC + sizeof(MAGIC));
+    
+    for (size_t i = 0; i != 4; ++i)
+    {
+        data.push_back((int8_t)(id >> (8 * i)));
+    }
+    
+    huffman_serializer serializer;
+    serializer.append_code_table(table, data);
+    out.write((const char*) data.data(), data.size());
+    
+    if (!out)
+    {
+        throw std::runtime_error{"Could not write the dictionary."};
+    }
+}
+
+uint32_t huffman_dictionary::get_id() const
+{
+    return id;
+}
+
+const code_table& huffman_dictionary::get_code_table() const
+{
+    return table;
+}
+
+const huffman_decode_table& huffman_dictionary::get_decode_table() const
+{
+    return decode_table;
+}
+
+uint32_t huffman_dictionary::compute_id(const code_table& table)
+{
+    uint32_t hash = 2166136261u;
+    
+    for (size_t value = 0; value != code_table::NUMBER_OF_CHARACTERS; ++value)
+    {
+        hash ^= (uint32_t) table.get_length((int8_t) value);
+        hash *= 16777619u;
+    }
+    
+    return hash;
+}
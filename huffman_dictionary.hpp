@@ -0,0 +1,77 @@
+#ifndef HUFFMAN_DICTIONARY_HPP
+#define HUFFMAN_DICTIONARY_HPP
+
+#include "code_table.hpp"
+#include "histogram.hpp"
+#include "huffman_decode_table.hpp"
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+/******************************************************************************
+* A code table trained in advance on a sample corpus and shared by the        *
+* compressor and the decompressor, so that the blocks coded with it carry     *
+* neither code word lengths nor build a table of their own. Every character   *
+* has a code word, so any text can be coded with the dictionary. The          *
+* dictionary is identified by a hash of its code word lengths, which the      *
+* blocks store to make sure they are decoded with the same dictionary.        *
+*                                                                             *
+* A dictionary file holds 'MAGIC', the 32-bit little-endian identifier and    *
+* the code word lengths in the layout of the version 2 format.                *
+******************************************************************************/
+class huffman_dictionary {
+public:
+    
+    static const int8_t MAGIC[4];
+    
+    /**************************************************************************
+    * Trains the dictionary on the character counts of a sample corpus. The   *
+    * characters absent from the corpus get the count of one. No code word is *
+    * longer than 'max_code_length' bits.                                     *
+    **************************************************************************/
+    explicit huffman_dictionary(
+                const histogram& counts,
+                size_t max_code_length = code_table::MAX_CODE_WORD_LENGTH);
+    
+    /**************************************************************************
+    * Reads the dictionary file 'in'. Throws 'file_format_error' if it is not *
+    * a valid dictionary.                                                     *
+    **************************************************************************/
+    static huffman_dictionary load(std::istream& in);
+    
+    /***************************************
+    * Writes the dictionary file to 'out'. *
+    ***************************************/
+    void save(std::ostream& out) const;
+    
+    /*********************************************************************
+    * Returns the identifier the blocks coded with the dictionary store. *
+    *********************************************************************/
+    uint32_t get_id() const;
+    
+    /************************************************
+    * Returns the code words of all the characters. *
+    ************************************************/
+    const code_table& get_code_table() const;
+    
+    /********************************************************************
+    * Returns the table decoding the code words, built once for all the *
+    * blocks.                                                           *
+    ********************************************************************/
+    const huffman_decode_table& get_decode_table() const;
+    
+private:
+    
+    uint32_t id;
+    code_table table;
+    huffman_decode_table decode_table;
+    
+    // Adopts the canonical code words of 'table':
+    explicit huffman_dictionary(const code_table& table);
+    
+    // Returns the FNV-1a hash of the code word lengths:
+    static uint32_t compute_id(const code_table& table);
+};
+
+#endif // HUFFMAN_DICTIONARY_HPP
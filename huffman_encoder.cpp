@@ -1,19 +1,152 @@
 #include "bit_string.hpp"
 #include "huffman_encoder.hpp"
 
+#include <algorithm>
 #include <map>
+#include <utility>
 
 bit_string huffman_encoder::encode(std::map<int8_t, bit_string>& encoder_map,
                                    std::vector<int8_t>& text)
 {
-    bit_string output_bit_string;
-    size_t text_length = text.size();
+    code_table table(encoder_map);
+    return encode(table, text);
+}
+
+bit_string huffman_encoder::encode(const code_table& table,
+                                   const std::vector<int8_t>& text)
+{
+    return encode(table, text.data(), text.size());
+}
+
+bit_string huffman_encoder::encode(const code_table& table,
+                                   const int8_t* text,
+                                   size_t length)
+{
+    return encode_strided(table, text, length, 1);
+}
+
+std::vector<bit_string>
+huffman_encoder::encode_interleaved(const code_table& table,
+                                    const int8_t* text,
+                                    size_t length,
+                                    size_t number_of_streams)
+{
+    std::vector<bit_string> streams;
+    
+    for (size_t stream = 0; stream != number_of_streams; ++stream)
+    {
+        size_t stream_length = length > stream ? length - stream : 0;
+        streams.push_back(encode_strided(table,
+                                         text + stream,
+                                         stream_length,
+                                         number_of_streams));
+    }
+    
+    return streams;
+}
+
+bit_string huffman_encoder::encode_strided(const code_table& table,
+                                           const int8_t* text,
+                                           size_t length,
+                                           size_t stride)
+{
+    std::vector<uint64_t> words;
+    size_t number_of_bits = encode_words(table, text, length, stride, words);
+    size_t number_of_words = (number_of_bits + bit_string::BITS_PER_UINT64 - 1)
+                           / bit_string::BITS_PER_UINT64;
+    const size_t min_number_of_words = bit_string::DEFAULT_NUMBER_OF_UINT64S;
+    words.resize(std::max(number_of_words, min_number_of_words));
+    return bit_string(std::move(words), number_of_bits);
+}
+
+// Packs the code words of every 'stride'th character of the 'length'
+// characters starting at 'text' into 'words', least significant bit first,
+// and returns the number of the packed bits. 'code_table_of' returns the code
+// table of each character and is called on the characters in order:
+template<typename code_table_lookup>
+static size_t pack_code_words(const int8_t* text,
+                              size_t length,
+                              size_t stride,
+                              code_table_lookup code_table_of,
+                              std::vector<uint64_t>& words)
+{
+    // No optimal code spends more than a byte per character on average, so
+    // the initial guess rarely needs to grow. Resizing keeps the capacity of
+    // reused words:
+    words.resize(length / stride / sizeof(uint64_t) + 2);
+    size_t word_index = 0;
+    uint64_t accumulator = 0;
+    size_t accumulator_length = 0;
+    
+    for (size_t index = 0; index < length; index += stride)
+    {
+        int8_t character = text[index];
+        const code_table& table = code_table_of(character);
+        uint64_t bits = table.get_bits(character);
+        size_t code_length = table.get_length(character);
+        
+        accumulator |= bits << accumulator_length;
+        accumulator_length += code_length;
+        
+        if (accumulator_length >= bit_string::BITS_PER_UINT64)
+        {
+            if (word_index == words.size())
+            {
+                words.resize(2 * words.size());
+            }
+            
+            words[word_index++] = accumulator;
+            accumulator_length -= bit_string::BITS_PER_UINT64;
+            
+            // Keep the bits of the code word that did not fit:
+            accumulator = bits >> (code_length - accumulator_length);
+        }
+    }
     
-    for (size_t index = 0; index != text_length; ++index)
+    size_t number_of_bits =
+        word_index * bit_string::BITS_PER_UINT64 + accumulator_length;
+    
+    if (accumulator_length > 0)
     {
-        int8_t current_byte = text[index];
-        output_bit_string.append_bits_from(encoder_map[current_byte]);
+        if (word_index == words.size())
+        {
+            words.resize(words.size() + 1);
+        }
+        
+        words[word_index++] = accumulator;
     }
     
-    return output_bit_string;
+    return number_of_bits;
+}
+
+size_t huffman_encoder::encode_words(const code_table& table,
+                                     const int8_t* text,
+                                     size_t length,
+                                     size_t stride,
+                                     std::vector<uint64_t>& words)
+{
+    auto code_table_of = [&table](int8_t) -> const code_table& {
+        return table;
+    };
+    
+    return pack_code_words(text, length, stride, code_table_of, words);
+}
+
+size_t huffman_encoder::encode_words_with_contexts(
+                                        const code_table* tables,
+                                        const uint8_t* context_map,
+                                        const int8_t* text,
+                                        size_t length,
+                                        std::vector<uint64_t>& words)
+{
+    const code_table* table = &tables[context_map[0]];
+    
+    // The table of a character is chosen by the one before it:
+    auto code_table_of = [&](int8_t character) -> const code_table& {
+        const code_table& current = *table;
+        table = &tables[context_map[(uint8_t) character]];
+        return current;
+    };
+    
+    return pack_code_words(text, length, 1, code_table_of, words);
 }
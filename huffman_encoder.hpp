@@ -2,6 +2,7 @@
 #define HUFFMAN_ENCODER_HPP
 
 #include "bit_string.hpp"
+#include "code_table.hpp"
 #include <map>
 #include <vector>
 
@@ -14,6 +15,63 @@ public:
     ***************************************************************************/
     bit_string encode(std::map<int8_t, bit_string>& encoder_map,
                       std::vector<int8_t>& text);
+    
+    /***************************************************************************
+    * Encodes the input "text" using the code words of 'table'. The code words *
+    * are packed into a 64-bit accumulator that is flushed a word at a time.   *
+    ***************************************************************************/
+    bit_string encode(const code_table& table, const std::vector<int8_t>& text);
+    
+    /**************************************************************************
+    * Encodes the 'length' characters starting at 'text' using the code words *
+    * of 'table'.                                                             *
+    **************************************************************************/
+    bit_string encode(const code_table& table,
+                      const int8_t* text,
+                      size_t length);
+    
+    /********************************************************************
+    * Splits the 'length' characters starting at 'text' into            *
+    * 'number_of_streams' interleaved streams sharing the code words of *
+    * 'table'. The character at index 'i' goes to the stream            *
+    * 'i % number_of_streams'.                                          *
+    ********************************************************************/
+    std::vector<bit_string> encode_interleaved(const code_table& table,
+                                               const int8_t* text,
+                                               size_t length,
+                                               size_t number_of_streams);
+    
+    /*************************************************************************
+    * Encodes every 'stride'th character of the 'length' characters starting *
+    * at 'text' into 'words', least significant bit first, and returns the   *
+    * number of the encoded bits. The storage of 'words' is reused.          *
+    *************************************************************************/
+    size_t encode_words(const code_table& table,
+                        const int8_t* text,
+                        size_t length,
+                        size_t stride,
+                        std::vector<uint64_t>& words);
+    
+    /***********************************************************************
+    * Encodes the 'length' characters starting at 'text' into 'words' like *
+    * 'encode_words', coding each character with the table                 *
+    * 'tables[context_map[c]]', where 'c' is the preceding character, or 0 *
+    * for the first one.                                                   *
+    ***********************************************************************/
+    size_t encode_words_with_contexts(const code_table* tables,
+                                      const uint8_t* context_map,
+                                      const int8_t* text,
+                                      size_t length,
+                                      std::vector<uint64_t>& words);
+    
+private:
+    
+    // Encodes every 'stride'th character of the 'length' characters starting
+    // at 'text':
+    bit_string encode_strided(const code_table& table,
+                              const int8_t* text,
+                              size_t length,
+                              size_t stride);
 };
 
 #endif // HUFFMAN_ENCODER_HPP
@@ -1,22 +1,36 @@
 #include "huffman_serializer.hpp"
+#include "varint.hpp"
 #include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
 
 const int8_t huffman_serializer::MAGIC[4] = { (int8_t) 0xC0,
                                               (int8_t) 0xDE,
                                               (int8_t) 0x0D,
                                               (int8_t) 0xDE };
 
+const int8_t huffman_serializer::MAGIC_V2[4] = { (int8_t) 0xC0,
+                                                 (int8_t) 0xDE,
+                                                 (int8_t) 0x0D,
+                                                 (int8_t) 0xE2 };
+
 const size_t huffman_serializer::BYTES_PER_WEIGHT_MAP_ENTRY      = 5;
 const size_t huffman_serializer::BYTES_PER_CODE_WORD_COUNT_ENTRY = 4;
 const size_t huffman_serializer::BYTES_PER_BIT_COUNT_ENTRY       = 4;
+const size_t huffman_serializer::MAX_BYTES_PER_BIT_COUNT_ENTRY_V2 = 10;
+const size_t huffman_serializer::BYTES_PER_CHARACTER_BITMAP       = 32;
+const size_t huffman_serializer::MAX_LISTED_CHARACTERS            = 32;
+const size_t huffman_serializer::MAX_NIBBLE_CODE_WORD_LENGTH      = 15;
 
-static size_t compute_byte_list_size(std::map<int8_t, uint32_t>& count_map,
+static size_t compute_byte_list_size(const histogram& counts,
                                      bit_string& encoded_text)
 {
     return sizeof(huffman_serializer::MAGIC)
                   + huffman_serializer::BYTES_PER_CODE_WORD_COUNT_ENTRY
                   + huffman_serializer::BYTES_PER_BIT_COUNT_ENTRY
-                  + count_map.size()
+                  + counts.number_of_characters()
                     * huffman_serializer::BYTES_PER_WEIGHT_MAP_ENTRY
                   + encoded_text.get_number_of_occupied_bytes();
 }
@@ -24,9 +38,23 @@ static size_t compute_byte_list_size(std::map<int8_t, uint32_t>& count_map,
 std::vector<int8_t>
 huffman_serializer::serialize(std::map<int8_t, uint32_t>& count_map,
                               bit_string& encoded_text)
+{
+    return serialize(histogram(count_map), encoded_text);
+}
+
+std::vector<int8_t>
+huffman_serializer::serialize(const std::map<int8_t, uint8_t>& code_length_map,
+                              bit_string& encoded_text)
+{
+    return serialize(code_table(code_length_map), encoded_text);
+}
+
+std::vector<int8_t>
+huffman_serializer::serialize(const histogram& counts,
+                              bit_string& encoded_text)
 {
     std::vector<int8_t> byte_list;
-    byte_list.reserve(compute_byte_list_size(count_map, encoded_text));
+    byte_list.reserve(compute_byte_list_size(counts, encoded_text));
     
     // Emit the file type signature magic:
     for (int8_t magic_byte : huffman_serializer::MAGIC)
@@ -40,7 +68,7 @@ huffman_serializer::serialize(std::map<int8_t, uint32_t>& count_map,
         int8_t bytes[4];
     } t;
     
-    t.num = (uint32_t) count_map.size();
+    t.num = (uint32_t) counts.number_of_characters();
     
     byte_list.push_back(t.bytes[0]);
     byte_list.push_back(t.bytes[1]);
@@ -61,13 +89,18 @@ huffman_serializer::serialize(std::map<int8_t, uint32_t>& count_map,
     }
     count_bytes;
     
-    // Emit the code words:
-    for (const auto& entry : count_map)
+    // Emit the code words in the order of the signed character values:
+    for (int value = INT8_MIN; value <= INT8_MAX; ++value)
     {
-        int8_t byte = entry.first;
-        byte_list.push_back(byte);
+        int8_t byte = (int8_t) value;
+        uint32_t count = counts.get_count(byte);
+        
+        if (count == 0)
+        {
+            continue;
+        }
         
-        uint32_t count = entry.second;
+        byte_list.push_back(byte);
         count_bytes.count = count;
         
         byte_list.push_back(count_bytes.bytes[0]);
@@ -76,11 +109,109 @@ huffman_serializer::serialize(std::map<int8_t, uint32_t>& count_map,
         byte_list.push_back(count_bytes.bytes[3]);
     }
     
-    std::vector<int8_t> encoded_text_byte_vector = encoded_text.to_byte_array();
+    encoded_text.append_bytes_to(byte_list);
+    return byte_list;
+}
+
+std::vector<int8_t>
+huffman_serializer::serialize(const code_table& table,
+                              bit_string& encoded_text)
+{
+    if (table.number_of_code_words() == 0)
+    {
+        throw std::runtime_error{"No code word lengths to serialize."};
+    }
+    
+    std::vector<int8_t> byte_list;
+    byte_list.reserve(sizeof(huffman_serializer::MAGIC_V2)
+                      + huffman_serializer::MAX_BYTES_PER_BIT_COUNT_ENTRY_V2
+                      + huffman_serializer::BYTES_PER_CHARACTER_BITMAP
+                      + table.number_of_code_words() + 2
+                      + encoded_text.get_number_of_occupied_bytes());
     
-    std::copy(encoded_text_byte_vector.begin(),
-              encoded_text_byte_vector.end(),
-              std::back_inserter(byte_list));
+    // Emit the file type signature magic:
+    for (int8_t magic_byte : huffman_serializer::MAGIC_V2)
+    {
+        byte_list.push_back(magic_byte);
+    }
     
+    append_varint(encoded_text.length(), byte_list);
+    append_code_table(table, byte_list);
+    encoded_text.append_bytes_to(byte_list);
     return byte_list;
 }
+
+void huffman_serializer::append_code_table(const code_table& table,
+                                           std::vector<int8_t>& byte_list)
+{
+    if (table.number_of_code_words() == 0)
+    {
+        throw std::runtime_error{"No code word lengths to serialize."};
+    }
+    
+    // Collect the characters and their lengths in the order of the unsigned
+    // values:
+    uint8_t characters[code_table::NUMBER_OF_CHARACTERS];
+    uint8_t code_lengths[code_table::NUMBER_OF_CHARACTERS];
+    size_t number_of_characters = 0;
+    uint8_t max_code_length = (uint8_t) table.max_length();
+    
+    for (size_t value = 0; value != code_table::NUMBER_OF_CHARACTERS; ++value)
+    {
+        size_t code_length = table.get_length((int8_t) value);
+        
+        if (code_length != 0)
+        {
+            characters[number_of_characters] = (uint8_t) value;
+            code_lengths[number_of_characters] = (uint8_t) code_length;
+            ++number_of_characters;
+        }
+    }
+    
+    byte_list.push_back((int8_t)(number_of_characters - 1));
+    
+    // Emit the present characters either as a list or as a bitmap, whichever
+    // is shorter:
+    if (number_of_characters <= MAX_LISTED_CHARACTERS)
+    {
+        for (size_t i = 0; i != number_of_characters; ++i)
+        {
+            byte_list.push_back((int8_t) characters[i]);
+        }
+    }
+    else
+    {
+        uint8_t bitmap[BYTES_PER_CHARACTER_BITMAP] = {};
+        
+        for (size_t i = 0; i != number_of_characters; ++i)
+        {
+            bitmap[characters[i] / CHAR_BIT] |=
+                (uint8_t)(1 << (characters[i] % CHAR_BIT));
+        }
+        
+        for (uint8_t bitmap_byte : bitmap)
+        {
+            byte_list.push_back((int8_t) bitmap_byte);
+        }
+    }
+    
+    // Emit the code word lengths, two per byte if they fit in a nibble:
+    byte_list.push_back((int8_t) max_code_length);
+    
+    if (max_code_length <= MAX_NIBBLE_CODE_WORD_LENGTH)
+    {
+        for (size_t i = 0; i < number_of_characters; i += 2)
+        {
+            uint8_t high = (i + 1 < number_of_characters) ? code_lengths[i + 1]
+                                                          : 0;
+            byte_list.push_back((int8_t)(code_lengths[i] | (high << 4)));
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i != number_of_characters; ++i)
+        {
+            byte_list.push_back((int8_t) code_lengths[i]);
+        }
+    }
+}
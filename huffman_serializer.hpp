@@ -2,6 +2,8 @@
 #define HUFFMAN_SERIALIZER_HPP
 
 #include "bit_string.hpp"
+#include "code_table.hpp"
+#include "histogram.hpp"
 #include <cstdint>
 #include <cstdlib>
 #include <map>
@@ -11,12 +13,45 @@ class huffman_serializer {
 public:
     
     static const int8_t MAGIC[4];
+    static const int8_t MAGIC_V2[4];
     static const size_t BYTES_PER_WEIGHT_MAP_ENTRY;
     static const size_t BYTES_PER_CODE_WORD_COUNT_ENTRY;
     static const size_t BYTES_PER_BIT_COUNT_ENTRY;
+    static const size_t MAX_BYTES_PER_BIT_COUNT_ENTRY_V2;
+    static const size_t BYTES_PER_CHARACTER_BITMAP;
+    static const size_t MAX_LISTED_CHARACTERS;
+    static const size_t MAX_NIBBLE_CODE_WORD_LENGTH;
+    
+    /******************************************************************
+    * Emits the version 1 format storing the count of each character. *
+    ******************************************************************/
+    std::vector<int8_t> serialize(const histogram& counts,
+                                  bit_string& encoded_text);
     
     std::vector<int8_t> serialize(std::map<int8_t, uint32_t>& count_map,
                                   bit_string& encoded_text);
+    
+    /***************************************************************************
+    * Emits the version 2 format storing only the canonical code word lengths. *
+    * After the magic come the number of encoded text bits as a varint, the    *
+    * number of characters minus one, the characters as a list (up to 32 of    *
+    * them) or as a bitmap, the maximum code word length and the lengths in    *
+    * the order of the unsigned character values, packed as nibbles unless     *
+    * some length exceeds 15. Only the lengths of the 'table' are stored.      *
+    ***************************************************************************/
+    std::vector<int8_t> serialize(const code_table& table,
+                                  bit_string& encoded_text);
+    
+    /************************************************************************
+    * Appends the code word lengths of 'table' to 'byte_list' in the layout *
+    * used by the version 2 format.                                         *
+    ************************************************************************/
+    void append_code_table(const code_table& table,
+                           std::vector<int8_t>& byte_list);
+    
+    std::vector<int8_t> serialize(
+                            const std::map<int8_t, uint8_t>& code_length_map,
+                            bit_string& encoded_text);
 };
 
 #endif // HUFFMAN_SERIALIZER_HPP
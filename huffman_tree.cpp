@@ -1,5 +1,7 @@
 #include "bit_string.hpp"
+#include "canonical_code.hpp"
 #include "huffman_tree.hpp"
+#include <algorithm>
 #include <sstream>
 #include <stdexcept>
 #include <cstdint>
@@ -9,8 +11,13 @@
 #include <vector>
 
 huffman_tree::huffman_tree(std::map<int8_t, uint32_t>& count_map)
+:
+    huffman_tree(histogram(count_map))
+{}
+
+huffman_tree::huffman_tree(const histogram& counts)
 {
-    if (count_map.empty())
+    if (counts.number_of_characters() == 0)
     {
         std::stringstream ss;
         ss << "Compressor requires a non-empty text.";
@@ -21,13 +28,15 @@ huffman_tree::huffman_tree(std::map<int8_t, uint32_t>& count_map)
                         std::vector<huffman_tree_node*>,
                         huffman_tree::huffman_tree_node_comparator> queue;
     
-    std::for_each(count_map.cbegin(),
-                  count_map.cend(),
-                  [&queue](std::pair<int8_t, uint32_t> p) {
-                      queue.push(new huffman_tree_node(p.first,
-                                                       p.second,
-                                                       true));
-                  });
+    for (size_t value = 0; value != histogram::NUMBER_OF_CHARACTERS; ++value)
+    {
+        uint32_t count = counts.get_count((int8_t) value);
+        
+        if (count != 0)
+        {
+            queue.push(new huffman_tree_node((int8_t) value, count, true));
+        }
+    }
     
     while (queue.size() > 1)
     {
@@ -59,23 +68,33 @@ huffman_tree::~huffman_tree()
 
 std::map<int8_t, bit_string> huffman_tree::infer_encoder_map()
 {
-    std::map<int8_t, bit_string> map;
+    return infer_code_table().to_encoder_map();
+}
+
+code_table huffman_tree::infer_code_table()
+{
+    code_table table;
     
     if (root->is_leaf)
     {
-        root->is_leaf = false;
-        root->left = new huffman_tree_node(root->character,
-                                           1,
-                                           true);
-        bit_string b;
-        b.append_bit(false);
-        map[root->character] = std::move(b);
-        return map;
+        table.set_code_word(root->character, 0, 1);
+        return table;
     }
     
-    bit_string code_word;
-    infer_encoder_map_impl(code_word, root, map);
-    return map;
+    infer_code_table_impl(root, 0, 0, table);
+    return table;
+}
+
+code_table huffman_tree::infer_canonical_code_table()
+{
+    code_table table = infer_code_table();
+    assign_canonical_code_words(table);
+    return table;
+}
+
+std::map<int8_t, uint8_t> huffman_tree::infer_code_length_map()
+{
+    return infer_code_table().to_code_length_map();
 }
 
 int8_t huffman_tree::decode_bit_string(size_t& index, bit_string& bits)
@@ -97,28 +116,31 @@ int8_t huffman_tree::decode_bit_string(size_t& index, bit_string& bits)
     return current_node->character;
 }
 
-void huffman_tree::infer_encoder_map_impl(
-                            bit_string& current_code_word,
-                            huffman_tree::huffman_tree_node* node,
-                            std::map<int8_t, bit_string>& map)
+void huffman_tree::infer_code_table_impl(huffman_tree::huffman_tree_node* node,
+                                         uint64_t code_word_bits,
+                                         size_t depth,
+                                         code_table& table)
 {
     if (node->is_leaf)
     {
-        map[node->character] = bit_string(current_code_word);
+        table.set_code_word(node->character, code_word_bits, depth);
         return;
     }
     
-    current_code_word.append_bit(false);
-    infer_encoder_map_impl(current_code_word,
-                           node->left,
-                           map);
-    current_code_word.remove_last_bit();
+    if (depth == code_table::MAX_CODE_WORD_LENGTH)
+    {
+        std::stringstream ss;
+        ss << "The Huffman tree is deeper than "
+           << code_table::MAX_CODE_WORD_LENGTH
+           << " levels.";
+        throw std::runtime_error{ss.str()};
+    }
     
-    current_code_word.append_bit(true);
-    infer_encoder_map_impl(current_code_word,
-                           node->right,
-                           map);
-    current_code_word.remove_last_bit();
+    infer_code_table_impl(node->left, code_word_bits, depth + 1, table);
+    infer_code_table_impl(node->right,
+                          code_word_bits | (1ULL << depth),
+                          depth + 1,
+                          table);
 }
 
 huffman_tree::huffman_tree_node* huffman_tree::merge(huffman_tree_node* node1,
@@ -2,9 +2,18 @@
 #define HUFFMAN_TREE_HPP
 
 #include "bit_string.hpp"
+#include "code_table.hpp"
+#include "histogram.hpp"
 #include <cstdint>
 #include <map>
 
+/******************************************************************************
+* The pointer-based Huffman tree. The block compressor computes its code word *
+* lengths with 'build_minimum_redundancy_code' instead. The tree remains the  *
+* reference the flat computation is tested against, the decoder of the        *
+* version 1 format, whose code words depend on the tie breaking of the tree,  *
+* and a view of the code for debugging.                                       *
+******************************************************************************/
 class huffman_tree
 {
 public:
@@ -13,6 +22,11 @@ public:
     ******************************************************/
     explicit huffman_tree(std::map<int8_t, uint32_t>& count_map);
     
+    /**********************************************************
+    * Builds this Huffman tree using the character histogram. *
+    **********************************************************/
+    explicit huffman_tree(const histogram& counts);
+    
     ~huffman_tree();
     
     /*****************************************
@@ -20,6 +34,24 @@ public:
     *****************************************/ 
     std::map<int8_t, bit_string> infer_encoder_map();
     
+    /**************************************************************************
+    * Infers the code words of this tree. A lone character gets the code word *
+    * '0'.                                                                    *
+    **************************************************************************/
+    code_table infer_code_table();
+    
+    /***********************************************************************
+    * Infers the canonical code words having the code word lengths of this *
+    * tree.                                                                *
+    ***********************************************************************/
+    code_table infer_canonical_code_table();
+    
+    /***********************************************************************
+    * Infers the code word length of each character from this tree. A lone *
+    * character gets a code word of length one.                            *
+    ***********************************************************************/
+    std::map<int8_t, uint8_t> infer_code_length_map();
+    
     /***************************************************************************
     * Decodes the next character from the bit string starting at bit with      *
     * index 'start_index'. This method will advance the value of 'start_index' *
@@ -62,10 +94,11 @@ private:
     huffman_tree_node* merge(huffman_tree_node* node1,
                              huffman_tree_node* node2);
     
-    // The recursive implementation of the routine that builds the encoder map:
-    void infer_encoder_map_impl(bit_string& bit_string_builder,
-                                huffman_tree_node* current_node,
-                                std::map<int8_t, bit_string>& map);
+    // The recursive implementation of the routine that builds the code table:
+    void infer_code_table_impl(huffman_tree_node* current_node,
+                               uint64_t code_word_bits,
+                               size_t depth,
+                               code_table& table);
     
     // Checks that the input count is positive:
     uint32_t check_count(uint32_t count);
@@ -0,0 +1,170 @@
+#include "canonical_code.hpp"
+#include "length_limited_code.hpp"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// An item of a package-merge list, either a character or a package of two
+// items of the list below:
+struct package_merge_item {
+    uint64_t weight;
+    bool     is_package;
+};
+
+code_table build_length_limited_code(const histogram& counts,
+                                     size_t max_length)
+{
+    std::vector<int8_t> characters;
+    
+    for (size_t value = 0; value != histogram::NUMBER_OF_CHARACTERS; ++value)
+    {
+        if (counts.get_count((int8_t) value) != 0)
+        {
+            characters.push_back((int8_t) value);
+        }
+    }
+    
+    size_t n = characters.size();
+    
+    if (max_length == 0 ||
+        max_length > code_table::MAX_CODE_WORD_LENGTH ||
+        (max_length < 64 && n > (1ULL << max_length)))
+    {
+        std::stringstream ss;
+        ss << "Cannot code " << n << " characters with code words of at "
+           << "most " << max_length << " bits.";
+        throw std::invalid_argument{ss.str()};
+    }
+    
+    code_table table;
+    
+    if (n == 1)
+    {
+        table.set_code_word(characters[0], 0, 1);
+        return table;
+    }
+    
+    // The lightest characters first; the ties are broken by the character
+    // value so that the code does not depend on the sort implementation:
+    std::sort(characters.begin(),
+              characters.end(),
+              [&counts](int8_t lhs, int8_t rhs) {
+                  uint32_t lhs_count = counts.get_count(lhs);
+                  uint32_t rhs_count = counts.get_count(rhs);
+                  
+                  if (lhs_count != rhs_count)
+                  {
+                      return lhs_count < rhs_count;
+                  }
+                  
+                  return (uint8_t) lhs < (uint8_t) rhs;
+              });
+    
+    // lists[d] is the merged list of the depth 'd + 1'. The deepest list
+    // holds the characters alone; each shallower one merges them with the
+    // packages of adjacent pairs of the list below:
+    std::vector<std::vector<package_merge_item>> lists(max_length);
+    
+    for (size_t depth = max_length; depth != 0; --depth)
+    {
+        std::vector<package_merge_item>& list = lists[depth - 1];
+        list.reserve(2 * n);
+        size_t character_index = 0;
+        size_t package_index = 0;
+        size_t number_of_packages = 0;
+        
+        if (depth != max_length)
+        {
+            number_of_packages = lists[depth].size() / 2;
+        }
+        
+        while (character_index != n || package_index != number_of_packages)
+        {
+            uint64_t character_weight = UINT64_MAX;
+            uint64_t package_weight = UINT64_MAX;
+            
+            if (character_index != n)
+            {
+                character_weight =
+                    counts.get_count(characters[character_index]);
+            }
+            
+            if (package_index != number_of_packages)
+            {
+                const std::vector<package_merge_item>& below = lists[depth];
+                package_weight = below[2 * package_index].weight
+                               + below[2 * package_index + 1].weight;
+            }
+            
+            if (character_index != n && character_weight <= package_weight)
+            {
+                list.push_back({ character_weight, false });
+                ++character_index;
+            }
+            else
+            {
+                list.push_back({ package_weight, true });
+                ++package_index;
+            }
+        }
+    }
+    
+    // Select the '2n - 2' lightest items of the shallowest list and follow
+    // the selected packages down. Every selected occurrence of a character
+    // adds one bit to its code word; the selected characters of a list are
+    // always its lightest ones:
+    std::vector<size_t> lengths(n, 0);
+    size_t number_of_selected_items = 2 * n - 2;
+    
+    for (size_t depth = 1;
+         depth <= max_length && number_of_selected_items != 0;
+         ++depth)
+    {
+        const std::vector<package_merge_item>& list = lists[depth - 1];
+        size_t number_of_selected_characters = 0;
+        size_t number_of_selected_packages = 0;
+        
+        for (size_t i = 0; i != number_of_selected_items; ++i)
+        {
+            if (list[i].is_package)
+            {
+                ++number_of_selected_packages;
+            }
+            else
+            {
+                ++number_of_selected_characters;
+            }
+        }
+        
+        for (size_t i = 0; i != number_of_selected_characters; ++i)
+        {
+            ++lengths[i];
+        }
+        
+        number_of_selected_items = 2 * number_of_selected_packages;
+    }
+    
+    for (size_t i = 0; i != n; ++i)
+    {
+        table.set_code_word(characters[i], 0, lengths[i]);
+    }
+    
+    assign_canonical_code_words(table);
+    return table;
+}
+
+uint64_t compute_encoded_length(const histogram& counts,
+                                const code_table& table)
+{
+    uint64_t number_of_bits = 0;
+    
+    for (size_t value = 0; value != histogram::NUMBER_OF_CHARACTERS; ++value)
+    {
+        number_of_bits += (uint64_t) counts.get_count((int8_t) value)
+                        * table.get_length((int8_t) value);
+    }
+    
+    return number_of_bits;
+}
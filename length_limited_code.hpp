@@ -0,0 +1,26 @@
+#ifndef LENGTH_LIMITED_CODE_HPP
+#define LENGTH_LIMITED_CODE_HPP
+
+#include "code_table.hpp"
+#include "histogram.hpp"
+#include <cstdint>
+
+/******************************************************************************
+* Builds the canonical prefix code minimizing the encoded length of the       *
+* characters counted in 'counts' under the constraint that no code word is    *
+* longer than 'max_length' bits. Uses the package-merge algorithm, which runs *
+* in time proportional to the number of characters times 'max_length'. Throws *
+* 'std::invalid_argument' if 'max_length' bits cannot give every character a  *
+* code word or exceed 'code_table::MAX_CODE_WORD_LENGTH'.                     *
+******************************************************************************/
+code_table build_length_limited_code(const histogram& counts,
+                                     size_t max_length);
+
+/**************************************************************************
+* Returns the number of bits the characters counted in 'counts' take when *
+* encoded with the code words of 'table'.                                 *
+**************************************************************************/
+uint64_t compute_encoded_length(const histogram& counts,
+                                const code_table& table);
+
+#endif // LENGTH_LIMITED_CODE_HPP
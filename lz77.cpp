@@ -0,0 +1,256 @@
+#include "lz77.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+const size_t lz77_matcher::MIN_LEVEL        = 1;
+const size_t lz77_matcher::MAX_LEVEL        = 9;
+const size_t lz77_matcher::DEFAULT_LEVEL    = 6;
+const size_t lz77_matcher::MIN_MATCH_LENGTH = 4;
+
+// The bits of a hash of the next 'MIN_MATCH_LENGTH' characters:
+static const size_t HASH_BITS = 16;
+
+// The settings of each effort level:
+struct level_settings {
+    size_t max_chain_length;
+    size_t nice_length;
+    bool lazy;
+};
+
+static const level_settings LEVELS[] = {
+    {    4,    16, false },
+    {    8,    32, false },
+    {   16,    64, false },
+    {   16,    32, true  },
+    {   32,    64, true  },
+    {  128,   128, true  },
+    {  256,   256, true  },
+    { 1024,  1024, true  },
+    { 4096, 65536, true  }
+};
+
+lz77_matcher::lz77_matcher(size_t level)
+{
+    set_level(level);
+}
+
+void lz77_matcher::set_level(size_t level)
+{
+    if (level < MIN_LEVEL || level > MAX_LEVEL)
+    {
+        std::stringstream ss;
+        ss << "The effort level must be between "
+           << MIN_LEVEL
+           << " and "
+           << MAX_LEVEL
+           << ".";
+        throw std::runtime_error{ss.str()};
+    }
+    
+    const level_settings& settings = LEVELS[level - MIN_LEVEL];
+    this->level = level;
+    max_chain_length = settings.max_chain_length;
+    nice_length = settings.nice_length;
+    lazy = settings.lazy;
+}
+
+size_t lz77_matcher::get_level() const
+{
+    return level;
+}
+
+static size_t hash(const int8_t* text)
+{
+    uint32_t word;
+    std::memcpy(&word, text, sizeof(word));
+    return (word * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void lz77_matcher::insert(const int8_t* text, size_t position)
+{
+    int32_t& last = head[hash(text + position)];
+    previous[position] = last;
+    last = (int32_t) position;
+}
+
+// Returns the number of the leading characters 'a' and 'b' share, at most
+// 'max_length', comparing eight characters at a time:
+static size_t common_prefix_length(const int8_t* a,
+                                   const int8_t* b,
+                                   size_t max_length)
+{
+    size_t length = 0;
+    
+    while (length + sizeof(uint64_t) <= max_length)
+    {
+        uint64_t a_word;
+        uint64_t b_word;
+        std::memcpy(&a_word, a + length, sizeof(a_word));
+        std::memcpy(&b_word, b + length, sizeof(b_word));
+        uint64_t difference = a_word ^ b_word;
+        
+        if (difference != 0)
+        {
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            return length + __builtin_ctzll(difference) / 8;
+#else
+            break;
+#endif
+        }
+        
+        length += sizeof(uint64_t);
+    }
+    
+    while (length != max_length && a[length] == b[length])
+    {
+        ++length;
+    }
+    
+    return length;
+}
+
+size_t lz77_matcher::find_match(const int8_t* text,
+                                size_t length,
+                                size_t position,
+                                size_t& distance) const
+{
+    size_t max_length = length - position;
+    size_t best_length = MIN_MATCH_LENGTH - 1;
+    int32_t candidate = head[hash(text + position)];
+    
+    for (size_t chain = 0;
+         candidate >= 0 && chain != max_chain_length;
+         ++chain, candidate = previous[candidate])
+    {
+        const int8_t* match = text + candidate;
+        const int8_t* current = text + position;
+        
+        // A longer match must also beat the best one at its last character:
+        if (match[best_length] != current[best_length])
+        {
+            continue;
+        }
+        
+        size_t match_length = common_prefix_length(match, current, max_length);
+        
+        if (match_length > best_length)
+        {
+            best_length = match_length;
+            distance = position - candidate;
+            
+            if (match_length >= nice_length || match_length == max_length)
+            {
+                break;
+            }
+        }
+    }
+    
+    return best_length >= MIN_MATCH_LENGTH ? best_length : 0;
+}
+
+void lz77_matcher::parse(const int8_t* text,
+                         size_t length,
+                         std::vector<lz77_sequence>& sequences)
+{
+    sequences.clear();
+    head.assign((size_t) 1 << HASH_BITS, -1);
+    previous.resize(length);
+    size_t literal_start = 0;
+    size_t position = 0;
+    
+    while (position + MIN_MATCH_LENGTH <= length)
+    {
+        size_t distance = 0;
+        size_t match_length = find_match(text, length, position, distance);
+        insert(text, position);
+        
+        // Leave the character as a literal while the next position has a
+        // longer match:
+        while (lazy &&
+               match_length != 0 &&
+               match_length < nice_length &&
+               position + 1 + MIN_MATCH_LENGTH <= length)
+        {
+            size_t next_distance = 0;
+            size_t next_length = find_match(text,
+                                            length,
+                                            position + 1,
+                                            next_distance);
+            
+            if (next_length <= match_length)
+            {
+                break;
+            }
+            
+            ++position;
+            insert(text, position);
+            match_length = next_length;
+            distance = next_distance;
+        }
+        
+        if (match_length == 0)
+        {
+            ++position;
+            continue;
+        }
+        
+        sequences.push_back({ (uint32_t)(position - literal_start),
+                              (uint32_t) match_length,
+                              (uint32_t) distance });
+        
+        // The strings starting inside the match may be matched later:
+        size_t match_end = position + match_length;
+        size_t last_insertable = length - MIN_MATCH_LENGTH;
+        
+        for (++position;
+             position != match_end && position <= last_insertable;
+             ++position)
+        {
+            insert(text, position);
+        }
+        
+        position = match_end;
+        literal_start = position;
+    }
+    
+    sequences.push_back({ (uint32_t)(length - literal_start), 0, 0 });
+}
+
+uint8_t lz77_value_code(uint32_t value,
+                        uint32_t& extra_bits,
+                        size_t& number_of_extra_bits)
+{
+    if (value < 4)
+    {
+        extra_bits = 0;
+        number_of_extra_bits = 0;
+        return (uint8_t) value;
+    }
+    
+    size_t highest_bit = 31;
+    
+    while ((value >> highest_bit) == 0)
+    {
+        --highest_bit;
+    }
+    
+    number_of_extra_bits = highest_bit - 1;
+    extra_bits = value & ((1u << number_of_extra_bits) - 1);
+    return (uint8_t)(4 + 2 * (highest_bit - 2)
+                       + ((value >> number_of_extra_bits) & 1));
+}
+
+uint32_t lz77_code_base(uint8_t code, size_t& number_of_extra_bits)
+{
+    if (code < 4)
+    {
+        number_of_extra_bits = 0;
+        return code;
+    }
+    
+    size_t highest_bit = 2 + (code - 4) / 2;
+    number_of_extra_bits = highest_bit - 1;
+    return (uint32_t)(2 | ((code - 4) & 1)) << number_of_extra_bits;
+}
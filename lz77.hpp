@@ -0,0 +1,118 @@
+#ifndef LZ77_HPP
+#define LZ77_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A run of literal characters followed by a match, which copies
+// 'match_length' characters starting 'distance' characters back. The match
+// may overlap the characters it produces:
+struct lz77_sequence {
+    uint32_t literal_length;
+    
+    // Zero for the literals closing the text:
+    uint32_t match_length;
+    
+    uint32_t distance;
+};
+
+/******************************************************************************
+* Finds the repeated strings of a text with hash chains. The effort level     *
+* trades the speed for the length of the matches: the higher levels follow    *
+* longer chains and defer a match when the next position has a longer one.    *
+******************************************************************************/
+class lz77_matcher {
+public:
+    
+    static const size_t MIN_LEVEL;
+    static const size_t MAX_LEVEL;
+    static const size_t DEFAULT_LEVEL;
+    
+    // The shortest match worth coding:
+    static const size_t MIN_MATCH_LENGTH;
+    
+    /*************************************************************
+    * Constructs a matcher working at the effort 'level'. Throws *
+    * 'std::runtime_error' if the level is out of range.         *
+    *************************************************************/
+    explicit lz77_matcher(size_t level = DEFAULT_LEVEL);
+    
+    /*********************************************************************
+    * Sets the effort level. Throws 'std::runtime_error' if it is out of *
+    * range.                                                             *
+    *********************************************************************/
+    void set_level(size_t level);
+    
+    /****************************
+    * Returns the effort level. *
+    ****************************/
+    size_t get_level() const;
+    
+    /***********************************************************************
+    * Cuts the 'length' characters starting at 'text' into the 'sequences' *
+    * of literals and matches, which refer only to the text. The last      *
+    * sequence has no match. The memory of the matcher and 'sequences' is  *
+    * reused from call to call.                                            *
+    ***********************************************************************/
+    void parse(const int8_t* text,
+               size_t length,
+               std::vector<lz77_sequence>& sequences);
+    
+private:
+    
+    size_t level;
+    
+    // The most chain links to follow per position:
+    size_t max_chain_length;
+    
+    // The match length that stops the search:
+    size_t nice_length;
+    
+    // Whether a match is deferred if the next position has a longer one:
+    bool lazy;
+    
+    // The last position of each hash, or -1:
+    std::vector<int32_t> head;
+    
+    // The previous position with the hash of each position, or -1:
+    std::vector<int32_t> previous;
+    
+    // Adds the string starting at 'position' to its hash chain:
+    void insert(const int8_t* text, size_t position);
+    
+    // Returns the length of the longest match at 'position' and stores its
+    // distance, or returns 0 if there is no match:
+    size_t find_match(const int8_t* text,
+                      size_t length,
+                      size_t position,
+                      size_t& distance) const;
+};
+
+// The number of codes the lengths and the distances are coded with:
+constexpr size_t LZ77_NUMBER_OF_VALUE_CODES = 64;
+
+// The first code of the numbers of literals, the match lengths and the
+// distances in a stream of the codes of all three:
+constexpr uint8_t LZ77_LITERAL_LENGTH_CODES = 0;
+constexpr uint8_t LZ77_MATCH_LENGTH_CODES   = 64;
+constexpr uint8_t LZ77_DISTANCE_CODES       = 128;
+
+/******************************************************************************
+* Returns the code of 'value' and stores the 'number_of_extra_bits' low bits  *
+* of the value following the code in 'extra_bits'. The values below 4 have    *
+* codes of their own; the higher ones share a code with the values of the     *
+* same two highest bits.                                                      *
+******************************************************************************/
+uint8_t lz77_value_code(uint32_t value,
+                        uint32_t& extra_bits,
+                        size_t& number_of_extra_bits);
+
+/****************************************************************************
+* Returns the smallest value of 'code' and stores the number of its extra   *
+* bits in 'number_of_extra_bits'. 'code' must be below                      *
+* 'LZ77_NUMBER_OF_VALUE_CODES'.                                             *
+****************************************************************************/
+uint32_t lz77_code_base(uint8_t code, size_t& number_of_extra_bits);
+
+#endif // LZ77_HPP
@@ -1,22 +1,52 @@
+#include "adaptive_huffman_coder.hpp"
 #include "bit_string.hpp"
+#include "block_compressor.hpp"
+#include "block_decompressor.hpp"
+#include "file_format_error.h"
 #include "byte_counts.hpp"
+#include "canonical_code.hpp"
+#include "compress_context.hpp"
+#include "decompress_context.hpp"
+#include "huffman_decode_table.hpp"
 #include "huffman_decoder.hpp"
 #include "huffman_deserializer.hpp"
+#include "huffman_dictionary.hpp"
 #include "huffman_encoder.hpp"
 #include "huffman_serializer.hpp"
 #include "huffman_tree.hpp"
+#include "length_limited_code.hpp"
+#include "lz77.hpp"
+#include "mapped_file.hpp"
+#include "minimum_redundancy_code.hpp"
+#include "pipeline_statistics.hpp"
+#include "streaming_compressor.hpp"
+#include "streaming_decompressor.hpp"
+#include "thread_pool.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
 #include <cstdint>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <limits>
+#include <memory>
 #include <map>
 #include <random>
 #include <set>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 using std::cout;
 using std::cerr;
@@ -45,10 +75,77 @@ static std::string HELP_FLAG_SHORT    = "-h";
 static std::string HELP_FLAG_LONG     = "--help";
 static std::string VERSION_FLAG_SHORT = "-v";
 static std::string VERSION_FLAG_LONG  = "--version";
+static std::string THREADS_FLAG_SHORT = "-T";
+static std::string THREADS_FLAG_LONG  = "--threads";
+static std::string STREAMS_FLAG_SHORT = "-S";
+static std::string STREAMS_FLAG_LONG  = "--streams";
+static std::string MAX_LENGTH_FLAG_SHORT = "-L";
+static std::string MAX_LENGTH_FLAG_LONG  = "--max-length";
+static std::string STATS_FLAG_SHORT = "-P";
+static std::string STATS_FLAG_LONG  = "--stats";
+static std::string STDOUT_FLAG_SHORT = "-c";
+static std::string STDOUT_FLAG_LONG  = "--stdout";
+static std::string RANGE_FLAG_SHORT = "-R";
+static std::string RANGE_FLAG_LONG  = "--range";
+static std::string TRAIN_FLAG_SHORT = "-t";
+static std::string TRAIN_FLAG_LONG  = "--train";
+static std::string DICTIONARY_FLAG_SHORT = "-D";
+static std::string DICTIONARY_FLAG_LONG  = "--dictionary";
+static std::string CODEC_FLAG_SHORT = "-C";
+static std::string CODEC_FLAG_LONG  = "--codec";
+static std::string LEVEL_FLAG_SHORT = "-l";
+static std::string LEVEL_FLAG_LONG  = "--level";
+static std::string BATCH_FLAG_SHORT = "-B";
+static std::string BATCH_FLAG_LONG  = "--batch";
+static std::string FILES_FROM_FLAG_SHORT = "-F";
+static std::string FILES_FROM_FLAG_LONG  = "--files-from";
+static std::string STATS_FORMAT_TEXT = "text";
+static std::string STATS_FORMAT_JSON = "json";
+static std::string CODEC_HUFFMAN  = "huffman";
+static std::string CODEC_ADAPTIVE = "adaptive";
+static std::string CODEC_CONTEXT  = "context";
+static std::string CODEC_LZ77     = "lz77";
 static std::string ENCODED_FILE_EXTENSION = "het";
 
 static std::string BAD_CMD_FORMAT = "Bad command line format.";
 
+// The file name standing for the standard input or output:
+static std::string STANDARD_STREAM_NAME = "-";
+
+// The bytes read from a pipe at a time:
+static const size_t PIPE_CHUNK_SIZE = 1 << 16;
+
+// The most files of several blocks a batch codes at the same time. Each one
+// keeps twice as many blocks in flight as there are threads:
+static const size_t MAX_CONCURRENT_LARGE_FILES = 4;
+
+// The settings given by the command line options:
+struct coding_options {
+    size_t number_of_threads = 1;
+    size_t number_of_streams = 1;
+    size_t max_code_length   = code_table::MAX_CODE_WORD_LENGTH;
+    
+    // Empty, "text" or "json":
+    std::string stats_format;
+    
+    // Whether the coded data goes to the standard output:
+    bool to_standard_output = false;
+    
+    // The part of the text to decode, if not all of it:
+    bool has_range        = false;
+    uint64_t range_offset = 0;
+    uint64_t range_length = 0;
+    
+    // The shared code table given by the dictionary option, or null:
+    std::shared_ptr<const huffman_dictionary> dictionary;
+    
+    // The entropy coder of the blocks:
+    block_compressor::codec codec = block_compressor::codec::HUFFMAN;
+    
+    // The effort level of the LZ77 match finder:
+    size_t lz77_level = lz77_matcher::DEFAULT_LEVEL;
+};
+
 void test_append_bit();
 void test_bit_string();
 void test_all();
@@ -57,9 +154,41 @@ void exec(int argc, const char *argv[]);
 void print_help_message(std::string& image_name);
 void print_version();
 std::string get_base_name(const char *arg1);
+bool extract_option(std::vector<const char*>& args,
+                    const std::string& short_flag,
+                    const std::string& long_flag,
+                    std::string& value);
+bool extract_flag(std::vector<const char*>& args,
+                  const std::string& short_flag,
+                  const std::string& long_flag);
+size_t parse_count(const std::string& value, const std::string& what);
+void parse_range(const std::string& value, coding_options& options);
+void print_statistics(pipeline_statistics& statistics,
+                      const coding_options& options);
+bool decode_mapped(const std::string& source_file,
+                   const std::string& target_file,
+                   const coding_options& options);
+void decode_stream(std::istream& in,
+                   std::ostream& out,
+                   const coding_options& options);
+std::vector<int8_t> decode_legacy(std::vector<int8_t>& encoded_data);
+void decode_range(const std::string& source_file,
+                  std::ostream& out,
+                  const coding_options& options);
+void set_binary_mode();
+void do_train(const std::string& dictionary_file,
+              const std::vector<const char*>& sample_files,
+              const coding_options& options);
+size_t do_batch(bool encode,
+                const std::vector<std::string>& files,
+                const coding_options& options);
+std::vector<std::string> read_file_list(const std::string& list_file);
+std::shared_ptr<const huffman_dictionary> load_dictionary(
+                                        const std::string& dictionary_file);
 
 void file_write(std::string& file_name, std::vector<int8_t>& data);
 std::vector<int8_t> file_read(std::string& file_name);
+bool is_block_stream(std::string& file_name);
 
 int main(int argc, const char * argv[])
 {
@@ -71,352 +200,1973 @@ int main(int argc, const char * argv[])
 void file_write(std::string& file_name, std::vector<int8_t>& data)
 {
     std::ofstream file(file_name, std::ios::out | std::ofstream::binary);
-    std::size_t size = data.size();
-    char* byte_data = new char[size];
-    std::copy(data.begin(), data.end(), byte_data);
-    file.write(byte_data, size);
+    file.write((const char*) data.data(), data.size());
     file.close();
 }
 
 std::vector<int8_t> file_read(std::string& file_name)
+{
+    mapped_input_file mapped_file(file_name);
+    
+    if (mapped_file.is_mapped())
+    {
+        return std::vector<int8_t>(mapped_file.data(),
+                                   mapped_file.data() + mapped_file.size());
+    }
+    
+    std::ifstream file(file_name, std::ios::in | std::ifstream::binary);
+    return std::vector<int8_t>(std::istreambuf_iterator<char>(file),
+                               std::istreambuf_iterator<char>());
+}
+
+bool is_block_stream(std::string& file_name)
 {
     std::ifstream file(file_name, std::ios::in | std::ifstream::binary);
-    std::vector<int8_t> ret;
-    std::filebuf* pbuf = file.rdbuf();
-    std::size_t size = pbuf->pubseekoff(0, file.end, file.in);
+    int8_t magic[sizeof(block_format::MAGIC)];
+    file.read((char*) magic, sizeof(magic));
+    
+    return (size_t) file.gcount() == sizeof(magic)
+        && std::equal(magic, magic + sizeof(magic), block_format::MAGIC);
+}
+
+// Decodes the block stream through memory mappings of both files. Returns
+// false if either file cannot be mapped or the stream has no block index:
+bool decode_mapped(const std::string& source_file,
+                   const std::string& target_file,
+                   const coding_options& options)
+{
+    mapped_input_file in(source_file);
+    block_decompressor decompressor;
+    block_index index;
+    decompressor.set_dictionary(options.dictionary.get());
+    
+    if (!in.is_mapped() ||
+        !decompressor.read_block_index(in.data(), in.size(), index))
+    {
+        return false;
+    }
     
-    pbuf->pubseekpos(0, file.in);
-    char* buffer = new char[size];
-    pbuf->sgetn(buffer, size);
+    mapped_output_file out(target_file, index.get_decompressed_size());
     
-    for (std::size_t i = 0; i != size; ++i)
+    if (!out.is_mapped())
     {
-        ret.push_back((int8_t) buffer[i]);
+        return false;
     }
     
-    delete[] buffer;
-    file.close();
-    return std::move(ret);
+    pipeline_statistics statistics;
+    
+    if (!options.stats_format.empty())
+    {
+        decompressor.set_statistics(&statistics);
+    }
+    
+    try
+    {
+        if (options.number_of_threads == 1)
+        {
+            decompressor.decompress(in.data(), in.size(), index, out.data());
+        }
+        else
+        {
+            thread_pool pool(options.number_of_threads);
+            decompressor.decompress(in.data(),
+                                    in.size(),
+                                    index,
+                                    out.data(),
+                                    pool);
+        }
+    }
+    catch (...)
+    {
+        // Leave no partly decoded file behind:
+        out.discard();
+        throw;
+    }
+    
+    print_statistics(statistics, options);
+    return true;
 }
 
-void do_decode(int argc, const char * argv[])
+// Decodes the stream of unknown length coming from 'in' chunk by chunk, so
+// that the memory held does not grow with the stream. A stream of the older
+// formats is read whole:
+void decode_stream(std::istream& in,
+                   std::ostream& out,
+                   const coding_options& options)
 {
-    if (argc != 4)
+    std::vector<int8_t> chunk(PIPE_CHUNK_SIZE);
+    std::vector<int8_t> text(PIPE_CHUNK_SIZE);
+    in.read((char*) chunk.data(), sizeof(block_format::MAGIC));
+    size_t length = (size_t) in.gcount();
+    
+    if (length != sizeof(block_format::MAGIC) ||
+        !std::equal(block_format::MAGIC,
+                    block_format::MAGIC + sizeof(block_format::MAGIC),
+                    chunk.begin()))
     {
-        throw std::runtime_error{BAD_CMD_FORMAT};
+        std::vector<int8_t> encoded_data(chunk.begin(),
+                                         chunk.begin() + length);
+        encoded_data.insert(encoded_data.end(),
+                            std::istreambuf_iterator<char>(in),
+                            std::istreambuf_iterator<char>());
+        text = decode_legacy(encoded_data);
+        out.write((const char*) text.data(), text.size());
+        return;
     }
     
-    std::string flag = argv[1];
+    streaming_decompressor decompressor;
+    pipeline_statistics statistics;
+    decompressor.set_dictionary(options.dictionary.get());
     
-    if (flag != DECODE_FLAG_SHORT and flag != DECODE_FLAG_LONG)
+    if (!options.stats_format.empty())
     {
-        throw std::runtime_error{BAD_CMD_FORMAT};
+        decompressor.set_statistics(&statistics);
     }
     
-    std::string source_file = argv[2];
-    std::string target_file = argv[3];
+    while (length != 0)
+    {
+        decompressor.push(chunk.data(), length);
+        
+        while (decompressor.get_available() != 0)
+        {
+            size_t text_length = decompressor.pull(text.data(), text.size());
+            out.write((const char*) text.data(), text_length);
+        }
+        
+        in.read((char*) chunk.data(), chunk.size());
+        length = (size_t) in.gcount();
+    }
+    
+    decompressor.end();
+    
+    if (!out)
+    {
+        throw std::runtime_error{"Could not write the decompressed stream."};
+    }
     
-    std::vector<int8_t> encoded_data = file_read(source_file);
+    print_statistics(statistics, options);
+}
+
+// Decodes the whole stream of the version 1 or 2 format:
+std::vector<int8_t> decode_legacy(std::vector<int8_t>& encoded_data)
+{
     huffman_deserializer deserializer;
     huffman_deserializer::result decode_result =
         deserializer.deserialize(encoded_data);
     
-    huffman_tree decoder_tree(decode_result.count_map);
     huffman_decoder decoder;
-    std::vector<int8_t> text = decoder.decode(decoder_tree,
-                                              decode_result.encoded_text);
-    file_write(target_file, text);
+    return decoder.decode(decode_result.build_decode_table(),
+                          decode_result.encoded_text);
 }
 
-void do_encode(int argc, const char * argv[])
+// Decodes only the blocks of the block stream in 'source_file' covering the
+// range of the options:
+void decode_range(const std::string& source_file,
+                  std::ostream& out,
+                  const coding_options& options)
 {
-    if (argc != 3)
+    std::ifstream in(source_file, std::ios::in | std::ifstream::binary);
+    
+    if (!in)
     {
-        throw std::runtime_error{BAD_CMD_FORMAT};
+        throw std::runtime_error{"Could not open the file " + source_file};
     }
     
-    std::string flag = argv[1];
+    block_decompressor decompressor;
+    pipeline_statistics statistics;
+    decompressor.set_dictionary(options.dictionary.get());
     
-    if (flag != ENCODE_FLAG_SHORT and flag != ENCODE_FLAG_LONG)
+    if (!options.stats_format.empty())
     {
-        throw std::runtime_error{BAD_CMD_FORMAT};
+        decompressor.set_statistics(&statistics);
     }
     
-    std::string source_file = argv[2];
-    std::vector<int8_t> text = file_read(source_file);
-    std::map<int8_t, uint32_t> count_map = compute_byte_counts(text);
-    
-    huffman_tree tree(count_map);
-    std::map<int8_t, bit_string> encoder_map = tree.infer_encoder_map();
-    
-    huffman_encoder encoder;
-    bit_string encoded_text = encoder.encode(encoder_map, text);
-    
-    huffman_serializer serializer;
-    std::vector<int8_t> encoded_data = serializer.serialize(count_map,
-                                                            encoded_text);
-    std::string out_file_name = source_file;
-    out_file_name += ".";
-    out_file_name += ENCODED_FILE_EXTENSION;
-    
-    file_write(out_file_name, encoded_data);
+    decompressor.decompress_range(in,
+                                  out,
+                                  options.range_offset,
+                                  options.range_length);
+    print_statistics(statistics, options);
 }
 
-void exec(int argc, const char *argv[])
+void do_decode(int argc, const char * argv[], const coding_options& options)
 {
-    std::set<std::string> command_line_argument_set;
-    std::for_each(argv + 1,
-                  argv + argc,
-                  [&command_line_argument_set](const char *s) {
-                      command_line_argument_set.insert(std::string{s});});
-    
-    std::string image_name = get_base_name(argv[0]);
-    auto args_end = command_line_argument_set.end();
+    // The target is implied by the standard output flag:
+    int max_argc = options.to_standard_output ? 3 : 4;
+    int min_argc = options.to_standard_output ? 2 : 4;
     
-    if (command_line_argument_set.find(HELP_FLAG_SHORT) != args_end ||
-        command_line_argument_set.find(HELP_FLAG_LONG)  != args_end)
+    if (argc < min_argc || argc > max_argc)
     {
-        print_help_message(image_name);
-        exit(0);
+        throw std::runtime_error{BAD_CMD_FORMAT};
     }
     
-    if (command_line_argument_set.find(VERSION_FLAG_SHORT) != args_end ||
-        command_line_argument_set.find(VERSION_FLAG_LONG)  != args_end)
+    std::string flag = argv[1];
+    
+    if (flag != DECODE_FLAG_SHORT and flag != DECODE_FLAG_LONG)
     {
-        print_version();
-        exit(0);
+        throw std::runtime_error{BAD_CMD_FORMAT};
     }
     
-    if (command_line_argument_set.find(DECODE_FLAG_SHORT) != args_end &&
-        command_line_argument_set.find(DECODE_FLAG_LONG)  != args_end)
+    std::string source_file = argc > 2 ? argv[2] : STANDARD_STREAM_NAME;
+    std::string target_file = argc > 3 ? argv[3] : STANDARD_STREAM_NAME;
+    bool from_standard_input = source_file == STANDARD_STREAM_NAME;
+    bool to_standard_output = target_file == STANDARD_STREAM_NAME;
+    
+    if (options.has_range &&
+        (from_standard_input || !is_block_stream(source_file)))
     {
-        print_help_message(image_name);
-        exit(1);
+        throw std::runtime_error{"A range can only be decoded from a block "
+                                 "stream file."};
     }
     
-    if (command_line_argument_set.find(ENCODE_FLAG_SHORT) != args_end &&
-        command_line_argument_set.find(ENCODE_FLAG_LONG)  != args_end)
+    if (!options.has_range &&
+        !from_standard_input &&
+        !to_standard_output &&
+        is_block_stream(source_file) &&
+        decode_mapped(source_file, target_file, options))
     {
-        print_help_message(image_name);
-        exit(0);
+        return;
     }
     
-    bool decode = false;
-    bool encode = false;
+    std::ifstream file_in;
+    std::ofstream file_out;
     
-    if (command_line_argument_set.find(DECODE_FLAG_SHORT) != args_end ||
-        command_line_argument_set.find(DECODE_FLAG_LONG)  != args_end)
+    if (!from_standard_input)
     {
-        decode = true;
+        file_in.open(source_file, std::ios::in | std::ifstream::binary);
     }
     
-    if (command_line_argument_set.find(ENCODE_FLAG_SHORT) != args_end ||
-        command_line_argument_set.find(ENCODE_FLAG_LONG)  != args_end)
+    if (!to_standard_output)
     {
-        encode = true;
+        file_out.open(target_file, std::ios::out | std::ofstream::binary);
     }
     
-    if ((!decode and !encode) or (decode and encode))
+    std::istream& in = from_standard_input ? std::cin : file_in;
+    std::ostream& out = to_standard_output ? std::cout : file_out;
+    
+    if (options.has_range)
     {
-        print_help_message(image_name);
-        exit(0);
+        decode_range(source_file, out, options);
     }
-    
-    if (decode)
+    else if (from_standard_input)
+    {
+        decode_stream(in, out, options);
+    }
+    else if (is_block_stream(source_file))
     {
-        do_decode(argc, argv);
+        block_decompressor decompressor;
+        pipeline_statistics statistics;
+        decompressor.set_dictionary(options.dictionary.get());
+        
+        if (!options.stats_format.empty())
+        {
+            decompressor.set_statistics(&statistics);
+        }
+        
+        if (options.number_of_threads == 1)
+        {
+            decompressor.decompress(in, out);
+        }
+        else
+        {
+            thread_pool pool(options.number_of_threads);
+            decompressor.decompress(in, out, pool);
+        }
+        
+        print_statistics(statistics, options);
     }
     else
     {
-        do_encode(argc, argv);
+        std::vector<int8_t> encoded_data = file_read(source_file);
+        std::vector<int8_t> text = decode_legacy(encoded_data);
+        out.write((const char*) text.data(), text.size());
     }
+    
+    out.flush();
 }
 
-std::string get_base_name(const char *cmd_line)
+// Builds the dictionary of the character counts of all the sample files and
+// saves it in 'dictionary_file':
+void do_train(const std::string& dictionary_file,
+              const std::vector<const char*>& sample_files,
+              const coding_options& options)
 {
-    std::string tmp = cmd_line;
- 
-    if (tmp.empty())
+    if (sample_files.empty())
     {
-        throw std::runtime_error{"Empty base name string."};
+        throw std::runtime_error{BAD_CMD_FORMAT};
     }
     
-    char file_separator;
-    
-#ifdef _WIN32
-    file_separator = '\\';
-#else
-    file_separator = '/';
-#endif
-    
-    int index = (int) tmp.length() - 1;
+    histogram counts;
+    uint64_t number_of_bytes = 0;
+    std::vector<int8_t> chunk(PIPE_CHUNK_SIZE);
     
-    for (; index >= 0; --index)
+    for (const char* sample_file : sample_files)
     {
-        if (tmp[index] == file_separator)
+        std::ifstream in(sample_file, std::ios::in | std::ifstream::binary);
+        
+        if (!in)
         {
-            std::string ret;
-            
-            while (++index < tmp.length())
-            {
-                ret += tmp[index];
-            }
-            
-            return ret;
+            throw std::runtime_error{std::string{"Could not open the file "}
+                                     + sample_file};
+        }
+        
+        while (in)
+        {
+            in.read((char*) chunk.data(), chunk.size());
+            size_t length = (size_t) in.gcount();
+            counts.add(compute_byte_histogram(chunk.data(), length));
+            number_of_bytes += length;
         }
     }
     
-    return tmp;
+    huffman_dictionary dictionary(counts, options.max_code_length);
+    std::ofstream out(dictionary_file, std::ios::out | std::ofstream::binary);
+    dictionary.save(out);
+    
+    cout << "Trained the dictionary "
+         << std::hex
+         << dictionary.get_id()
+         << std::dec
+         << " on "
+         << number_of_bytes
+         << " bytes of "
+         << sample_files.size()
+         << " files."
+         << endl;
 }
 
-std::string get_indent(size_t len)
+std::shared_ptr<const huffman_dictionary> load_dictionary(
+                                        const std::string& dictionary_file)
 {
-    std::string ret;
+    std::ifstream in(dictionary_file, std::ios::in | std::ifstream::binary);
     
-    for (size_t i = 0; i != len; ++i)
+    if (!in)
     {
-        ret += ' ';
+        throw std::runtime_error{"Could not open the file " + dictionary_file};
     }
     
-    return ret;
+    return std::make_shared<const huffman_dictionary>(
+                                            huffman_dictionary::load(in));
 }
 
-void print_help_message(std::string& process_image_name)
+// Reads the file names listed one per line in 'list_file', skipping the empty
+// lines:
+std::vector<std::string> read_file_list(const std::string& list_file)
 {
-    std::string preamble = "usage: " + process_image_name + " ";
-    size_t preamble_length = preamble.length();
-    std::string indent = get_indent(preamble_length);
-    cout << preamble;
+    std::ifstream file_in;
     
-    cout << "[" << HELP_FLAG_SHORT << " | " << HELP_FLAG_LONG << "]\n";
-    cout << indent
-         << "[" << VERSION_FLAG_SHORT << " | " << VERSION_FLAG_LONG << "]\n";
-    cout << indent
-         << "[" << ENCODE_FLAG_SHORT << " | " << ENCODE_FLAG_LONG
-         << "] FILE\n";
-    cout << indent
-         << "[" << DECODE_FLAG_SHORT << " | " << DECODE_FLAG_LONG
-         << "] FILE_FROM FILE_TO\n";
+    if (list_file != STANDARD_STREAM_NAME)
+    {
+        file_in.open(list_file);
+        
+        if (!file_in)
+        {
+            throw std::runtime_error{"Could not open the file " + list_file};
+        }
+    }
     
-    cout << "Where:" << endl;
+    std::istream& in = list_file == STANDARD_STREAM_NAME ? std::cin : file_in;
+    std::vector<std::string> files;
+    std::string line;
     
-    cout << HELP_FLAG_SHORT << ", " << HELP_FLAG_LONG
-         << "    Print this message and exit.\n";
-    cout << VERSION_FLAG_SHORT << ", " << VERSION_FLAG_LONG
-         << " Print the version info and exit.\n";
-    cout << ENCODE_FLAG_SHORT << ", " << ENCODE_FLAG_LONG
-         << "  Encode the text from file.\n";
-    cout << DECODE_FLAG_SHORT << ", " << DECODE_FLAG_LONG
-         << "  Decode the text from file.\n";
-}
-
-void print_version()
-{
-    cout << "Huffman compressor C++ tool, version 1.6 (Nov 29, 2016)" << endl;
-    cout << "By Rodion \"rodde\" Efremov" << endl;
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        
+        if (!line.empty())
+        {
+            files.push_back(line);
+        }
+    }
+    
+    return files;
 }
 
-void test_append_bit()
+// Encodes the file 'source_file' into 'target_file', coding the blocks on
+// 'pool' unless it is null. Returns the length of the encoded file:
+uint64_t batch_encode_file(const std::string& source_file,
+                           const std::string& target_file,
+                           const coding_options& options,
+                           thread_pool* pool)
 {
-    bit_string b;
-    
-    ASSERT(b.length() == 0);
+    mapped_input_file in(source_file);
     
-    for (int i = 0; i < 100; ++i)
+    if (!in.is_mapped())
     {
-        ASSERT(b.length() == i);
-        b.append_bit(false);
+        throw std::runtime_error{"Not a regular file: " + source_file};
     }
     
-    for (int i = 0; i < 30; ++i)
+    std::ofstream out(target_file, std::ios::out | std::ofstream::binary);
+    
+    if (!out)
     {
-        ASSERT(b.length() == 100 + i);
-        b.append_bit(true);
+        throw std::runtime_error{"Could not create the file " + target_file};
     }
     
-    ASSERT(b.length() == 130);
+    block_compressor compressor(block_format::DEFAULT_BLOCK_SIZE_LOG2,
+                                options.number_of_streams,
+                                options.max_code_length);
+    compressor.set_dictionary(options.dictionary.get());
+    compressor.set_codec(options.codec);
+    compressor.set_lz77_level(options.lz77_level);
     
-    for (int i = 0; i < 100; ++i)
+    if (pool == nullptr)
     {
-        ASSERT(b.read_bit(i) == false);
+        compressor.compress(in.data(), in.size(), out);
+    }
+    else
+    {
+        compressor.compress(in.data(), in.size(), out, *pool);
     }
     
-    for (int i = 100; i < 130; ++i)
+    out.flush();
+    
+    if (!out)
     {
-        ASSERT(b.read_bit(i) == true);
+        throw std::runtime_error{"Could not write the file " + target_file};
     }
+    
+    return (uint64_t) out.tellp();
 }
 
-void test_append_bits_from()
+// Decodes the file 'source_file' into 'target_file', decoding the blocks on
+// 'pool' unless it is null. Returns the length of the text:
+uint64_t batch_decode_file(const std::string& source_file,
+                           const std::string& target_file,
+                           const coding_options& options,
+                           thread_pool* pool)
 {
-    bit_string b;
-    bit_string c;
+    std::string file_name = source_file;
     
-    for (int i = 0; i < 200; ++i)
+    if (!is_block_stream(file_name))
     {
-        b.append_bit(false);
+        std::vector<int8_t> encoded_data = file_read(file_name);
+        std::vector<int8_t> text = decode_legacy(encoded_data);
+        file_name = target_file;
+        file_write(file_name, text);
+        return text.size();
     }
     
-    for (int i = 0; i < 100; ++i)
+    mapped_input_file in(source_file);
+    block_decompressor decompressor;
+    block_index index;
+    decompressor.set_dictionary(options.dictionary.get());
+    
+    if (in.is_mapped() &&
+        decompressor.read_block_index(in.data(), in.size(), index))
     {
-        c.append_bit(true);
+        mapped_output_file out(target_file, index.get_decompressed_size());
+        
+        if (out.is_mapped())
+        {
+            try
+            {
+                if (pool == nullptr)
+                {
+                    decompressor.decompress(in.data(),
+                                            in.size(),
+                                            index,
+                                            out.data());
+                }
+                else
+                {
+                    decompressor.decompress(in.data(),
+                                            in.size(),
+                                            index,
+                                            out.data(),
+                                            *pool);
+                }
+            }
+            catch (...)
+            {
+                // Leave no partly decoded file behind:
+                out.discard();
+                throw;
+            }
+            
+            return out.size();
+        }
     }
     
-    ASSERT(b.length() == 200);
-    ASSERT(c.length() == 100);
-    
-    b.append_bits_from(c);
+    std::ifstream file_in(source_file, std::ios::in | std::ifstream::binary);
+    std::ofstream file_out(target_file, std::ios::out | std::ofstream::binary);
     
-    ASSERT(b.length() == 300);
-    ASSERT(c.length() == 100);
-    
-    for (int i = 0; i < 200; ++i)
+    if (pool == nullptr)
+    {
+        decompressor.decompress(file_in, file_out);
+    }
+    else
+    {
+        decompressor.decompress(file_in, file_out, *pool);
+    }
+    
+    file_out.flush();
+    return (uint64_t) file_out.tellp();
+}
+
+// Returns the name of the file the encoded file 'source_file' decodes into:
+std::string get_decoded_file_name(const std::string& source_file)
+{
+    std::string extension = "." + ENCODED_FILE_EXTENSION;
+    
+    if (source_file.size() <= extension.size() ||
+        source_file.compare(source_file.size() - extension.size(),
+                            extension.size(),
+                            extension) != 0)
+    {
+        throw std::runtime_error{"The file name lacks the extension "
+                                 + extension};
+    }
+    
+    return source_file.substr(0, source_file.size() - extension.size());
+}
+
+// Codes each of the 'files' into a file of its own on a single thread pool.
+// A file of at most one block makes a single task. The larger files are fed
+// to the pool block by block, a few files at a time, so that none of them
+// keeps one worker busy long after the rest are done. A file that fails is
+// reported and skipped. Prints the total sizes and the throughput at the end
+// and returns the number of the files that failed:
+size_t do_batch(bool encode,
+                const std::vector<std::string>& files,
+                const coding_options& options)
+{
+    if (files.empty() || options.to_standard_output || options.has_range)
+    {
+        throw std::runtime_error{BAD_CMD_FORMAT};
+    }
+    
+    uint64_t block_size = 1ULL << block_format::DEFAULT_BLOCK_SIZE_LOG2;
+    std::vector<uint64_t> input_sizes(files.size());
+    std::vector<uint64_t> output_sizes(files.size());
+    std::vector<std::string> errors(files.size());
+    std::vector<std::future<void>> tasks;
+    std::vector<size_t> large_files;
+    auto start_time = std::chrono::steady_clock::now();
+    thread_pool pool(options.number_of_threads);
+    
+    // Each file is touched by a single task, so the results need no locks:
+    auto code_file = [&](size_t i, thread_pool* block_pool) {
+        std::string target_file;
+        
+        try
+        {
+            if (encode)
+            {
+                target_file = files[i] + "." + ENCODED_FILE_EXTENSION;
+                output_sizes[i] = batch_encode_file(files[i],
+                                                    target_file,
+                                                    options,
+                                                    block_pool);
+            }
+            else
+            {
+                target_file = get_decoded_file_name(files[i]);
+                output_sizes[i] = batch_decode_file(files[i],
+                                                    target_file,
+                                                    options,
+                                                    block_pool);
+            }
+        }
+        catch (std::exception& err)
+        {
+            errors[i] = err.what();
+            
+            // Leave no partly coded file behind:
+            if (!target_file.empty())
+            {
+                std::remove(target_file.c_str());
+            }
+        }
+    };
+    
+    for (size_t i = 0; i != files.size(); ++i)
+    {
+        std::ifstream in(files[i],
+                         std::ios::in | std::ifstream::binary | std::ios::ate);
+        
+        if (!in)
+        {
+            errors[i] = "Could not open the file " + files[i];
+            continue;
+        }
+        
+        input_sizes[i] = (uint64_t) in.tellg();
+        
+        if (input_sizes[i] > block_size)
+        {
+            large_files.push_back(i);
+        }
+        else
+        {
+            tasks.push_back(pool.submit([&code_file, i]() {
+                code_file(i, nullptr);
+            }));
+        }
+    }
+    
+    // The blocks of the large files queue up behind the small files, and the
+    // idle workers steal them. Each large file is fed by a thread of its own
+    // that mostly waits for its blocks, so that the files overlap:
+    std::atomic<size_t> next_large_file{0};
+    std::vector<std::thread> feeders;
+    size_t number_of_feeders = std::min(large_files.size(),
+                                        MAX_CONCURRENT_LARGE_FILES);
+    
+    for (size_t feeder = 0; feeder != number_of_feeders; ++feeder)
+    {
+        feeders.emplace_back([&]() {
+            for (size_t next = next_large_file++;
+                 next < large_files.size();
+                 next = next_large_file++)
+            {
+                code_file(large_files[next], &pool);
+            }
+        });
+    }
+    
+    for (std::thread& feeder : feeders)
+    {
+        feeder.join();
+    }
+    
+    for (std::future<void>& task : tasks)
+    {
+        task.get();
+    }
+    
+    std::chrono::duration<double> duration =
+        std::chrono::steady_clock::now() - start_time;
+    
+    size_t number_of_failures = 0;
+    uint64_t input_bytes = 0;
+    uint64_t output_bytes = 0;
+    
+    for (size_t i = 0; i != files.size(); ++i)
+    {
+        if (errors[i].empty())
+        {
+            input_bytes += input_sizes[i];
+            output_bytes += output_sizes[i];
+        }
+        else
+        {
+            ++number_of_failures;
+        }
+    }
+    
+    uint64_t text_bytes = encode ? input_bytes : output_bytes;
+    double seconds = duration.count();
+    double megabytes_per_second = seconds > 0.0 ?
+                                  text_bytes / seconds / 1e6 :
+                                  0.0;
+    
+    cout << (encode ? "Encoded " : "Decoded ")
+         << files.size() - number_of_failures
+         << " files of "
+         << input_bytes
+         << " bytes into "
+         << output_bytes
+         << " bytes in "
+         << seconds
+         << " s ("
+         << megabytes_per_second
+         << " MB/s of text on "
+         << pool.size()
+         << " threads)."
+         << endl;
+    
+    if (number_of_failures != 0)
+    {
+        cerr << "Could not code "
+             << number_of_failures
+             << " of the "
+             << files.size()
+             << " files:"
+             << endl;
+        
+        for (size_t i = 0; i != files.size(); ++i)
+        {
+            if (!errors[i].empty())
+            {
+                cerr << "    " << files[i] << ": " << errors[i] << endl;
+            }
+        }
+    }
+    
+    return number_of_failures;
+}
+
+// Reports how much the code word length limit enlarged the encoded text:
+void print_length_limit_cost(const block_compressor& compressor,
+                             size_t max_code_length,
+                             std::ostream& report)
+{
+    uint64_t encoded_bits = compressor.get_number_of_encoded_bits();
+    uint64_t unlimited_bits = compressor.get_number_of_unlimited_bits();
+    uint64_t extra_bits = encoded_bits - unlimited_bits;
+    double percentage = unlimited_bits == 0 ?
+                        0.0 :
+                        100.0 * extra_bits / unlimited_bits;
+    
+    report << "Limiting the code words to "
+         << max_code_length
+         << " bits costs "
+         << (extra_bits + CHAR_BIT - 1) / CHAR_BIT
+         << " bytes ("
+         << percentage
+         << "% of the encoded text)."
+         << endl;
+}
+
+void do_encode(int argc, const char * argv[], const coding_options& options)
+{
+    if (argc != 2 && argc != 3)
+    {
+        throw std::runtime_error{BAD_CMD_FORMAT};
+    }
+    
+    std::string flag = argv[1];
+    
+    if (flag != ENCODE_FLAG_SHORT and flag != ENCODE_FLAG_LONG)
+    {
+        throw std::runtime_error{BAD_CMD_FORMAT};
+    }
+    
+    std::string source_file = argc == 3 ? argv[2] : STANDARD_STREAM_NAME;
+    bool from_standard_input = source_file == STANDARD_STREAM_NAME;
+    
+    // There is no file name to derive the output name from a pipe:
+    bool to_standard_output = options.to_standard_output
+                           || from_standard_input;
+    std::string out_file_name = source_file;
+    out_file_name += ".";
+    out_file_name += ENCODED_FILE_EXTENSION;
+    
+    std::unique_ptr<mapped_input_file> mapped_file;
+    std::ifstream file_in;
+    
+    if (!from_standard_input)
+    {
+        mapped_file.reset(new mapped_input_file(source_file));
+        
+        if (!mapped_file->is_mapped())
+        {
+            file_in.open(source_file, std::ios::in | std::ifstream::binary);
+        }
+    }
+    
+    std::ofstream file_out;
+    
+    if (!to_standard_output)
+    {
+        file_out.open(out_file_name, std::ios::out | std::ofstream::binary);
+    }
+    
+    std::istream& in = from_standard_input ? std::cin : file_in;
+    std::ostream& out = to_standard_output ? std::cout : file_out;
+    bool mapped = mapped_file && mapped_file->is_mapped();
+    block_compressor compressor(block_format::DEFAULT_BLOCK_SIZE_LOG2,
+                                options.number_of_streams,
+                                options.max_code_length);
+    pipeline_statistics statistics;
+    compressor.set_dictionary(options.dictionary.get());
+    compressor.set_codec(options.codec);
+    compressor.set_lz77_level(options.lz77_level);
+    
+    if (!options.stats_format.empty())
+    {
+        compressor.set_statistics(&statistics);
+    }
+    
+    if (mapped && options.number_of_threads == 1)
+    {
+        compressor.compress(mapped_file->data(), mapped_file->size(), out);
+    }
+    else if (mapped)
+    {
+        thread_pool pool(options.number_of_threads);
+        compressor.compress(mapped_file->data(),
+                            mapped_file->size(),
+                            out,
+                            pool);
+    }
+    else if (options.number_of_threads == 1)
+    {
+        compressor.compress(in, out);
+    }
+    else
+    {
+        thread_pool pool(options.number_of_threads);
+        compressor.compress(in, out, pool);
+    }
+    
+    out.flush();
+    print_statistics(statistics, options);
+    
+    if (options.max_code_length < code_table::MAX_CODE_WORD_LENGTH)
+    {
+        // Keep the report out of the compressed data:
+        print_length_limit_cost(compressor,
+                                options.max_code_length,
+                                to_standard_output ? cerr : cout);
+    }
+}
+
+// Prints the statistics of the job to the standard error so that they never
+// mix with the coded data:
+void print_statistics(pipeline_statistics& statistics,
+                      const coding_options& options)
+{
+    if (options.stats_format.empty())
+    {
+        return;
+    }
+    
+    statistics.finish();
+    
+    if (options.stats_format == STATS_FORMAT_JSON)
+    {
+        statistics.print_json(cerr);
+    }
+    else
+    {
+        statistics.print_text(cerr);
+    }
+}
+
+// Removes the flag and its value from 'args'. Returns false if the flag is
+// absent:
+bool extract_option(std::vector<const char*>& args,
+                    const std::string& short_flag,
+                    const std::string& long_flag,
+                    std::string& value)
+{
+    for (size_t i = 1; i < args.size(); ++i)
+    {
+        if (args[i] != short_flag && args[i] != long_flag)
+        {
+            continue;
+        }
+        
+        if (i + 1 == args.size())
+        {
+            throw std::runtime_error{BAD_CMD_FORMAT};
+        }
+        
+        value = args[i + 1];
+        args.erase(args.begin() + i, args.begin() + i + 2);
+        return true;
+    }
+    
+    return false;
+}
+
+// Parses the range value of the form OFFSET:LENGTH:
+void parse_range(const std::string& value, coding_options& options)
+{
+    size_t separator = value.find(':');
+    
+    if (separator == std::string::npos)
+    {
+        throw std::runtime_error{"Bad range: " + value};
+    }
+    
+    options.has_range    = true;
+    options.range_offset = parse_count(value.substr(0, separator), "offset");
+    options.range_length = parse_count(value.substr(separator + 1),
+                                       "characters");
+}
+
+// Removes the flag taking no value from 'args'. Returns false if the flag is
+// absent:
+bool extract_flag(std::vector<const char*>& args,
+                  const std::string& short_flag,
+                  const std::string& long_flag)
+{
+    for (size_t i = 1; i < args.size(); ++i)
+    {
+        if (args[i] == short_flag || args[i] == long_flag)
+        {
+            args.erase(args.begin() + i);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+// Switches the standard streams to binary mode so that no byte of the coded
+// data gets translated:
+void set_binary_mode()
+{
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+}
+
+// Parses the non-negative option value counting 'what':
+size_t parse_count(const std::string& value, const std::string& what)
+{
+    std::stringstream ss(value);
+    size_t count;
+    
+    if (value.empty() || value[0] == '-' || !(ss >> count) || !ss.eof())
+    {
+        throw std::runtime_error{"Bad number of " + what + ": " + value};
+    }
+    
+    return count;
+}
+
+void exec(int argc, const char *argv[])
+{
+    std::vector<const char*> args(argv, argv + argc);
+    std::string option_value;
+    coding_options options;
+    
+    if (extract_option(args,
+                       THREADS_FLAG_SHORT,
+                       THREADS_FLAG_LONG,
+                       option_value))
+    {
+        options.number_of_threads = parse_count(option_value, "threads");
+        
+        // Zero stands for the number of hardware threads:
+        if (options.number_of_threads == 0)
+        {
+            options.number_of_threads =
+                std::max(1u, std::thread::hardware_concurrency());
+        }
+    }
+    
+    if (extract_option(args,
+                       STREAMS_FLAG_SHORT,
+                       STREAMS_FLAG_LONG,
+                       option_value))
+    {
+        options.number_of_streams = parse_count(option_value, "streams");
+    }
+    
+    if (extract_option(args,
+                       MAX_LENGTH_FLAG_SHORT,
+                       MAX_LENGTH_FLAG_LONG,
+                       option_value))
+    {
+        options.max_code_length = parse_count(option_value, "bits");
+    }
+    
+    if (extract_option(args,
+                       STATS_FLAG_SHORT,
+                       STATS_FLAG_LONG,
+                       option_value))
+    {
+        if (option_value != STATS_FORMAT_TEXT &&
+            option_value != STATS_FORMAT_JSON)
+        {
+            throw std::runtime_error{"Bad statistics format: "
+                                     + option_value};
+        }
+        
+        options.stats_format = option_value;
+    }
+    
+    if (extract_option(args,
+                       RANGE_FLAG_SHORT,
+                       RANGE_FLAG_LONG,
+                       option_value))
+    {
+        parse_range(option_value, options);
+    }
+    
+    if (extract_option(args,
+                       DICTIONARY_FLAG_SHORT,
+                       DICTIONARY_FLAG_LONG,
+                       option_value))
+    {
+        options.dictionary = load_dictionary(option_value);
+    }
+    
+    if (extract_option(args,
+                       CODEC_FLAG_SHORT,
+                       CODEC_FLAG_LONG,
+                       option_value))
+    {
+        if (option_value == CODEC_ADAPTIVE)
+        {
+            options.codec = block_compressor::codec::ADAPTIVE_HUFFMAN;
+        }
+        else if (option_value == CODEC_CONTEXT)
+        {
+            options.codec = block_compressor::codec::CONTEXT_HUFFMAN;
+        }
+        else if (option_value == CODEC_LZ77)
+        {
+            options.codec = block_compressor::codec::LZ77_HUFFMAN;
+        }
+        else if (option_value != CODEC_HUFFMAN)
+        {
+            throw std::runtime_error{"Bad codec: " + option_value};
+        }
+    }
+    
+    if (extract_option(args,
+                       LEVEL_FLAG_SHORT,
+                       LEVEL_FLAG_LONG,
+                       option_value))
+    {
+        options.lz77_level = parse_count(option_value, "level");
+    }
+    
+    // A list of files implies the batch mode:
+    std::vector<std::string> listed_files;
+    bool batch = extract_flag(args, BATCH_FLAG_SHORT, BATCH_FLAG_LONG);
+    
+    if (extract_option(args,
+                       FILES_FROM_FLAG_SHORT,
+                       FILES_FROM_FLAG_LONG,
+                       option_value))
+    {
+        listed_files = read_file_list(option_value);
+        batch = true;
+    }
+    
+    if (extract_option(args,
+                       TRAIN_FLAG_SHORT,
+                       TRAIN_FLAG_LONG,
+                       option_value))
+    {
+        do_train(option_value,
+                 std::vector<const char*>(args.begin() + 1, args.end()),
+                 options);
+        return;
+    }
+    
+    if (extract_flag(args, STDOUT_FLAG_SHORT, STDOUT_FLAG_LONG))
+    {
+        options.to_standard_output = true;
+    }
+    
+    set_binary_mode();
+    argc = (int) args.size();
+    argv = args.data();
+    
+    std::set<std::string> command_line_argument_set;
+    std::for_each(argv + 1,
+                  argv + argc,
+                  [&command_line_argument_set](const char *s) {
+                      command_line_argument_set.insert(std::string{s});});
+    
+    std::string image_name = get_base_name(argv[0]);
+    auto args_end = command_line_argument_set.end();
+    
+    if (command_line_argument_set.find(HELP_FLAG_SHORT) != args_end ||
+        command_line_argument_set.find(HELP_FLAG_LONG)  != args_end)
+    {
+        print_help_message(image_name);
+        exit(0);
+    }
+    
+    if (command_line_argument_set.find(VERSION_FLAG_SHORT) != args_end ||
+        command_line_argument_set.find(VERSION_FLAG_LONG)  != args_end)
+    {
+        print_version();
+        exit(0);
+    }
+    
+    if (command_line_argument_set.find(DECODE_FLAG_SHORT) != args_end &&
+        command_line_argument_set.find(DECODE_FLAG_LONG)  != args_end)
+    {
+        print_help_message(image_name);
+        exit(1);
+    }
+    
+    if (command_line_argument_set.find(ENCODE_FLAG_SHORT) != args_end &&
+        command_line_argument_set.find(ENCODE_FLAG_LONG)  != args_end)
+    {
+        print_help_message(image_name);
+        exit(0);
+    }
+    
+    bool decode = false;
+    bool encode = false;
+    
+    if (command_line_argument_set.find(DECODE_FLAG_SHORT) != args_end ||
+        command_line_argument_set.find(DECODE_FLAG_LONG)  != args_end)
+    {
+        decode = true;
+    }
+    
+    if (command_line_argument_set.find(ENCODE_FLAG_SHORT) != args_end ||
+        command_line_argument_set.find(ENCODE_FLAG_LONG)  != args_end)
+    {
+        encode = true;
+    }
+    
+    if ((!decode and !encode) or (decode and encode))
+    {
+        print_help_message(image_name);
+        exit(0);
+    }
+    
+    if (batch)
+    {
+        std::string flag = argv[1];
+        
+        if (flag != (decode ? DECODE_FLAG_SHORT : ENCODE_FLAG_SHORT) &&
+            flag != (decode ? DECODE_FLAG_LONG : ENCODE_FLAG_LONG))
+        {
+            throw std::runtime_error{BAD_CMD_FORMAT};
+        }
+        
+        std::vector<std::string> files(argv + 2, argv + argc);
+        files.insert(files.end(), listed_files.begin(), listed_files.end());
+        
+        if (do_batch(encode, files, options) != 0)
+        {
+            exit(1);
+        }
+    }
+    else if (decode)
+    {
+        do_decode(argc, argv, options);
+    }
+    else
+    {
+        do_encode(argc, argv, options);
+    }
+}
+
+std::string get_base_name(const char *cmd_line)
+{
+    std::string tmp = cmd_line;
+ 
+    if (tmp.empty())
+    {
+        throw std::runtime_error{"Empty base name string."};
+    }
+    
+    char file_separator;
+    
+#ifdef _WIN32
+    file_separator = '\\';
+#else
+    file_separator = '/';
+#endif
+    
+    int index = (int) tmp.length() - 1;
+    
+    for (; index >= 0; --index)
+    {
+        if (tmp[index] == file_separator)
+        {
+            std::string ret;
+            
+            while (++index < tmp.length())
+            {
+                ret += tmp[index];
+            }
+            
+            return ret;
+        }
+    }
+    
+    return tmp;
+}
+
+std::string get_indent(size_t len)
+{
+    std::string ret;
+    
+    for (size_t i = 0; i != len; ++i)
+    {
+        ret += ' ';
+    }
+    
+    return ret;
+}
+
+void print_help_message(std::string& process_image_name)
+{
+    std::string preamble = "usage: " + process_image_name + " ";
+    size_t preamble_length = preamble.length();
+    std::string indent = get_indent(preamble_length);
+    cout << preamble;
+    
+    cout << "[" << HELP_FLAG_SHORT << " | " << HELP_FLAG_LONG << "]\n";
+    cout << indent
+         << "[" << VERSION_FLAG_SHORT << " | " << VERSION_FLAG_LONG << "]\n";
+    cout << indent
+         << "[" << ENCODE_FLAG_SHORT << " | " << ENCODE_FLAG_LONG
+         << "] [" << THREADS_FLAG_SHORT << " | " << THREADS_FLAG_LONG
+         << " N] [" << STREAMS_FLAG_SHORT << " | " << STREAMS_FLAG_LONG
+         << " N]\n"
+         << indent
+         << "    [" << MAX_LENGTH_FLAG_SHORT << " | " << MAX_LENGTH_FLAG_LONG
+         << " N] [" << STATS_FLAG_SHORT << " | " << STATS_FLAG_LONG
+         << " FORMAT]\n"
+         << indent
+         << "    [" << DICTIONARY_FLAG_SHORT << " | " << DICTIONARY_FLAG_LONG
+         << " DICT] [" << CODEC_FLAG_SHORT << " | " << CODEC_FLAG_LONG
+         << " CODEC]\n"
+         << indent
+         << "    [" << LEVEL_FLAG_SHORT << " | " << LEVEL_FLAG_LONG
+         << " N] [" << STDOUT_FLAG_SHORT << " | " << STDOUT_FLAG_LONG
+         << "] [FILE]\n";
+    cout << indent
+         << "[" << DECODE_FLAG_SHORT << " | " << DECODE_FLAG_LONG
+         << "] [" << THREADS_FLAG_SHORT << " | " << THREADS_FLAG_LONG
+         << " N] [" << STATS_FLAG_SHORT << " | " << STATS_FLAG_LONG
+         << " FORMAT]\n"
+         << indent
+         << "    [" << RANGE_FLAG_SHORT << " | " << RANGE_FLAG_LONG
+         << " OFFSET:LENGTH] [" << DICTIONARY_FLAG_SHORT << " | "
+         << DICTIONARY_FLAG_LONG << " DICT]\n"
+         << indent
+         << "    (FILE_FROM FILE_TO | " << STDOUT_FLAG_SHORT << " | "
+         << STDOUT_FLAG_LONG << " [FILE_FROM])\n";
+    cout << indent
+         << "(" << ENCODE_FLAG_SHORT << " | " << DECODE_FLAG_SHORT
+         << ") (" << BATCH_FLAG_SHORT << " | " << BATCH_FLAG_LONG
+         << ") [" << FILES_FROM_FLAG_SHORT << " | " << FILES_FROM_FLAG_LONG
+         << " LIST] [OPTIONS] [FILE...]\n";
+    cout << indent
+         << "[" << TRAIN_FLAG_SHORT << " | " << TRAIN_FLAG_LONG
+         << " DICT] [" << MAX_LENGTH_FLAG_SHORT << " | "
+         << MAX_LENGTH_FLAG_LONG << " N] FILE...\n";
+    
+    cout << "Where:" << endl;
+    
+    cout << HELP_FLAG_SHORT << ", " << HELP_FLAG_LONG
+         << "    Print this message and exit.\n";
+    cout << VERSION_FLAG_SHORT << ", " << VERSION_FLAG_LONG
+         << " Print the version info and exit.\n";
+    cout << ENCODE_FLAG_SHORT << ", " << ENCODE_FLAG_LONG
+         << "  Encode the text from file.\n";
+    cout << DECODE_FLAG_SHORT << ", " << DECODE_FLAG_LONG
+         << "  Decode the text from file.\n";
+    cout << THREADS_FLAG_SHORT << ", " << THREADS_FLAG_LONG
+         << " Run on N threads, 0 for all cores (default: 1).\n";
+    cout << STREAMS_FLAG_SHORT << ", " << STREAMS_FLAG_LONG
+         << " Split each block into N interleaved streams, 1 or 2 to 8\n"
+         << "              (default: 1).\n";
+    cout << MAX_LENGTH_FLAG_SHORT << ", " << MAX_LENGTH_FLAG_LONG
+         << " Limit the code words to N bits, 8 to 57, and report the\n"
+         << "                 cost of the limit.\n";
+    cout << STATS_FLAG_SHORT << ", " << STATS_FLAG_LONG
+         << " Print the time of each stage, the sizes, the entropy and\n"
+         << "            the average code length to the standard error as\n"
+         << "            FORMAT, text or json.\n";
+    cout << STDOUT_FLAG_SHORT << ", " << STDOUT_FLAG_LONG
+         << " Write the coded data to the standard output.\n";
+    cout << RANGE_FLAG_SHORT << ", " << RANGE_FLAG_LONG
+         << " Decode only the LENGTH characters starting at OFFSET,\n"
+         << "            reading only the blocks that hold them.\n";
+    cout << TRAIN_FLAG_SHORT << ", " << TRAIN_FLAG_LONG
+         << " Build the dictionary DICT of the character statistics of\n"
+         << "            the sample FILEs.\n";
+    cout << DICTIONARY_FLAG_SHORT << ", " << DICTIONARY_FLAG_LONG
+         << " Code the blocks with the code table of DICT instead of\n"
+         << "                 storing a table in each block.\n";
+    cout << CODEC_FLAG_SHORT << ", " << CODEC_FLAG_LONG
+         << " Code the blocks with CODEC: huffman (default); adaptive,\n"
+         << "            which codes each block in a single pass without a\n"
+         << "            code table; context, which picks one of a few\n"
+         << "            code tables by the previous character; or lz77,\n"
+         << "            which codes the repeated strings as matches.\n";
+    cout << LEVEL_FLAG_SHORT << ", " << LEVEL_FLAG_LONG
+         << " Search the lz77 matches with the effort N, 1 to 9\n"
+         << "            (default: 6).\n";
+    cout << BATCH_FLAG_SHORT << ", " << BATCH_FLAG_LONG
+         << " Encode each FILE into FILE.het, or decode each FILE.het into\n"
+         << "            FILE, sharing the threads among all the files, and\n"
+         << "            report the total throughput.\n";
+    cout << FILES_FROM_FLAG_SHORT << ", " << FILES_FROM_FLAG_LONG
+         << " Add the files listed one per line in LIST to the\n"
+         << "                 batch.\n";
+    cout << "A FILE of " << STANDARD_STREAM_NAME
+         << " stands for the standard input or output. Encoding the\n"
+         << "standard input writes to the standard output.\n";
+}
+
+void print_version()
+{
+    cout << "Huffman compressor C++ tool, version 1.6 (Nov 29, 2016)" << endl;
+    cout << "By Rodion \"rodde\" Efremov" << endl;
+}
+
+void test_append_bit()
+{
+    bit_string b;
+    
+    ASSERT(b.length() == 0);
+    
+    for (int i = 0; i < 100; ++i)
+    {
+        ASSERT(b.length() == i);
+        b.append_bit(false);
+    }
+    
+    for (int i = 0; i < 30; ++i)
+    {
+        ASSERT(b.length() == 100 + i);
+        b.append_bit(true);
+    }
+    
+    ASSERT(b.length() == 130);
+    
+    for (int i = 0; i < 100; ++i)
+    {
+        ASSERT(b.read_bit(i) == false);
+    }
+    
+    for (int i = 100; i < 130; ++i)
+    {
+        ASSERT(b.read_bit(i) == true);
+    }
+}
+
+void test_append_bits_from()
+{
+    bit_string b;
+    bit_string c;
+    
+    for (int i = 0; i < 200; ++i)
+    {
+        b.append_bit(false);
+    }
+    
+    for (int i = 0; i < 100; ++i)
+    {
+        c.append_bit(true);
+    }
+    
+    ASSERT(b.length() == 200);
+    ASSERT(c.length() == 100);
+    
+    b.append_bits_from(c);
+    
+    ASSERT(b.length() == 300);
+    ASSERT(c.length() == 100);
+    
+    for (int i = 0; i < 200; ++i)
     {
         ASSERT(b.read_bit(i) == false);
     }
     
-    for (int i = 200; i < 300; ++i)
+    for (int i = 200; i < 300; ++i)
+    {
+        ASSERT(b.read_bit(i) == true);
+    }
+}
+
+void test_read_bit()
+{
+    bit_string b;
+    b.append_bit(true);
+    b.append_bit(false);
+    b.append_bit(false);
+    b.append_bit(true);
+    b.append_bit(false);
+    
+    ASSERT(b.length() == 5);
+    
+    ASSERT(b.read_bit(0) == true);
+    ASSERT(b.read_bit(3) == true);
+    
+    ASSERT(b.read_bit(1) == false);
+    ASSERT(b.read_bit(2) == false);
+    ASSERT(b.read_bit(4) == false);
+}
+
+void test_read_bit_bad_index_throws()
+{
+    bit_string b;
+    b.append_bit(true);
+    
+    try
+    {
+        b.read_bit(1); ASSERT(false);
+    }
+    catch (std::runtime_error& err)
+    {
+        
+    }
+    
+    try
+    {
+        b.read_bit(-1); ASSERT(false);
+    }
+    catch (std::runtime_error& err)
+    {
+        
+    }
+}
+
+void test_read_bit_throws_on_empty_string()
+{
+    bit_string b;
+    
+    try
+    {
+        b.read_bit(0); ASSERT(false);
+    }
+    catch (std::runtime_error& err)
+    {
+        
+    }
+}
+
+void test_remove_last_bit()
+{
+    bit_string b;
+    
+    b.append_bit(true);
+    b.append_bit(true);
+    b.append_bit(false);
+    b.append_bit(true);
+    b.append_bit(false);
+    
+    ASSERT(b.read_bit(0) == true);
+    ASSERT(b.read_bit(1) == true);
+    ASSERT(b.read_bit(2) == false);
+    ASSERT(b.read_bit(3) == true);
+    ASSERT(b.read_bit(4) == false);
+    
+    for (int i = 5; i > 0; --i)
+    {
+        ASSERT(b.length() == i);
+        b.remove_last_bit();
+        ASSERT(b.length() == i - 1);
+    }
+}
+
+void test_remove_last_bit_throws_on_empty_string()
+{
+    bit_string b;
+    
+    try
+    {
+        b.remove_last_bit(); ASSERT(false);
+    }
+    catch (std::runtime_error& err)
+    {
+        
+    }
+}
+
+void test_bit_string_clear()
+{
+    bit_string b;
+    
+    for (int i = 0; i < 1000; ++i)
+    {
+        ASSERT(b.length() == i);
+        b.append_bit(true);
+        ASSERT(b.length() == i + 1);
+    }
+    
+    b.clear();
+    ASSERT(b.length() == 0);
+}
+
+void test_bit_string_get_number_of_occupied_bytes()
+{
+    bit_string b;
+    ASSERT(0 == b.get_number_of_occupied_bytes());
+    
+    for (int i = 0; i < 100; ++i)
+    {
+        ASSERT(b.get_number_of_occupied_bytes() == i);
+        
+        for (int j = 0; j < 8; ++j)
+        {
+            b.append_bit(true);
+            ASSERT(i + 1 == b.get_number_of_occupied_bytes());
+        }
+        
+        ASSERT(i + 1 == b.get_number_of_occupied_bytes());
+    }
+}
+
+void test_bit_string_to_byte_array()
+{
+    bit_string b;
+    
+    for (int i = 0; i < 40; ++i)
+    {
+        b.append_bit(i % 2 == 1);
+    }
+    
+    for (int i = 0; i < 80; ++i)
+    {
+        b.append_bit(i % 2 == 0);
+    }
+    
+    std::vector<int8_t> bytes{b.to_byte_array()};
+    
+    for (int i = 0; i < 5; ++i)
+    {
+        ASSERT(0xaa == (uint8_t) bytes[i]);
+    }
+    
+    for (int i = 5; i < 15; ++i)
+    {
+        ASSERT(0x55 == bytes[i]);
+    }
+}
+
+void test_bit_string()
+{
+    test_append_bit();
+    test_append_bits_from();
+    test_read_bit();
+    test_read_bit_bad_index_throws();
+    test_read_bit_throws_on_empty_string();
+    test_remove_last_bit();
+    test_remove_last_bit_throws_on_empty_string();
+    test_bit_string_clear();
+    test_bit_string_get_number_of_occupied_bytes();
+    test_bit_string_to_byte_array();
+}
+
+std::vector<int8_t> random_text()
+{
+    std::random_device rd;
+    std::default_random_engine engine(rd());
+    std::uniform_int_distribution<size_t> uniform_dist_length(0, 10 * 100);
+    std::uniform_int_distribution<int8_t>
+        uniform_dist(std::numeric_limits<int8_t>::min(),
+                     std::numeric_limits<int8_t>::max());
+    
+    size_t len = uniform_dist_length(engine);
+    std::vector<int8_t> ret;
+    
+    for (size_t i = 0; i != len; ++i)
+    {
+        ret.push_back(uniform_dist(engine));
+    }
+    
+    return ret;
+}
+
+void test_brute_force()
+{
+    std::vector<int8_t> text = random_text();
+    std::map<int8_t, uint32_t> count_map = compute_byte_counts(text);
+    
+    huffman_tree tree(count_map);
+    
+    std::map<int8_t, bit_string> encoder_map = tree.infer_encoder_map();
+    
+    huffman_encoder encoder;
+    
+    bit_string text_bit_string = encoder.encode(encoder_map, text);
+    
+    huffman_serializer serializer;
+    
+    std::vector<int8_t> encoded_data = serializer.serialize(count_map,
+                                                            text_bit_string);
+    huffman_deserializer deserializer;
+    huffman_deserializer::result hdr = deserializer.deserialize(encoded_data);
+    
+    huffman_tree decoder_tree(hdr.counts);
+    huffman_decoder decoder;
+    
+    ASSERT(hdr.counts.number_of_characters() == count_map.size());
+    ASSERT(hdr.counts.to_count_map() == count_map);
+    
+    ASSERT(text_bit_string.length() == hdr.encoded_text.length());
+    
+    std::vector<int8_t> recovered_text = decoder.decode(decoder_tree,
+                                                        hdr.encoded_text);
+    ASSERT(text.size() == recovered_text.size());
+    ASSERT(std::equal(text.begin(), text.end(), recovered_text.begin()));
+}
+
+void test_simple_algorithm()
+{
+    std::string text = "hello world";
+    std::vector<int8_t> text_vector;
+    
+    for (char c : text)
+    {
+        text_vector.push_back((int8_t) c);
+    }
+    
+    std::map<int8_t, uint32_t> count_map = compute_byte_counts(text_vector);
+    
+    huffman_tree tree(count_map);
+    
+    std::map<int8_t, bit_string> encoder_map = tree.infer_encoder_map();
+    
+    huffman_encoder encoder;
+    
+    bit_string text_bit_string = encoder.encode(encoder_map, text_vector);
+    
+    huffman_serializer serializer;
+    
+    std::vector<int8_t> encoded_text = serializer.serialize(count_map,
+                                                            text_bit_string);
+    
+    huffman_deserializer deserializer;
+    
+    huffman_deserializer::result hdr = deserializer.deserialize(encoded_text);
+    
+    huffman_tree decoder_tree(hdr.counts);
+    huffman_decoder decoder;
+    
+    std::vector<int8_t> recovered_text = decoder.decode(decoder_tree,
+                                                        hdr.encoded_text);
+    ASSERT(text.size() == recovered_text.size());
+    ASSERT(std::equal(text.begin(), text.end(), recovered_text.begin()));
+}
+
+void test_one_byte_text()
+{
+    std::vector<int8_t> text = { 0x01, 0x01 };
+    std::map<int8_t, uint32_t> count_map = compute_byte_counts(text);
+    huffman_tree tree(count_map);
+    std::map<int8_t, bit_string> encoder_map = tree.infer_encoder_map();
+    huffman_encoder encoder;
+    bit_string text_bit_string = encoder.encode(encoder_map, text);
+    huffman_serializer serializer;
+    std::vector<int8_t> serialized_text = serializer.serialize(count_map,
+                                                               text_bit_string);
+    huffman_deserializer deserializer;
+    huffman_deserializer::result hdr =
+        deserializer.deserialize(serialized_text);
+    
+    huffman_tree decoder_tree(hdr.counts);
+    
+    huffman_decoder decoder;
+    
+    std::vector<int8_t> recovered_text = decoder.decode(decoder_tree,
+                                                        hdr.encoded_text);
+    ASSERT(recovered_text.size() == 2);
+    ASSERT(recovered_text[0] = 0x1);
+    ASSERT(recovered_text[1] = 0x1);
+}
+
+void test_decode_table_matches_tree_walk()
+{
+    std::vector<int8_t> text = random_text();
+    text.push_back(0x7f);
+    std::map<int8_t, uint32_t> count_map = compute_byte_counts(text);
+    huffman_tree tree(count_map);
+    std::map<int8_t, bit_string> encoder_map = tree.infer_encoder_map();
+    huffman_encoder encoder;
+    bit_string text_bit_string = encoder.encode(encoder_map, text);
+    
+    huffman_decode_table table(encoder_map);
+    huffman_decoder decoder;
+    std::vector<int8_t> table_text = decoder.decode(table, text_bit_string);
+    
+    size_t index = 0;
+    
+    for (size_t i = 0; i != table_text.size(); ++i)
+    {
+        ASSERT(table_text[i] == tree.decode_bit_string(index,
+                                                       text_bit_string));
+    }
+    
+    ASSERT(index == text_bit_string.length());
+    ASSERT(table_text.size() == text.size());
+    ASSERT(std::equal(text.begin(), text.end(), table_text.begin()));
+}
+
+void test_decode_table_long_code_words()
+{
+    // Fibonacci counts produce the deepest possible tree, so that the code
+    // words exercise both the second-level tables and the slow path:
+    std::map<int8_t, uint32_t> count_map;
+    uint32_t a = 1;
+    uint32_t b = 1;
+    
+    for (int8_t c = 0; c != 40; ++c)
+    {
+        count_map[c] = a;
+        uint32_t next = a + b;
+        a = b;
+        b = next;
+    }
+    
+    huffman_tree tree(count_map);
+    std::map<int8_t, bit_string> encoder_map = tree.infer_encoder_map();
+    ASSERT(encoder_map[0].length() > huffman_decode_table::PRIMARY_BITS +
+                                     huffman_decode_table::MAX_SECONDARY_BITS);
+    
+    std::vector<int8_t> text;
+    
+    for (int8_t c = 0; c != 40; ++c)
+    {
+        text.push_back(c);
+        text.push_back(39 - c);
+    }
+    
+    huffman_encoder encoder;
+    bit_string text_bit_string = encoder.encode(encoder_map, text);
+    huffman_decoder decoder;
+    std::vector<int8_t> recovered_text = decoder.decode(tree, text_bit_string);
+    ASSERT(text.size() == recovered_text.size());
+    ASSERT(std::equal(text.begin(), text.end(), recovered_text.begin()));
+}
+
+void test_canonical_brute_force()
+{
+    std::vector<int8_t> text = random_text();
+    text.push_back(0x00);
+    histogram counts = compute_byte_histogram(text);
+    huffman_tree tree(counts);
+    code_table table = tree.infer_canonical_code_table();
+    
+    ASSERT(table.number_of_code_words() == counts.number_of_characters());
+    ASSERT(table ==
+           code_table(infer_canonical_encoder_map(
+                                            tree.infer_code_length_map())));
+    
+    huffman_encoder encoder;
+    bit_string text_bit_string = encoder.encode(table, text);
+    huffman_serializer serializer;
+    std::vector<int8_t> encoded_data = serializer.serialize(table,
+                                                            text_bit_string);
+    ASSERT(encoded_data.size() <
+           sizeof(huffman_serializer::MAGIC_V2)
+           + huffman_serializer::MAX_BYTES_PER_BIT_COUNT_ENTRY_V2
+           + huffman_serializer::BYTES_PER_CHARACTER_BITMAP
+           + counts.number_of_characters() + 2
+           + text_bit_string.get_number_of_occupied_bytes());
+    
+    huffman_deserializer deserializer;
+    huffman_deserializer::result hdr = deserializer.deserialize(encoded_data);
+    ASSERT(hdr.counts.number_of_characters() == 0);
+    ASSERT(hdr.code_words == table);
+    
+    huffman_decoder decoder;
+    std::vector<int8_t> recovered_text =
+        decoder.decode(hdr.build_decode_table(), hdr.encoded_text);
+    ASSERT(text.size() == recovered_text.size());
+    ASSERT(std::equal(text.begin(), text.end(), recovered_text.begin()));
+}
+
+void test_canonical_code_words()
+{
+    // The lengths of the example in RFC 1951, section 3.2.2:
+    std::map<int8_t, uint8_t> code_length_map = {
+        { 'A', 3 }, { 'B', 3 }, { 'C', 3 }, { 'D', 3 },
+        { 'E', 3 }, { 'F', 2 }, { 'G', 4 }, { 'H', 4 }
+    };
+    
+    std::map<int8_t, bit_string> encoder_map =
+        infer_canonical_encoder_map(code_length_map);
+    
+    std::stringstream ss;
+    ss << encoder_map['F'] << ' ' << encoder_map['A'] << ' '
+       << encoder_map['E'] << ' ' << encoder_map['H'];
+    ASSERT(ss.str() == "00 010 110 1111");
+    
+    code_length_map['I'] = 1;
+    
+    try
+    {
+        infer_canonical_encoder_map(code_length_map); ASSERT(false);
+    }
+    catch (file_format_error& err)
+    {
+        
+    }
+}
+
+void test_v2_header_size()
+{
+    std::vector<int8_t> text = { 'a', 'b', 'a', 'a' };
+    huffman_tree tree(compute_byte_histogram(text));
+    code_table table = tree.infer_canonical_code_table();
+    huffman_encoder encoder;
+    bit_string text_bit_string = encoder.encode(table, text);
+    huffman_serializer serializer;
+    std::vector<int8_t> encoded_data = serializer.serialize(table,
+                                                            text_bit_string);
+    
+    // Magic, bit count, character count, two characters, max length, one
+    // byte of nibbles and one byte of the encoded text:
+    ASSERT(encoded_data.size() == 4 + 1 + 1 + 2 + 1 + 1 + 1);
+    
+    huffman_deserializer deserializer;
+    huffman_deserializer::result hdr = deserializer.deserialize(encoded_data);
+    huffman_decoder decoder;
+    std::vector<int8_t> recovered_text =
+        decoder.decode(hdr.build_decode_table(), hdr.encoded_text);
+    ASSERT(text == recovered_text);
+    
+    encoded_data.resize(8);
+    
+    try
     {
-        ASSERT(b.read_bit(i) == true);
+        deserializer.deserialize(encoded_data); ASSERT(false);
+    }
+    catch (file_format_error& err)
+    {
+        
     }
 }
 
-void test_read_bit()
+void test_encoder_matches_bitwise_append()
 {
-    bit_string b;
-    b.append_bit(true);
-    b.append_bit(false);
-    b.append_bit(false);
-    b.append_bit(true);
-    b.append_bit(false);
+    // Mix short code words with ones longer than half a word:
+    std::map<int8_t, uint32_t> count_map;
+    uint32_t a = 1;
+    uint32_t b = 1;
     
-    ASSERT(b.length() == 5);
+    for (int8_t c = 0; c != 40; ++c)
+    {
+        count_map[c] = a;
+        uint32_t next = a + b;
+        a = b;
+        b = next;
+    }
     
-    ASSERT(b.read_bit(0) == true);
-    ASSERT(b.read_bit(3) == true);
+    huffman_tree tree(count_map);
+    std::map<int8_t, bit_string> encoder_map = tree.infer_encoder_map();
+    std::vector<int8_t> text = random_text();
     
-    ASSERT(b.read_bit(1) == false);
-    ASSERT(b.read_bit(2) == false);
-    ASSERT(b.read_bit(4) == false);
+    for (int8_t& c : text)
+    {
+        c = (int8_t)((uint8_t) c % 40);
+    }
+    
+    bit_string expected;
+    
+    for (int8_t c : text)
+    {
+        expected.append_bits_from(encoder_map[c]);
+    }
+    
+    huffman_encoder encoder;
+    bit_string actual = encoder.encode(code_table(encoder_map), text);
+    ASSERT(expected.length() == actual.length());
+    
+    for (size_t i = 0; i != expected.length(); ++i)
+    {
+        ASSERT(expected.read_bit(i) == actual.read_bit(i));
+    }
 }
 
-void test_read_bit_bad_index_throws()
+void test_byte_histogram_matches_reference()
 {
-    bit_string b;
-    b.append_bit(true);
+    std::vector<int8_t> text = random_text();
+    
+    // Make some byte values much more frequent than the others:
+    for (size_t i = 0; i < text.size(); i += 3)
+    {
+        text[i] = 'e';
+    }
+    
+    for (size_t length = 0; length <= text.size(); length += 1 + length / 4)
+    {
+        ASSERT(compute_byte_histogram(text.data(), length) ==
+               compute_byte_histogram_reference(text.data(), length));
+    }
+    
+    ASSERT(compute_byte_histogram(text).total_count() == text.size());
+}
+
+void test_block_stream_round_trip()
+{
+    std::vector<int8_t> text;
+    std::vector<int8_t> chunk = random_text();
+    
+    // Span several blocks and end with a single-character block:
+    size_t block_size = (size_t) 1 << block_format::MIN_BLOCK_SIZE_LOG2;
+    
+    while (text.size() < 3 * block_size)
+    {
+        text.insert(text.end(), chunk.begin(), chunk.end());
+        text.push_back('x');
+    }
+    
+    text.insert(text.end(), 1000, 'z');
+    
+    block_compressor compressor(block_format::MIN_BLOCK_SIZE_LOG2);
+    std::string input((const char*) text.data(), text.size());
+    std::istringstream in(input);
+    std::ostringstream compressed;
+    compressor.compress(in, compressed);
+    
+    block_decompressor decompressor;
+    std::istringstream compressed_in(compressed.str());
+    std::ostringstream out;
+    decompressor.decompress(compressed_in, out);
+    ASSERT(out.str() == input);
+    
+    // A truncated stream must be rejected:
+    std::string truncated = compressed.str();
+    truncated.resize(truncated.size() / 2);
+    std::istringstream truncated_in(truncated);
+    std::ostringstream discarded;
     
     try
     {
-        b.read_bit(1); ASSERT(false);
+        decompressor.decompress(truncated_in, discarded); ASSERT(false);
     }
-    catch (std::runtime_error& err)
+    catch (file_format_error& err)
     {
         
     }
+}
+
+void test_block_stream_empty_input()
+{
+    block_compressor compressor;
+    std::istringstream in("");
+    std::ostringstream compressed;
+    compressor.compress(in, compressed);
+    
+    // The header, the end of stream block and an index of no blocks:
+    ASSERT(compressed.str().size() == block_format::STREAM_HEADER_SIZE + 2
+                                    + block_format::INDEX_FOOTER_SIZE);
+    
+    block_decompressor decompressor;
+    std::istringstream compressed_in(compressed.str());
+    std::ostringstream out;
+    decompressor.decompress(compressed_in, out);
+    ASSERT(out.str().empty());
+}
+
+void test_thread_pool()
+{
+    thread_pool pool(4);
+    std::vector<int> results(1000, 0);
+    std::vector<std::future<void>> futures;
+    
+    for (int i = 0; i != (int) results.size(); ++i)
+    {
+        futures.push_back(pool.submit([&results, i]() {
+            results[i] = i * i;
+        }));
+    }
+    
+    for (std::future<void>& future : futures)
+    {
+        future.get();
+    }
+    
+    for (int i = 0; i != (int) results.size(); ++i)
+    {
+        ASSERT(results[i] == i * i);
+    }
+    
+    // The exceptions thrown by the tasks reach the caller:
+    std::future<void> failing = pool.submit([]() {
+        throw std::runtime_error{"Task failed."};
+    });
     
     try
     {
-        b.read_bit(-1); ASSERT(false);
+        failing.get(); ASSERT(false);
     }
     catch (std::runtime_error& err)
     {
@@ -424,265 +2174,1288 @@ void test_read_bit_bad_index_throws()
     }
 }
 
-void test_read_bit_throws_on_empty_string()
+void test_parallel_compression_is_deterministic()
 {
-    bit_string b;
+    std::vector<int8_t> text;
+    std::vector<int8_t> chunk = random_text();
+    
+    chunk.push_back('y');
+    size_t block_size = (size_t) 1 << block_format::MIN_BLOCK_SIZE_LOG2;
+    
+    while (text.size() < 9 * block_size + 5)
+    {
+        text.insert(text.end(), chunk.begin(), chunk.end());
+    }
+    
+    block_compressor compressor(block_format::MIN_BLOCK_SIZE_LOG2);
+    std::string input((const char*) text.data(), text.size());
+    std::istringstream serial_in(input);
+    std::ostringstream serial_out;
+    compressor.compress(serial_in, serial_out);
+    
+    for (size_t number_of_threads : { 1, 2, 4 })
+    {
+        thread_pool pool(number_of_threads);
+        std::istringstream parallel_in(input);
+        std::ostringstream parallel_out;
+        compressor.compress(parallel_in, parallel_out, pool);
+        ASSERT(parallel_out.str() == serial_out.str());
+    }
+}
+
+void test_parallel_decompression()
+{
+    std::vector<int8_t> text;
+    std::vector<int8_t> chunk = random_text();
+    chunk.push_back('w');
+    size_t block_size = (size_t) 1 << block_format::MIN_BLOCK_SIZE_LOG2;
+    
+    while (text.size() < 7 * block_size + 3)
+    {
+        text.insert(text.end(), chunk.begin(), chunk.end());
+    }
+    
+    block_compressor compressor(block_format::MIN_BLOCK_SIZE_LOG2);
+    std::string input((const char*) text.data(), text.size());
+    std::istringstream in(input);
+    std::ostringstream compressed;
+    compressor.compress(in, compressed);
+    
+    std::istringstream index_in(compressed.str());
+    block_index index =
+        block_index::read_trailer(index_in,
+                                  0,
+                                  compressor.get_block_size());
+    ASSERT(index.number_of_blocks() == 8);
+    ASSERT(index.get_decompressed_size() == text.size());
+    ASSERT(index.get_entry(7).decompressed_offset ==
+           7 * compressor.get_block_size());
+    
+    thread_pool pool(4);
+    block_decompressor decompressor;
+    std::istringstream compressed_in(compressed.str());
+    std::ostringstream out;
+    decompressor.decompress(compressed_in, out, pool);
+    ASSERT(out.str() == input);
+    
+    // The workers' scratch kept from the first call must not leak into the
+    // next one:
+    std::istringstream again_in(compressed.str());
+    std::ostringstream again_out;
+    decompressor.decompress(again_in, again_out, pool);
+    ASSERT(again_out.str() == input);
+    
+    // An index disagreeing with the blocks must be rejected by both paths:
+    std::string corrupted = compressed.str();
+    corrupted[corrupted.size() - block_format::INDEX_FOOTER_SIZE - 1] ^= 1;
+    
+    for (int parallel = 0; parallel != 2; ++parallel)
+    {
+        std::istringstream corrupted_in(corrupted);
+        std::ostringstream discarded;
+        
+        try
+        {
+            if (parallel)
+            {
+                decompressor.decompress(corrupted_in, discarded, pool);
+            }
+            else
+            {
+                decompressor.decompress(corrupted_in, discarded);
+            }
+            
+            ASSERT(false);
+        }
+        catch (file_format_error& err)
+        {
+            
+        }
+    }
+    
+    // A stream without the index is decoded sequentially:
+    std::vector<int8_t> unindexed;
+    compressor.append_stream_header(unindexed);
+    unindexed[block_format::STREAM_HEADER_SIZE - 1] = 0;
+    compressor.compress_block(text.data(), 1000, unindexed);
+    unindexed.push_back((int8_t) block_format::END_OF_STREAM);
+    
+    std::istringstream unindexed_in(std::string((const char*) unindexed.data(),
+                                                unindexed.size()));
+    std::ostringstream unindexed_out;
+    decompressor.decompress(unindexed_in, unindexed_out, pool);
+    ASSERT(unindexed_out.str() == input.substr(0, 1000));
+}
+
+void test_interleaved_streams()
+{
+    std::vector<int8_t> text = random_text();
+    
+    // Mix in a skewed run so that some code words miss the primary table:
+    for (int8_t c = 0; c != 20; ++c)
+    {
+        text.insert(text.end(), (size_t) 1 << (c / 2), c);
+        text.push_back(20 - c);
+    }
+    
+    histogram counts = compute_byte_histogram(text);
+    huffman_tree tree(counts);
+    code_table table = tree.infer_canonical_code_table();
+    huffman_decode_table decode_table(table);
+    huffman_encoder encoder;
+    huffman_decoder decoder;
+    
+    for (size_t number_of_streams = 1;
+         number_of_streams <= huffman_decoder::MAX_NUMBER_OF_STREAMS;
+         ++number_of_streams)
+    {
+        // Also cover the texts shorter than a round:
+        for (size_t length : { text.size(), number_of_streams - 1 })
+        {
+            std::vector<bit_string> streams =
+                encoder.encode_interleaved(table,
+                                           text.data(),
+                                           length,
+                                           number_of_streams);
+            std::vector<int8_t> encoded_text;
+            std::vector<size_t> numbers_of_bits;
+            
+            for (const bit_string& stream : streams)
+            {
+                stream.append_bytes_to(encoded_text);
+                numbers_of_bits.push_back(stream.length());
+            }
+            
+            std::vector<int8_t> recovered_text(length);
+            decoder.decode_interleaved(decode_table,
+                                       encoded_text.data(),
+                                       numbers_of_bits,
+                                       recovered_text.data(),
+                                       length);
+            ASSERT(std::equal(recovered_text.begin(),
+                              recovered_text.end(),
+                              text.begin()));
+        }
+    }
+}
+
+void test_block_stream_interleaved()
+{
+    std::vector<int8_t> text;
+    std::vector<int8_t> chunk = random_text();
+    chunk.push_back('v');
+    size_t block_size = (size_t) 1 << block_format::MIN_BLOCK_SIZE_LOG2;
+    
+    while (text.size() < 2 * block_size + 7)
+    {
+        text.insert(text.end(), chunk.begin(), chunk.end());
+    }
+    
+    std::string input((const char*) text.data(), text.size());
+    
+    for (size_t number_of_streams : { 4, 8 })
+    {
+        block_compressor compressor(block_format::MIN_BLOCK_SIZE_LOG2,
+                                    number_of_streams);
+        std::istringstream in(input);
+        std::ostringstream compressed;
+        compressor.compress(in, compressed);
+        
+        block_decompressor decompressor;
+        std::istringstream compressed_in(compressed.str());
+        std::ostringstream out;
+        decompressor.decompress(compressed_in, out);
+        ASSERT(out.str() == input);
+    }
+}
+
+// Returns the cost of the cheapest prefix code with no code word longer
+// than 'max_length' bits by trying all the code word lengths:
+uint64_t brute_force_limited_length(const std::vector<uint32_t>& weights,
+                                    size_t max_length)
+{
+    std::vector<size_t> lengths(weights.size(), 1);
+    uint64_t best = std::numeric_limits<uint64_t>::max();
+    
+    while (true)
+    {
+        uint64_t kraft_sum = 0;
+        uint64_t cost = 0;
+        
+        for (size_t i = 0; i != weights.size(); ++i)
+        {
+            kraft_sum += 1ULL << (max_length - lengths[i]);
+            cost += (uint64_t) weights[i] * lengths[i];
+        }
+        
+        if (kraft_sum <= (1ULL << max_length))
+        {
+            best = std::min(best, cost);
+        }
+        
+        size_t i = 0;
+        
+        while (i != lengths.size() && lengths[i] == max_length)
+        {
+            lengths[i++] = 1;
+        }
+        
+        if (i == lengths.size())
+        {
+            return best;
+        }
+        
+        ++lengths[i];
+    }
+}
+
+void test_length_limited_code()
+{
+    histogram counts;
+    uint32_t weights[] = { 1, 1, 2, 4, 8 };
+    
+    for (int8_t c = 0; c != 5; ++c)
+    {
+        counts.set_count(c, weights[c]);
+    }
+    
+    code_table limited = build_length_limited_code(counts, 3);
+    ASSERT(limited.max_length() == 3);
+    ASSERT(limited.get_length(4) == 1);
+    ASSERT(compute_encoded_length(counts, limited) == 32);
+    
+    // A limit the optimal code fits in changes nothing:
+    huffman_tree tree(counts);
+    code_table unlimited = tree.infer_canonical_code_table();
+    ASSERT(compute_encoded_length(counts, unlimited) == 30);
+    ASSERT(compute_encoded_length(counts,
+                                  build_length_limited_code(counts, 4)) == 30);
     
     try
     {
-        b.read_bit(0); ASSERT(false);
+        build_length_limited_code(counts, 2); ASSERT(false);
     }
-    catch (std::runtime_error& err)
+    catch (std::invalid_argument& err)
     {
         
     }
+    
+    std::random_device rd;
+    std::default_random_engine engine(rd());
+    std::uniform_int_distribution<uint32_t> weight_dist(1, 1000);
+    
+    for (size_t n = 2; n <= 6; ++n)
+    {
+        std::vector<uint32_t> random_weights;
+        histogram random_counts;
+        
+        for (size_t i = 0; i != n; ++i)
+        {
+            // Skew the weights to make the limit bind:
+            random_weights.push_back(weight_dist(engine) << (2 * i));
+            random_counts.set_count((int8_t) i, random_weights.back());
+        }
+        
+        for (size_t max_length = 3; max_length <= 5; ++max_length)
+        {
+            code_table table = build_length_limited_code(random_counts,
+                                                         max_length);
+            ASSERT(table.max_length() <= max_length);
+            ASSERT(compute_encoded_length(random_counts, table) ==
+                   brute_force_limited_length(random_weights, max_length));
+        }
+    }
 }
 
-void test_remove_last_bit()
+void test_block_stream_length_limit()
 {
-    bit_string b;
+    // Fibonacci counts need code words much longer than the limit:
+    std::vector<int8_t> text;
+    uint32_t a = 1;
+    uint32_t b = 1;
+    
+    for (int8_t c = 0; c != 25; ++c)
+    {
+        text.insert(text.end(), a, c);
+        uint32_t next = a + b;
+        a = b;
+        b = next;
+    }
+    
+    block_compressor compressor(block_format::MIN_BLOCK_SIZE_LOG2, 1, 11);
+    std::string input((const char*) text.data(), text.size());
+    std::istringstream in(input);
+    std::ostringstream compressed;
+    compressor.compress(in, compressed);
+    ASSERT(compressor.get_number_of_encoded_bits() >
+           compressor.get_number_of_unlimited_bits());
+    
+    block_decompressor decompressor;
+    std::istringstream compressed_in(compressed.str());
+    std::ostringstream out;
+    decompressor.decompress(compressed_in, out);
+    ASSERT(out.str() == input);
+}
+
+void test_minimum_redundancy_code()
+{
+    std::vector<int8_t> text = random_text();
+    text.push_back('q');
+    
+    // Make the counts skewed now and then:
+    for (size_t i = 0; i < text.size(); i += 1 + text.size() % 5)
+    {
+        text[i] = (int8_t)(i % 7);
+    }
+    
+    histogram counts = compute_byte_histogram(text);
+    code_table table = build_minimum_redundancy_code(counts);
+    huffman_tree tree(counts);
+    code_table tree_table = tree.infer_canonical_code_table();
+    
+    ASSERT(table.number_of_code_words() == counts.number_of_characters());
+    ASSERT(compute_encoded_length(counts, table) ==
+           compute_encoded_length(counts, tree_table));
+    
+    // The code must be complete unless there is a single character:
+    if (counts.number_of_characters() > 1)
+    {
+        uint64_t kraft_sum = 0;
+        
+        for (int c = -128; c != 128; ++c)
+        {
+            size_t length = table.get_length((int8_t) c);
+            
+            if (length != 0)
+            {
+                kraft_sum += 1ULL << (code_table::MAX_CODE_WORD_LENGTH
+                                      - length);
+            }
+        }
+        
+        ASSERT(kraft_sum == 1ULL << code_table::MAX_CODE_WORD_LENGTH);
+    }
+}
+
+void test_minimum_redundancy_code_deep()
+{
+    // Fibonacci counts give the deepest code:
+    histogram counts;
+    uint32_t a = 1;
+    uint32_t b = 1;
+    
+    for (int8_t c = 0; c != 40; ++c)
+    {
+        counts.set_count(c, a);
+        uint32_t next = a + b;
+        a = b;
+        b = next;
+    }
+    
+    code_table table = build_minimum_redundancy_code(counts);
+    huffman_tree tree(counts);
+    ASSERT(table.max_length() == 39);
+    ASSERT(compute_encoded_length(counts, table) ==
+           compute_encoded_length(counts, tree.infer_canonical_code_table()));
+    
+    histogram single;
+    single.set_count('z', 10);
+    code_table single_table = build_minimum_redundancy_code(single);
+    ASSERT(single_table.get_length('z') == 1);
+    ASSERT(single_table.number_of_code_words() == 1);
+}
+
+void test_pipeline_statistics()
+{
+    std::string input;
+    
+    for (size_t i = 0; i != 50000; ++i)
+    {
+        input += (char)('a' + i * i % 13);
+    }
+    
+    block_compressor compressor(block_format::MIN_BLOCK_SIZE_LOG2);
+    pipeline_statistics statistics;
+    compressor.set_statistics(&statistics);
+    std::istringstream in(input);
+    std::ostringstream compressed;
+    compressor.compress(in, compressed);
+    statistics.finish();
+    
+    double entropy = statistics.compute_entropy();
+    double average_code_length = statistics.compute_average_code_length();
+    ASSERT(entropy > 0.0 && entropy <= 8.0);
+    ASSERT(average_code_length >= entropy - 1e-9);
+    ASSERT(average_code_length < entropy + 1.0);
+    ASSERT(statistics.compute_ratio() ==
+           (double) input.size() / compressed.str().size());
+    
+    std::ostringstream json;
+    statistics.print_json(json);
+    ASSERT(json.str().find("{\"stages\":{\"read\":") == 0);
+    ASSERT(json.str().find("\"serialize\"") != std::string::npos);
+    
+    block_decompressor decompressor;
+    pipeline_statistics decode_statistics;
+    decompressor.set_statistics(&decode_statistics);
+    std::istringstream compressed_in(compressed.str());
+    std::ostringstream out;
+    decompressor.decompress(compressed_in, out);
+    ASSERT(out.str() == input);
+    ASSERT(decode_statistics.compute_ratio() == statistics.compute_ratio());
+    ASSERT(decode_statistics.compute_entropy() == entropy);
+    ASSERT(decode_statistics.compute_average_code_length() ==
+           average_code_length);
+}
+
+void test_block_stream_in_memory()
+{
+    std::vector<int8_t> text = random_text();
+    text.push_back('m');
+    
+    // Span several blocks with a partial last one:
+    const size_t length = 3 * (1 << block_format::MIN_BLOCK_SIZE_LOG2) + 100;
+    
+    for (size_t i = 0; text.size() < length; ++i)
+    {
+        text.push_back(text[i]);
+    }
+    
+    block_compressor compressor(block_format::MIN_BLOCK_SIZE_LOG2, 2);
+    std::string input((const char*) text.data(), text.size());
+    std::istringstream in(input);
+    std::ostringstream expected;
+    compressor.compress(in, expected);
+    
+    std::ostringstream from_memory;
+    compressor.compress(text.data(), text.size(), from_memory);
+    ASSERT(from_memory.str() == expected.str());
+    
+    thread_pool pool(3);
+    std::ostringstream from_memory_parallel;
+    compressor.compress(text.data(), text.size(), from_memory_parallel, pool);
+    ASSERT(from_memory_parallel.str() == expected.str());
+    
+    std::string compressed = expected.str();
+    block_decompressor decompressor;
+    block_index index;
+    ASSERT(decompressor.read_block_index((const int8_t*) compressed.data(),
+                                         compressed.size(),
+                                         index));
+    ASSERT(index.get_decompressed_size() == text.size());
+    ASSERT(index.number_of_blocks() == 4);
+    
+    std::vector<int8_t> decompressed(text.size());
+    decompressor.decompress((const int8_t*) compressed.data(),
+                            compressed.size(),
+                            index,
+                            decompressed.data());
+    ASSERT(decompressed == text);
+    
+    std::vector<int8_t> decompressed_parallel(text.size());
+    decompressor.decompress((const int8_t*) compressed.data(),
+                            compressed.size(),
+                            index,
+                            decompressed_parallel.data(),
+                            pool);
+    ASSERT(decompressed_parallel == text);
+    
+    // A damaged block length is caught by the index check:
+    std::string corrupted = compressed;
+    corrupted[index.get_entry(2).compressed_offset + 1] ^= 0x01;
+    bool caught = false;
+    
+    try
+    {
+        decompressor.decompress((const int8_t*) corrupted.data(),
+                                corrupted.size(),
+                                index,
+                                decompressed.data(),
+                                pool);
+    }
+    catch (file_format_error& error)
+    {
+        caught = true;
+    }
     
-    b.append_bit(true);
-    b.append_bit(true);
-    b.append_bit(false);
-    b.append_bit(true);
-    b.append_bit(false);
+    ASSERT(caught);
     
-    ASSERT(b.read_bit(0) == true);
-    ASSERT(b.read_bit(1) == true);
-    ASSERT(b.read_bit(2) == false);
-    ASSERT(b.read_bit(3) == true);
-    ASSERT(b.read_bit(4) == false);
+    // It is caught already when the index is read, before the output is
+    // sized by the index:
+    block_index corrupted_index;
+    caught = false;
     
-    for (int i = 5; i > 0; --i)
+    try
     {
-        ASSERT(b.length() == i);
-        b.remove_last_bit();
-        ASSERT(b.length() == i - 1);
+        decompressor.read_block_index((const int8_t*) corrupted.data(),
+                                      corrupted.size(),
+                                      corrupted_index);
+    }
+    catch (file_format_error& error)
+    {
+        caught = true;
     }
+    
+    ASSERT(caught);
 }
 
-void test_remove_last_bit_throws_on_empty_string()
+void test_block_stream_caller_buffers()
 {
-    bit_string b;
+    // Uniform random bytes are the worst case for the bound:
+    std::random_device rd;
+    std::default_random_engine engine(rd());
+    std::uniform_int_distribution<int> uniform_dist(-128, 127);
+    std::vector<int8_t> text(2 * (1 << block_format::MIN_BLOCK_SIZE_LOG2)
+                             + engine() % 1000);
+    
+    for (int8_t& c : text)
+    {
+        c = (int8_t) uniform_dist(engine);
+    }
+    
+    block_compressor compressor(block_format::MIN_BLOCK_SIZE_LOG2, 8);
+    std::vector<int8_t> compressed(compressor.compress_bound(text.size()));
+    size_t compressed_size = compressor.compress(text.data(),
+                                                 text.size(),
+                                                 compressed.data(),
+                                                 compressed.size());
+    compressed.resize(compressed_size);
+    
+    std::ostringstream expected;
+    compressor.compress(text.data(), text.size(), expected);
+    ASSERT(std::string((const char*) compressed.data(), compressed.size()) ==
+           expected.str());
+    ASSERT(compressor.compress_bound(0) ==
+           block_format::STREAM_HEADER_SIZE + 2
+           + block_format::INDEX_FOOTER_SIZE);
+    
+    bool caught = false;
+    std::vector<int8_t> small(compressed_size - 1);
     
     try
     {
-        b.remove_last_bit(); ASSERT(false);
+        compressor.compress(text.data(),
+                            text.size(),
+                            small.data(),
+                            small.size());
     }
-    catch (std::runtime_error& err)
+    catch (std::invalid_argument& error)
     {
-        
+        caught = true;
     }
-}
-
-void test_bit_string_clear()
-{
-    bit_string b;
     
-    for (int i = 0; i < 1000; ++i)
+    ASSERT(caught);
+    
+    block_decompressor decompressor;
+    ASSERT(decompressor.get_decompressed_size(compressed.data(),
+                                              compressed.size()) ==
+           text.size());
+    std::vector<int8_t> decompressed(text.size());
+    ASSERT(decompressor.decompress(compressed.data(),
+                                   compressed.size(),
+                                   decompressed.data(),
+                                   decompressed.size()) == text.size());
+    ASSERT(decompressed == text);
+    
+    caught = false;
+    
+    try
     {
-        ASSERT(b.length() == i);
-        b.append_bit(true);
-        ASSERT(b.length() == i + 1);
+        decompressor.decompress(compressed.data(),
+                                compressed.size(),
+                                small.data(),
+                                text.size() - 1);
+    }
+    catch (std::invalid_argument& error)
+    {
+        caught = true;
     }
     
-    b.clear();
-    ASSERT(b.length() == 0);
+    ASSERT(caught);
+    
+    // Without the index the blocks are found by walking the stream:
+    block_index index;
+    decompressor.read_block_index(compressed.data(), compressed.size(), index);
+    std::vector<int8_t> unindexed(compressed.begin(),
+                                  compressed.begin()
+                                  + index.get_end_of_blocks_offset() + 1);
+    unindexed[5] = 0;
+    std::fill(decompressed.begin(), decompressed.end(), 0);
+    ASSERT(decompressor.get_decompressed_size(unindexed.data(),
+                                              unindexed.size()) ==
+           text.size());
+    decompressor.decompress(unindexed.data(),
+                            unindexed.size(),
+                            decompressed.data(),
+                            decompressed.size());
+    ASSERT(decompressed == text);
 }
 
-void test_bit_string_get_number_of_occupied_bytes()
+void test_contexts()
 {
-    bit_string b;
-    ASSERT(0 == b.get_number_of_occupied_bytes());
-    
-    for (int i = 0; i < 100; ++i)
+    std::random_device rd;
+    std::default_random_engine engine(rd());
+    compress_context compression(block_format::MIN_BLOCK_SIZE_LOG2, 4);
+    decompress_context decompression;
+    block_compressor compressor(block_format::MIN_BLOCK_SIZE_LOG2, 4);
+    std::vector<int8_t> compressed;
+    std::vector<int8_t> decompressed;
+    
+    // Messages of varying sizes and alphabets must not see the leftovers of
+    // the previous ones:
+    for (int iter = 0; iter != 50; ++iter)
     {
-        ASSERT(b.get_number_of_occupied_bytes() == i);
+        std::vector<int8_t> text((size_t) engine() % 5000);
+        int alphabet = 1 + engine() % 256;
         
-        for (int j = 0; j < 8; ++j)
+        for (int8_t& c : text)
         {
-            b.append_bit(true);
-            ASSERT(i + 1 == b.get_number_of_occupied_bytes());
+            c = (int8_t)(engine() % alphabet);
         }
         
-        ASSERT(i + 1 == b.get_number_of_occupied_bytes());
+        compressed.resize(compression.compress_bound(text.size()));
+        size_t compressed_size = compression.compress(text.data(),
+                                                      text.size(),
+                                                      compressed.data(),
+                                                      compressed.size());
+        
+        std::ostringstream expected;
+        compressor.compress(text.data(), text.size(), expected);
+        ASSERT(std::string((const char*) compressed.data(), compressed_size)
+               == expected.str());
+        
+        decompressed.resize(text.size());
+        ASSERT(decompression.decompress(compressed.data(),
+                                        compressed_size,
+                                        decompressed.data(),
+                                        decompressed.size()) == text.size());
+        ASSERT(decompressed == text);
+        
+        if (iter % 10 == 9)
+        {
+            compression.reset();
+            decompression.reset();
+        }
     }
 }
 
-void test_bit_string_to_byte_array()
+void test_streaming_round_trip()
 {
-    bit_string b;
+    std::random_device rd;
+    std::default_random_engine engine(rd());
+    std::vector<int8_t> text(2 * (1 << block_format::MIN_BLOCK_SIZE_LOG2)
+                             + engine() % 1000);
     
-    for (int i = 0; i < 40; ++i)
+    for (int8_t& c : text)
     {
-        b.append_bit(i % 2 == 1);
+        c = (int8_t)(engine() % 40);
     }
     
-    for (int i = 0; i < 80; ++i)
+    // Push and pull chunks of random sizes:
+    streaming_compressor compressor(block_format::MIN_BLOCK_SIZE_LOG2, 4);
+    std::vector<int8_t> compressed;
+    int8_t chunk[4096];
+    size_t position = 0;
+    
+    while (position != text.size())
     {
-        b.append_bit(i % 2 == 0);
+        size_t length = std::min((size_t) engine() % 50000,
+                                 text.size() - position);
+        compressor.push(text.data() + position, length);
+        position += length;
+        size_t pulled = compressor.pull(chunk, engine() % sizeof(chunk));
+        compressed.insert(compressed.end(), chunk, chunk + pulled);
     }
     
-    std::vector<int8_t> bytes{b.to_byte_array()};
+    compressor.end();
     
-    for (int i = 0; i < 5; ++i)
+    while (compressor.get_available() != 0)
     {
-        ASSERT(0xaa == (uint8_t) bytes[i]);
+        size_t pulled = compressor.pull(chunk, sizeof(chunk));
+        compressed.insert(compressed.end(), chunk, chunk + pulled);
     }
     
-    for (int i = 5; i < 15; ++i)
+    std::ostringstream expected;
+    block_compressor(block_format::MIN_BLOCK_SIZE_LOG2, 4)
+        .compress(text.data(), text.size(), expected);
+    ASSERT(std::string((const char*) compressed.data(), compressed.size()) ==
+           expected.str());
+    
+    // Split the stream anywhere, down to single bytes in the middle of the
+    // block headers and the code words:
+    streaming_decompressor decompressor;
+    std::vector<int8_t> decompressed;
+    position = 0;
+    
+    while (position != compressed.size())
     {
-        ASSERT(0x55 == bytes[i]);
+        size_t length = std::min((size_t)(engine() % 3 == 0
+                                          ? 1
+                                          : engine() % 20000),
+                                 compressed.size() - position);
+        decompressor.push(compressed.data() + position, length);
+        position += length;
+        size_t pulled = decompressor.pull(chunk, engine() % sizeof(chunk));
+        decompressed.insert(decompressed.end(), chunk, chunk + pulled);
+    }
+    
+    ASSERT(decompressor.is_finished());
+    decompressor.end();
+    
+    while (decompressor.get_available() != 0)
+    {
+        size_t pulled = decompressor.pull(chunk, sizeof(chunk));
+        decompressed.insert(decompressed.end(), chunk, chunk + pulled);
+    }
+    
+    ASSERT(decompressed == text);
+    
+    // A flushed block is shorter than the block size:
+    compressor.push(text.data(), 1000);
+    compressor.flush();
+    ASSERT(compressor.get_available() != 0);
+    compressor.push(text.data() + 1000, 1000);
+    compressor.end();
+    compressed.resize(compressor.get_available());
+    compressor.pull(compressed.data(), compressed.size());
+    
+    std::istringstream in(std::string((const char*) compressed.data(),
+                                      compressed.size()));
+    std::ostringstream out;
+    block_decompressor().decompress(in, out);
+    ASSERT(out.str() == std::string((const char*) text.data(), 2000));
+    
+    // A truncated stream is reported at the end:
+    decompressor.push(compressed.data(), compressed.size() - 1);
+    bool caught = false;
+    
+    try
+    {
+        decompressor.end();
+    }
+    catch (file_format_error& error)
+    {
+        caught = true;
     }
+    
+    ASSERT(caught);
 }
 
-void test_bit_string()
+void test_decode_stream()
 {
-    test_append_bit();
-    test_append_bits_from();
-    test_read_bit();
-    test_read_bit_bad_index_throws();
-    test_read_bit_throws_on_empty_string();
-    test_remove_last_bit();
-    test_remove_last_bit_throws_on_empty_string();
-    test_bit_string_clear();
-    test_bit_string_get_number_of_occupied_bytes();
-    test_bit_string_to_byte_array();
+    std::string text;
+    
+    for (int i = 0; i != 300000; ++i)
+    {
+        text.push_back((char)('a' + i % 7 * i % 13));
+    }
+    
+    // The stream arrives in chunks as from a pipe of unknown length:
+    std::istringstream in(text);
+    std::ostringstream compressed;
+    block_compressor(block_format::MIN_BLOCK_SIZE_LOG2).compress(in,
+                                                                 compressed);
+    std::istringstream compressed_in(compressed.str());
+    std::ostringstream out;
+    coding_options options;
+    decode_stream(compressed_in, out, options);
+    ASSERT(out.str() == text);
 }
 
-std::vector<int8_t> random_text()
+void test_block_stream_range()
 {
     std::random_device rd;
     std::default_random_engine engine(rd());
-    std::uniform_int_distribution<size_t> uniform_dist_length(0, 10 * 100);
-    std::uniform_int_distribution<int8_t>
-        uniform_dist(std::numeric_limits<int8_t>::min(),
-                     std::numeric_limits<int8_t>::max());
+    std::string text(3 * (1 << block_format::MIN_BLOCK_SIZE_LOG2)
+                     + engine() % 1000, 0);
     
-    size_t len = uniform_dist_length(engine);
-    std::vector<int8_t> ret;
+    for (char& c : text)
+    {
+        c = (char)('a' + engine() % 20);
+    }
     
-    for (size_t i = 0; i != len; ++i)
+    std::istringstream in(text);
+    std::ostringstream out;
+    block_compressor(block_format::MIN_BLOCK_SIZE_LOG2).compress(in, out);
+    std::string stream = out.str();
+    
+    // The same stream without the index has its blocks found by walking:
+    block_index index;
+    block_decompressor decompressor;
+    decompressor.read_block_index((const int8_t*) stream.data(),
+                                  stream.size(),
+                                  index);
+    std::string unindexed = stream.substr(0,
+                                          index.get_end_of_blocks_offset()
+                                          + 1);
+    unindexed[5] = 0;
+    
+    for (const std::string& s : { stream, unindexed })
     {
-        ret.push_back(uniform_dist(engine));
+        for (int iter = 0; iter != 20; ++iter)
+        {
+            uint64_t offset = engine() % (text.size() + 1);
+            uint64_t length = engine() % 2 == 0
+                            ? engine() % 1000
+                            : engine() % (2 * text.size());
+            std::string expected = text.substr(offset, length);
+            
+            std::istringstream range_in(s);
+            std::ostringstream range_out;
+            ASSERT(decompressor.decompress_range(range_in,
+                                                 range_out,
+                                                 offset,
+                                                 length) == expected.size());
+            ASSERT(range_out.str() == expected);
+            
+            std::vector<int8_t> range_text(expected.size());
+            ASSERT(decompressor.decompress_range((const int8_t*) s.data(),
+                                                 s.size(),
+                                                 offset,
+                                                 length,
+                                                 range_text.data()) ==
+                   expected.size());
+            ASSERT(std::equal(range_text.begin(),
+                              range_text.end(),
+                              expected.begin()));
+        }
     }
     
-    return ret;
+    bool caught = false;
+    
+    try
+    {
+        std::istringstream range_in(stream);
+        std::ostringstream range_out;
+        decompressor.decompress_range(range_in,
+                                      range_out,
+                                      text.size() + 1,
+                                      1);
+    }
+    catch (std::out_of_range& error)
+    {
+        caught = true;
+    }
+    
+    ASSERT(caught);
 }
 
-void test_brute_force()
+void test_dictionary()
 {
-    std::vector<int8_t> text = random_text();
-    std::map<int8_t, uint32_t> count_map = compute_byte_counts(text);
-    
-    huffman_tree tree(count_map);
+    std::string corpus;
     
-    std::map<int8_t, bit_string> encoder_map = tree.infer_encoder_map();
+    for (int i = 0; i != 2000; ++i)
+    {
+        corpus += "the quick brown fox jumps over the lazy dog ";
+    }
     
-    huffman_encoder encoder;
+    huffman_dictionary trained(
+        compute_byte_histogram((const int8_t*) corpus.data(), corpus.size()));
+    std::stringstream file;
+    trained.save(file);
+    huffman_dictionary dictionary = huffman_dictionary::load(file);
+    ASSERT(dictionary.get_id() == trained.get_id());
+    ASSERT(dictionary.get_code_table() == trained.get_code_table());
+    ASSERT(dictionary.get_code_table().number_of_code_words() ==
+           code_table::NUMBER_OF_CHARACTERS);
+    
+    // A small message is smaller without its own code table:
+    std::string message = "a lazy dog and a quick fox";
+    block_compressor compressor(block_format::MIN_BLOCK_SIZE_LOG2);
+    std::ostringstream plain;
+    compressor.compress((const int8_t*) message.data(),
+                        message.size(),
+                        plain);
+    compressor.set_dictionary(&dictionary);
+    std::ostringstream coded;
+    compressor.compress((const int8_t*) message.data(),
+                        message.size(),
+                        coded);
+    ASSERT(coded.str().size() < plain.str().size());
+    ASSERT(coded.str()[block_format::STREAM_HEADER_SIZE] ==
+           block_format::DICTIONARY_HUFFMAN_BLOCK);
+    
+    block_decompressor decompressor;
+    decompressor.set_dictionary(&dictionary);
+    std::istringstream in(coded.str());
+    std::ostringstream out;
+    decompressor.decompress(in, out);
+    ASSERT(out.str() == message);
+    
+    // Text unlike the samples gets a code table of its own:
+    std::string unlike;
+    
+    for (int i = 0; i != 1000; ++i)
+    {
+        unlike += (char) (0xFE + i % 2);
+    }
     
-    bit_string text_bit_string = encoder.encode(encoder_map, text);
+    std::ostringstream unlike_coded;
+    compressor.compress((const int8_t*) unlike.data(),
+                        unlike.size(),
+                        unlike_coded);
+    ASSERT(unlike_coded.str()[block_format::STREAM_HEADER_SIZE] ==
+           block_format::HUFFMAN_BLOCK);
     
-    huffman_serializer serializer;
+    // The blocks cannot be decoded without the dictionary:
+    decompressor.set_dictionary(nullptr);
+    bool caught = false;
     
-    std::vector<int8_t> encoded_data = serializer.serialize(count_map,
-                                                            text_bit_string);
-    huffman_deserializer deserializer;
-    huffman_deserializer::result hdr = deserializer.deserialize(encoded_data);
+    try
+    {
+        std::istringstream coded_in(coded.str());
+        std::ostringstream coded_out;
+        decompressor.decompress(coded_in, coded_out);
+    }
+    catch (file_format_error& error)
+    {
+        caught = true;
+    }
     
-    huffman_tree decoder_tree(hdr.count_map);
-    huffman_decoder decoder;
+    ASSERT(caught);
     
-    ASSERT(hdr.count_map.size() == count_map.size());
+    std::string corrupt = file.str();
+    corrupt[corrupt.size() / 2] ^= 1;
+    std::istringstream corrupt_in(corrupt);
+    caught = false;
     
-    for (auto& e : hdr.count_map)
+    try
     {
-        auto iter = count_map.find(e.first);
-        ASSERT(iter != count_map.end());
-        ASSERT(e.second == iter->second);
+        huffman_dictionary::load(corrupt_in);
+    }
+    catch (file_format_error& error)
+    {
+        caught = true;
     }
     
-    ASSERT(text_bit_string.length() == hdr.encoded_text.length());
-    
-    std::vector<int8_t> recovered_text = decoder.decode(decoder_tree,
-                                                        hdr.encoded_text);
-    ASSERT(text.size() == recovered_text.size());
-    ASSERT(std::equal(text.begin(), text.end(), recovered_text.begin()));
+    ASSERT(caught);
 }
 
-void test_simple_algorithm()
+void test_adaptive_huffman()
 {
-    std::string text = "hello world";
-    std::vector<int8_t> text_vector;
+    adaptive_huffman_coder encoder;
+    adaptive_huffman_coder decoder;
+    std::vector<uint64_t> words;
     
-    for (char c : text)
+    for (int iter = 0; iter != 20; ++iter)
     {
-        text_vector.push_back((int8_t) c);
+        std::vector<int8_t> text = random_text();
+        encoder.reset();
+        decoder.reset();
+        size_t number_of_bits = encoder.encode(text.data(), text.size(), words);
+        std::vector<int8_t> decoded(text.size());
+        decoder.decode((const int8_t*) words.data(),
+                       number_of_bits,
+                       decoded.data(),
+                       decoded.size());
+        ASSERT(decoded == text);
     }
     
-    std::map<int8_t, uint32_t> count_map = compute_byte_counts(text_vector);
+    // Skewed text codes about as well as with the static code:
+    std::default_random_engine engine(21);
+    std::geometric_distribution<int> skewed(0.2);
+    std::vector<int8_t> text;
     
-    huffman_tree tree(count_map);
+    for (size_t i = 0; i != 300000; ++i)
+    {
+        text.push_back((int8_t) std::min(skewed(engine), 255));
+    }
     
-    std::map<int8_t, bit_string> encoder_map = tree.infer_encoder_map();
+    block_compressor compressor(block_format::MIN_BLOCK_SIZE_LOG2);
+    std::ostringstream static_coded;
+    compressor.compress(text.data(), text.size(), static_coded);
+    compressor.set_codec(block_compressor::codec::ADAPTIVE_HUFFMAN);
+    std::ostringstream adaptive_coded;
+    compressor.compress(text.data(), text.size(), adaptive_coded);
+    ASSERT(adaptive_coded.str()[block_format::STREAM_HEADER_SIZE] ==
+           block_format::ADAPTIVE_HUFFMAN_BLOCK);
+    ASSERT(adaptive_coded.str().size() <
+           static_coded.str().size() + static_coded.str().size() / 100);
+    
+    block_decompressor decompressor;
+    std::istringstream in(adaptive_coded.str());
+    std::ostringstream out;
+    decompressor.decompress(in, out);
+    ASSERT(out.str() == std::string(text.begin(), text.end()));
+    
+    // A truncated code is rejected:
+    bool caught = false;
     
-    huffman_encoder encoder;
+    try
+    {
+        std::vector<int8_t> decoded(text.size());
+        decoder.reset();
+        encoder.reset();
+        size_t number_of_bits = encoder.encode(text.data(), 1000, words);
+        decoder.decode((const int8_t*) words.data(),
+                       number_of_bits - 1,
+                       decoded.data(),
+                       1000);
+    }
+    catch (file_format_error& error)
+    {
+        caught = true;
+    }
     
-    bit_string text_bit_string = encoder.encode(encoder_map, text_vector);
+    ASSERT(caught);
+}
+
+void test_block_stream_fallbacks()
+{
+    std::default_random_engine engine(22);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<int8_t> noise;
     
-    huffman_serializer serializer;
+    for (size_t i = 0; i != 200000; ++i)
+    {
+        noise.push_back((int8_t) byte(engine));
+    }
     
-    std::vector<int8_t> encoded_text = serializer.serialize(count_map,
-                                                            text_bit_string);
+    std::vector<int8_t> run(300000, 'z');
+    block_compressor compressor(block_format::MIN_BLOCK_SIZE_LOG2);
+    block_decompressor decompressor;
+    
+    // Incompressible text is stored and a repeated character takes a byte:
+    std::ostringstream stored;
+    compressor.compress(noise.data(), noise.size(), stored);
+    ASSERT(stored.str()[block_format::STREAM_HEADER_SIZE] ==
+           block_format::STORED_BLOCK);
+    ASSERT(stored.str().size() < noise.size() + 64);
+    
+    std::ostringstream repeated;
+    compressor.compress(run.data(), run.size(), repeated);
+    ASSERT(repeated.str()[block_format::STREAM_HEADER_SIZE] ==
+           block_format::RUN_BLOCK);
+    ASSERT(repeated.str().size() < 64);
+    
+    std::istringstream stored_in(stored.str());
+    std::ostringstream stored_out;
+    decompressor.decompress(stored_in, stored_out);
+    ASSERT(stored_out.str() == std::string(noise.begin(), noise.end()));
+    
+    std::istringstream repeated_in(repeated.str());
+    std::ostringstream repeated_out;
+    decompressor.decompress(repeated_in, repeated_out);
+    ASSERT(repeated_out.str() == std::string(run.begin(), run.end()));
+    
+    // The adaptive codec falls back in the same way:
+    compressor.set_codec(block_compressor::codec::ADAPTIVE_HUFFMAN);
+    std::ostringstream adaptive_stored;
+    compressor.compress(noise.data(), noise.size(), adaptive_stored);
+    ASSERT(adaptive_stored.str() == stored.str());
+    
+    std::ostringstream adaptive_repeated;
+    compressor.compress(run.data(), run.size(), adaptive_repeated);
+    ASSERT(adaptive_repeated.str() == repeated.str());
+}
+
+void test_context_tables()
+{
+    // Digits follow letters and letters follow digits:
+    std::default_random_engine engine(23);
+    std::uniform_int_distribution<int> letter(0, 15);
+    std::uniform_int_distribution<int> digit(0, 9);
+    std::vector<int8_t> text;
     
-    huffman_deserializer deserializer;
+    for (size_t i = 0; i != 100000; ++i)
+    {
+        text.push_back((int8_t) ('a' + letter(engine)));
+        text.push_back((int8_t) ('0' + digit(engine)));
+    }
     
-    huffman_deserializer::result hdr = deserializer.deserialize(encoded_text);
+    block_compressor compressor(block_format::MIN_BLOCK_SIZE_LOG2);
+    std::ostringstream plain;
+    compressor.compress(text.data(), text.size(), plain);
+    compressor.set_codec(block_compressor::codec::CONTEXT_HUFFMAN);
+    std::ostringstream coded;
+    compressor.compress(text.data(), text.size(), coded);
+    ASSERT(coded.str()[block_format::STREAM_HEADER_SIZE] ==
+           block_format::CONTEXT_HUFFMAN_BLOCK);
+    ASSERT(coded.str().size() < plain.str().size() * 9 / 10);
+    
+    block_decompressor decompressor;
+    std::istringstream in(coded.str());
+    std::ostringstream out;
+    decompressor.decompress(in, out);
+    ASSERT(out.str() == std::string(text.begin(), text.end()));
+    
+    // Text without order-1 structure keeps the single table:
+    std::vector<int8_t> noise = random_text();
+    noise.push_back('x');
+    std::ostringstream noise_coded;
+    compressor.compress(noise.data(), noise.size(), noise_coded);
+    ASSERT(noise_coded.str()[block_format::STREAM_HEADER_SIZE] !=
+           block_format::CONTEXT_HUFFMAN_BLOCK);
+}
+
+void test_lz77()
+{
+    for (uint32_t value : { 0u, 1u, 3u, 4u, 5u, 7u, 8u, 1000u, 65535u,
+                            4194304u, 4294967295u })
+    {
+        uint32_t extra_bits;
+        size_t number_of_extra_bits;
+        uint8_t code = lz77_value_code(value, extra_bits, number_of_extra_bits);
+        size_t number_of_base_extra_bits;
+        ASSERT(code < LZ77_NUMBER_OF_VALUE_CODES);
+        ASSERT(lz77_code_base(code, number_of_base_extra_bits) + extra_bits ==
+               value);
+        ASSERT(number_of_base_extra_bits == number_of_extra_bits);
+    }
     
-    huffman_tree decoder_tree(hdr.count_map);
-    huffman_decoder decoder;
+    // Log lines repeat most of their text, and a run overlaps its match:
+    std::default_random_engine engine(24);
+    std::uniform_int_distribution<int> id(0, 999);
+    std::string log;
     
-    std::vector<int8_t> recovered_text = decoder.decode(decoder_tree,
-                                                        hdr.encoded_text);
-    ASSERT(text.size() == recovered_text.size());
-    ASSERT(std::equal(text.begin(), text.end(), recovered_text.begin()));
+    for (int i = 0; i != 5000; ++i)
+    {
+        log += "{\"level\":\"info\",\"id\":" + std::to_string(id(engine))
+             + ",\"message\":\"request served\"}\n";
+    }
+    
+    log += std::string(1000, '=') + "abcabcabcabcabcabc";
+    
+    for (size_t level = lz77_matcher::MIN_LEVEL;
+         level <= lz77_matcher::MAX_LEVEL;
+         level += 4)
+    {
+        lz77_matcher matcher(level);
+        std::vector<lz77_sequence> sequences;
+        matcher.parse((const int8_t*) log.data(), log.size(), sequences);
+        std::string replayed;
+        size_t position = 0;
+        
+        for (const lz77_sequence& sequence : sequences)
+        {
+            replayed += log.substr(position, sequence.literal_length);
+            position += sequence.literal_length;
+            
+            for (size_t i = 0; i != sequence.match_length; ++i)
+            {
+                replayed += replayed[replayed.size() - sequence.distance];
+            }
+            
+            position += sequence.match_length;
+        }
+        
+        ASSERT(replayed == log);
+        ASSERT(sequences.back().match_length == 0);
+    }
+    
+    block_compressor compressor(block_format::MIN_BLOCK_SIZE_LOG2);
+    std::ostringstream plain;
+    compressor.compress((const int8_t*) log.data(), log.size(), plain);
+    compressor.set_codec(block_compressor::codec::LZ77_HUFFMAN);
+    std::ostringstream coded;
+    compressor.compress((const int8_t*) log.data(), log.size(), coded);
+    ASSERT(coded.str()[block_format::STREAM_HEADER_SIZE] ==
+           block_format::LZ77_HUFFMAN_BLOCK);
+    ASSERT(coded.str().size() < plain.str().size() / 2);
+    
+    block_decompressor decompressor;
+    std::istringstream in(coded.str());
+    std::ostringstream out;
+    decompressor.decompress(in, out);
+    ASSERT(out.str() == log);
+    
+    // Text without repeats keeps the single table:
+    std::vector<int8_t> noise = random_text();
+    noise.push_back('x');
+    std::ostringstream noise_coded;
+    compressor.compress(noise.data(), noise.size(), noise_coded);
+    ASSERT(noise_coded.str()[block_format::STREAM_HEADER_SIZE] !=
+           block_format::LZ77_HUFFMAN_BLOCK);
 }
 
-void test_one_byte_text()
+void test_batch()
 {
-    std::vector<int8_t> text = { 0x01, 0x01 };
-    std::map<int8_t, uint32_t> count_map = compute_byte_counts(text);
-    huffman_tree tree(count_map);
-    std::map<int8_t, bit_string> encoder_map = tree.infer_encoder_map();
-    huffman_encoder encoder;
-    bit_string text_bit_string = encoder.encode(encoder_map, text);
-    huffman_serializer serializer;
-    std::vector<int8_t> serialized_text = serializer.serialize(count_map,
-                                                               text_bit_string);
-    huffman_deserializer deserializer;
-    huffman_deserializer::result hdr =
-        deserializer.deserialize(serialized_text);
+    std::default_random_engine engine(25);
+    size_t block_size = (size_t) 1 << block_format::DEFAULT_BLOCK_SIZE_LOG2;
+    const size_t lengths[] = { 0, 1, 700, 5000, 3 * block_size / 2 };
+    std::vector<std::vector<int8_t>> texts;
+    std::vector<std::string> files;
+    
+    for (size_t i = 0; i != sizeof(lengths) / sizeof(lengths[0]); ++i)
+    {
+        std::vector<int8_t> text(lengths[i]);
+        
+        for (int8_t& c : text)
+        {
+            c = (int8_t)('a' + engine() % (i + 3));
+        }
+        
+        std::string file_name = "batch_test_" + std::to_string(i) + ".txt";
+        file_write(file_name, text);
+        texts.push_back(text);
+        files.push_back(file_name);
+    }
     
-    huffman_tree decoder_tree(hdr.count_map);
+    coding_options options;
+    options.number_of_threads = 3;
     
-    huffman_decoder decoder;
+    // A missing file is reported without stopping the rest:
+    std::vector<std::string> sources = files;
+    sources.push_back("batch_test_missing.txt");
+    ASSERT(do_batch(true, sources, options) == 1);
     
-    std::vector<int8_t> recovered_text = decoder.decode(decoder_tree,
-                                                        hdr.encoded_text);
-    ASSERT(recovered_text.size() == 2);
-    ASSERT(recovered_text[0] = 0x1);
-    ASSERT(recovered_text[1] = 0x1);
+    std::vector<std::string> encoded_files;
+    
+    for (std::string& file_name : files)
+    {
+        std::remove(file_name.c_str());
+        encoded_files.push_back(file_name + "." + ENCODED_FILE_EXTENSION);
+    }
+    
+    ASSERT(do_batch(false, encoded_files, options) == 0);
+    
+    for (size_t i = 0; i != files.size(); ++i)
+    {
+        ASSERT(file_read(files[i]) == texts[i]);
+        std::remove(files[i].c_str());
+        std::remove(encoded_files[i].c_str());
+    }
 }
 
 void test_algorithms()
 {
     test_simple_algorithm();
     test_one_byte_text();
+    test_decode_table_long_code_words();
+    test_canonical_code_words();
+    test_v2_header_size();
+    test_block_stream_round_trip();
+    test_block_stream_empty_input();
+    test_thread_pool();
+    test_parallel_compression_is_deterministic();
+    test_parallel_decompression();
+    test_block_stream_interleaved();
+    test_length_limited_code();
+    test_block_stream_length_limit();
+    test_minimum_redundancy_code_deep();
+    test_pipeline_statistics();
+    test_block_stream_in_memory();
+    test_block_stream_caller_buffers();
+    test_contexts();
+    test_streaming_round_trip();
+    test_decode_stream();
+    test_block_stream_range();
+    test_dictionary();
+    test_adaptive_huffman();
+    test_block_stream_fallbacks();
+    test_context_tables();
+    test_lz77();
+    test_batch();
     
     for (int iter = 0; iter != 100; ++iter)
     {
         test_brute_force();
+        test_decode_table_matches_tree_walk();
+        test_canonical_brute_force();
+        test_encoder_matches_bitwise_append();
+        test_byte_histogram_matches_reference();
+        test_interleaved_streams();
+        test_minimum_redundancy_code();
     }
 }
 
@@ -0,0 +1,218 @@
+#include "mapped_file.hpp"
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+mapped_input_file::mapped_input_file(const std::string& file_name)
+:
+    file_descriptor{-1},
+    mapping{nullptr},
+    mapping_size{0},
+    mapped{false}
+{
+#ifndef _WIN32
+    struct stat file_status;
+    
+    if (stat(file_name.c_str(), &file_status) != 0)
+    {
+        throw std::runtime_error{"Could not open the file " + file_name};
+    }
+    
+    // Leave a pipe alone, since opening it here would consume its data:
+    if (!S_ISREG(file_status.st_mode))
+    {
+        return;
+    }
+    
+    file_descriptor = open(file_name.c_str(), O_RDONLY);
+    
+    if (file_descriptor == -1 || fstat(file_descriptor, &file_status) != 0)
+    {
+        throw std::runtime_error{"Could not open the file " + file_name};
+    }
+    
+    mapping_size = (size_t) file_status.st_size;
+    
+    if (mapping_size == 0)
+    {
+        // There is nothing to map, yet the empty contents are known:
+        mapped = true;
+        return;
+    }
+    
+    void* address = mmap(nullptr,
+                         mapping_size,
+                         PROT_READ,
+                         MAP_PRIVATE,
+                         file_descriptor,
+                         0);
+    
+    if (address == MAP_FAILED)
+    {
+        mapping_size = 0;
+        return;
+    }
+    
+    // The codec walks the input front to back:
+    madvise(address, mapping_size, MADV_SEQUENTIAL);
+    mapping = address;
+    mapped = true;
+#endif
+}
+
+mapped_input_file::~mapped_input_file()
+{
+#ifndef _WIN32
+    if (mapping != nullptr)
+    {
+        munmap(mapping, mapping_size);
+    }
+    
+    if (file_descriptor != -1)
+    {
+        close(file_descriptor);
+    }
+#endif
+}
+
+bool mapped_input_file::is_mapped() const
+{
+    return mapped;
+}
+
+const int8_t* mapped_input_file::data() const
+{
+    return (const int8_t*) mapping;
+}
+
+size_t mapped_input_file::size() const
+{
+    return mapping_size;
+}
+
+mapped_output_file::mapped_output_file(const std::string& file_name,
+                                       size_t size)
+:
+    file_name{file_name},
+    file_descriptor{-1},
+    mapping{nullptr},
+    mapping_size{0},
+    mapped{false}
+{
+#ifndef _WIN32
+    struct stat file_status;
+    
+    // Leave a pipe or a device to the buffered output:
+    if (stat(file_name.c_str(), &file_status) == 0 &&
+        !S_ISREG(file_status.st_mode))
+    {
+        return;
+    }
+    
+    file_descriptor = open(file_name.c_str(),
+                           O_RDWR | O_CREAT | O_TRUNC,
+                           0666);
+    
+    if (file_descriptor == -1)
+    {
+        throw std::runtime_error{"Could not create the file " + file_name};
+    }
+    
+    if (ftruncate(file_descriptor, (off_t) size) != 0)
+    {
+        return;
+    }
+    
+#ifndef __APPLE__
+    // A sparse file would get its pages only when they are written through
+    // the mapping, where a full disk raises SIGBUS instead of an error:
+    if (size != 0 && posix_fallocate(file_descriptor, 0, (off_t) size) != 0)
+    {
+        discard();
+        throw std::runtime_error{"Could not reserve the space for the file "
+                                 + file_name};
+    }
+#endif
+    
+    mapping_size = size;
+    
+    if (size == 0)
+    {
+        mapped = true;
+        return;
+    }
+    
+    void* address = mmap(nullptr,
+                         size,
+                         PROT_READ | PROT_WRITE,
+                         MAP_SHARED,
+                         file_descriptor,
+                         0);
+    
+    if (address == MAP_FAILED)
+    {
+        mapping_size = 0;
+        return;
+    }
+    
+    mapping = address;
+    mapped = true;
+#endif
+}
+
+mapped_output_file::~mapped_output_file()
+{
+#ifndef _WIN32
+    if (mapping != nullptr)
+    {
+        munmap(mapping, mapping_size);
+    }
+    
+    if (file_descriptor != -1)
+    {
+        close(file_descriptor);
+    }
+#endif
+}
+
+bool mapped_output_file::is_mapped() const
+{
+    return mapped;
+}
+
+void mapped_output_file::discard()
+{
+#ifndef _WIN32
+    if (mapping != nullptr)
+    {
+        munmap(mapping, mapping_size);
+        mapping = nullptr;
+    }
+    
+    // Only the file created here is removed, never a pipe or a device:
+    if (file_descriptor != -1)
+    {
+        close(file_descriptor);
+        file_descriptor = -1;
+        unlink(file_name.c_str());
+    }
+#endif
+    
+    mapping_size = 0;
+    mapped = false;
+}
+
+int8_t* mapped_output_file::data()
+{
+    return (int8_t*) mapping;
+}
+
+size_t mapped_output_file::size() const
+{
+    return mapping_size;
+}
@@ -0,0 +1,111 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstdint>
+#include <string>
+
+/**************************************************************************
+* A file mapped read-only into memory. Only regular files are mapped; for *
+* pipes, terminals and on the platforms without 'mmap' the file stays     *
+* unmapped and the caller falls back to the buffered stream I/O.          *
+**************************************************************************/
+class mapped_input_file {
+public:
+    
+    /**********************************************************************
+    * Maps the whole file 'file_name'. Throws 'std::runtime_error' if the *
+    * file cannot be opened.                                              *
+    **********************************************************************/
+    explicit mapped_input_file(const std::string& file_name);
+    
+    ~mapped_input_file();
+    
+    mapped_input_file(const mapped_input_file&) = delete;
+    mapped_input_file& operator=(const mapped_input_file&) = delete;
+    
+    /******************************************************************
+    * Returns true if the file contents are available through 'data'. *
+    ******************************************************************/
+    bool is_mapped() const;
+    
+    /*********************************************
+    * Returns the first byte of the mapped file. *
+    *********************************************/
+    const int8_t* data() const;
+    
+    /**************************************************
+    * Returns the length of the mapped file in bytes. *
+    **************************************************/
+    size_t size() const;
+    
+private:
+    
+    // The file descriptor, or -1:
+    int file_descriptor;
+    
+    // The mapping, or null if the file is empty or unmapped:
+    void* mapping;
+    
+    size_t mapping_size;
+    bool mapped;
+};
+
+/*****************************************************************************
+* A file of a size known in advance written through a writable shared        *
+* mapping, so that the data is produced right in the page cache. The file is *
+* created or truncated and then extended to its final size.                  *
+*****************************************************************************/
+class mapped_output_file {
+public:
+    
+    /************************************************************************
+    * Creates the file 'file_name' holding 'size' bytes and maps it. Throws *
+    * 'std::runtime_error' if the file cannot be created or the disk cannot *
+    * hold it. Stays unmapped if the file is not a regular one.             *
+    ************************************************************************/
+    mapped_output_file(const std::string& file_name, size_t size);
+    
+    /******************************************************************
+    * Unmaps the file, which keeps all the bytes written into 'data'. *
+    ******************************************************************/
+    ~mapped_output_file();
+    
+    mapped_output_file(const mapped_output_file&) = delete;
+    mapped_output_file& operator=(const mapped_output_file&) = delete;
+    
+    /**********************************************************
+    * Returns true if the file can be written through 'data'. *
+    **********************************************************/
+    bool is_mapped() const;
+    
+    /********************************************************************
+    * Unmaps and removes the file created by the constructor, so that a *
+    * failed job leaves no partly written file behind.                  *
+    ********************************************************************/
+    void discard();
+    
+    /*********************************************
+    * Returns the first byte of the mapped file. *
+    *********************************************/
+    int8_t* data();
+    
+    /**************************************************
+    * Returns the length of the mapped file in bytes. *
+    **************************************************/
+    size_t size() const;
+    
+private:
+    
+    std::string file_name;
+    
+    // The file descriptor, or -1:
+    int file_descriptor;
+    
+    // The mapping, or null if the file is empty or unmapped:
+    void* mapping;
+    
+    size_t mapping_size;
+    bool mapped;
+};
+
+#endif // MAPPED_FILE_HPP
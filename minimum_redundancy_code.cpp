@@ -0,0 +1,131 @@
+#include "canonical_code.hpp"
+#include "minimum_redundancy_code.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+// Replaces the 'n' ascending weights in 'a' with the optimal code word
+// lengths. The first phase turns the array into the internal node weights
+// and parent pointers, the second into the internal node depths and the
+// third into the leaf depths:
+static void compute_code_lengths(uint64_t* a, size_t n)
+{
+    size_t root = 0;
+    size_t leaf = 2;
+    a[0] += a[1];
+    
+    for (size_t next = 1; next < n - 1; ++next)
+    {
+        // The first child is the lighter of the next leaf and the next
+        // internal node:
+        if (leaf >= n || a[root] < a[leaf])
+        {
+            a[next] = a[root];
+            a[root++] = next;
+        }
+        else
+        {
+            a[next] = a[leaf++];
+        }
+        
+        // So is the second one:
+        if (leaf >= n || (root < next && a[root] < a[leaf]))
+        {
+            a[next] += a[root];
+            a[root++] = next;
+        }
+        else
+        {
+            a[next] += a[leaf++];
+        }
+    }
+    
+    a[n - 2] = 0;
+    
+    for (size_t next = n - 2; next-- != 0; )
+    {
+        a[next] = a[a[next]] + 1;
+    }
+    
+    size_t available = 1;
+    size_t used = 0;
+    uint64_t depth = 0;
+    size_t next = n;
+    root = n - 1;
+    
+    while (available > 0)
+    {
+        // Count the internal nodes at the current depth:
+        while (root != 0 && a[root - 1] == depth)
+        {
+            ++used;
+            --root;
+        }
+        
+        // The remaining nodes at this depth are leaves:
+        while (available > used)
+        {
+            a[--next] = depth;
+            --available;
+        }
+        
+        available = 2 * used;
+        ++depth;
+        used = 0;
+    }
+}
+
+code_table build_minimum_redundancy_code(const histogram& counts)
+{
+    // The weight and the unsigned character value packed in one word, so
+    // that sorting the words sorts by the weight and breaks the ties by the
+    // character:
+    uint64_t keys[histogram::NUMBER_OF_CHARACTERS];
+    uint64_t lengths[histogram::NUMBER_OF_CHARACTERS];
+    size_t n = 0;
+    
+    for (size_t value = 0; value != histogram::NUMBER_OF_CHARACTERS; ++value)
+    {
+        uint32_t count = counts.get_count((int8_t) value);
+        
+        if (count != 0)
+        {
+            keys[n++] = (uint64_t) count << 8 | value;
+        }
+    }
+    
+    code_table table;
+    
+    if (n == 0)
+    {
+        return table;
+    }
+    
+    if (n == 1)
+    {
+        table.set_code_word((int8_t) keys[0], 0, 1);
+        return table;
+    }
+    
+    std::sort(keys, keys + n);
+    
+    for (size_t i = 0; i != n; ++i)
+    {
+        lengths[i] = keys[i] >> 8;
+    }
+    
+    compute_code_lengths(lengths, n);
+    
+    // The lightest character has the longest code word:
+    if (lengths[0] > code_table::MAX_CODE_WORD_LENGTH)
+    {
+        throw std::runtime_error{"The code words are too long."};
+    }
+    
+    for (size_t i = 0; i != n; ++i)
+    {
+        table.set_code_word((int8_t) keys[i], 0, lengths[i]);
+    }
+    
+    assign_canonical_code_words(table);
+    return table;
+}
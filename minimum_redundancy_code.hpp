@@ -0,0 +1,18 @@
+#ifndef MINIMUM_REDUNDANCY_CODE_HPP
+#define MINIMUM_REDUNDANCY_CODE_HPP
+
+#include "code_table.hpp"
+#include "histogram.hpp"
+#include <cstdint>
+
+/******************************************************************************
+* Builds the canonical Huffman code of the characters counted in 'counts'.    *
+* The code word lengths are computed in place in a fixed array of the sorted  *
+* counts with the algorithm of Moffat and Katajainen, so no tree is built and *
+* nothing is allocated on the heap. A lone character gets a code word of      *
+* length one. Throws 'std::runtime_error' if some code word would exceed      *
+* 'code_table::MAX_CODE_WORD_LENGTH' bits.                                    *
+******************************************************************************/
+code_table build_minimum_redundancy_code(const histogram& counts);
+
+#endif // MINIMUM_REDUNDANCY_CODE_HPP
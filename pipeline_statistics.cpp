@@ -0,0 +1,287 @@
+#include "pipeline_statistics.hpp"
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <iomanip>
+
+static const char* STAGE_NAMES[pipeline_statistics::NUMBER_OF_STAGES] = {
+    "read",
+    "match",
+    "count",
+    "build_code",
+    "encode",
+    "serialize",
+    "build_decode_table",
+    "decode",
+    "write"
+};
+
+pipeline_statistics::stage_timer::stage_timer(pipeline_statistics* statistics,
+                                              stage s,
+                                              uint64_t number_of_bytes)
+:
+    statistics{statistics},
+    s{s},
+    number_of_bytes{number_of_bytes},
+    start_wall_ns{0},
+    start_cpu_ns{0}
+{
+    if (statistics != nullptr)
+    {
+        start_wall_ns = wall_clock_ns();
+        start_cpu_ns = thread_cpu_clock_ns();
+    }
+}
+
+pipeline_statistics::stage_timer::~stage_timer()
+{
+    stop();
+}
+
+void pipeline_statistics::stage_timer::stop()
+{
+    if (statistics != nullptr)
+    {
+        statistics->add_stage_time(s,
+                                   wall_clock_ns() - start_wall_ns,
+                                   thread_cpu_clock_ns() - start_cpu_ns,
+                                   number_of_bytes);
+        statistics = nullptr;
+    }
+}
+
+void pipeline_statistics::stage_timer::set_number_of_bytes(
+                                                    uint64_t number_of_bytes)
+{
+    this->number_of_bytes = number_of_bytes;
+}
+
+pipeline_statistics::pipeline_statistics()
+:
+    number_of_uncompressed_bytes{0},
+    number_of_compressed_bytes{0},
+    number_of_encoded_bits{0},
+    start_wall_ns{wall_clock_ns()},
+    start_cpu_ns{process_cpu_clock_ns()},
+    job_wall_ns{0},
+    job_cpu_ns{0}
+{
+    for (stage_totals& totals : stages)
+    {
+        totals.wall_ns = 0;
+        totals.cpu_ns = 0;
+        totals.number_of_bytes = 0;
+    }
+    
+    for (std::atomic<uint64_t>& count : counts)
+    {
+        count = 0;
+    }
+}
+
+uint64_t pipeline_statistics::wall_clock_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t pipeline_statistics::thread_cpu_clock_ns()
+{
+#ifdef _WIN32
+    return process_cpu_clock_ns();
+#else
+    timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+#endif
+}
+
+uint64_t pipeline_statistics::process_cpu_clock_ns()
+{
+#ifdef _WIN32
+    return (uint64_t) std::clock() * 1000000000 / CLOCKS_PER_SEC;
+#else
+    timespec time;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+#endif
+}
+
+void pipeline_statistics::add_stage_time(stage s,
+                                         uint64_t wall_ns,
+                                         uint64_t cpu_ns,
+                                         uint64_t number_of_bytes)
+{
+    stages[s].wall_ns += wall_ns;
+    stages[s].cpu_ns += cpu_ns;
+    stages[s].number_of_bytes += number_of_bytes;
+}
+
+void pipeline_statistics::add_counts(const histogram& block_counts)
+{
+    for (size_t value = 0; value != histogram::NUMBER_OF_CHARACTERS; ++value)
+    {
+        uint32_t count = block_counts.get_count((int8_t) value);
+        
+        if (count != 0)
+        {
+            counts[value] += count;
+        }
+    }
+}
+
+void pipeline_statistics::add_uncompressed_bytes(uint64_t number_of_bytes)
+{
+    number_of_uncompressed_bytes += number_of_bytes;
+}
+
+void pipeline_statistics::add_compressed_bytes(uint64_t number_of_bytes)
+{
+    number_of_compressed_bytes += number_of_bytes;
+}
+
+void pipeline_statistics::add_encoded_bits(uint64_t number_of_bits)
+{
+    number_of_encoded_bits += number_of_bits;
+}
+
+void pipeline_statistics::finish()
+{
+    job_wall_ns = wall_clock_ns() - start_wall_ns;
+    job_cpu_ns = process_cpu_clock_ns() - start_cpu_ns;
+}
+
+double pipeline_statistics::compute_entropy() const
+{
+    uint64_t total_count = 0;
+    
+    for (const std::atomic<uint64_t>& count : counts)
+    {
+        total_count += count;
+    }
+    
+    double entropy = 0.0;
+    
+    for (const std::atomic<uint64_t>& count : counts)
+    {
+        if (count != 0)
+        {
+            double probability = (double) count / total_count;
+            entropy -= probability * std::log2(probability);
+        }
+    }
+    
+    return entropy;
+}
+
+double pipeline_statistics::compute_average_code_length() const
+{
+    if (number_of_uncompressed_bytes == 0)
+    {
+        return 0.0;
+    }
+    
+    return (double) number_of_encoded_bits / number_of_uncompressed_bytes;
+}
+
+double pipeline_statistics::compute_ratio() const
+{
+    if (number_of_compressed_bytes == 0)
+    {
+        return 0.0;
+    }
+    
+    return (double) number_of_uncompressed_bytes / number_of_compressed_bytes;
+}
+
+double pipeline_statistics::compute_throughput(stage s) const
+{
+    if (stages[s].wall_ns == 0)
+    {
+        return 0.0;
+    }
+    
+    return 1e3 * stages[s].number_of_bytes / stages[s].wall_ns;
+}
+
+const char* pipeline_statistics::get_stage_name(stage s)
+{
+    return STAGE_NAMES[s];
+}
+
+void pipeline_statistics::print_text(std::ostream& out) const
+{
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(3);
+    out << std::left << std::setw(20) << "stage" << std::right
+        << std::setw(12) << "wall ms"
+        << std::setw(12) << "cpu ms"
+        << std::setw(12) << "MB/s" << "\n";
+    
+    for (size_t i = 0; i != NUMBER_OF_STAGES; ++i)
+    {
+        stage s = (stage) i;
+        
+        if (stages[s].wall_ns == 0 && stages[s].number_of_bytes == 0)
+        {
+            continue;
+        }
+        
+        out << std::left << std::setw(20) << get_stage_name(s) << std::right
+            << std::setw(12) << stages[s].wall_ns / 1e6
+            << std::setw(12) << stages[s].cpu_ns / 1e6
+            << std::setw(12) << compute_throughput(s) << "\n";
+    }
+    
+    out << std::left << std::setw(20) << "total" << std::right
+        << std::setw(12) << job_wall_ns / 1e6
+        << std::setw(12) << job_cpu_ns / 1e6 << "\n";
+    
+    out << "uncompressed size:   " << number_of_uncompressed_bytes
+        << " bytes\n";
+    out << "compressed size:     " << number_of_compressed_bytes
+        << " bytes\n";
+    out << "ratio:               " << compute_ratio() << "\n";
+    out << "entropy:             " << compute_entropy()
+        << " bits per character\n";
+    out << "average code length: " << compute_average_code_length()
+        << " bits per character\n";
+    out.flags(flags);
+}
+
+void pipeline_statistics::print_json(std::ostream& out) const
+{
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(6);
+    out << "{\"stages\":{";
+    bool first = true;
+    
+    for (size_t i = 0; i != NUMBER_OF_STAGES; ++i)
+    {
+        stage s = (stage) i;
+        
+        if (stages[s].wall_ns == 0 && stages[s].number_of_bytes == 0)
+        {
+            continue;
+        }
+        
+        out << (first ? "" : ",")
+            << "\"" << get_stage_name(s) << "\":{"
+            << "\"wall_seconds\":" << stages[s].wall_ns / 1e9 << ","
+            << "\"cpu_seconds\":" << stages[s].cpu_ns / 1e9 << ","
+            << "\"bytes\":" << stages[s].number_of_bytes << ","
+            << "\"megabytes_per_second\":" << compute_throughput(s) << "}";
+        first = false;
+    }
+    
+    out << "},"
+        << "\"wall_seconds\":" << job_wall_ns / 1e9 << ","
+        << "\"cpu_seconds\":" << job_cpu_ns / 1e9 << ","
+        << "\"uncompressed_bytes\":" << number_of_uncompressed_bytes << ","
+        << "\"compressed_bytes\":" << number_of_compressed_bytes << ","
+        << "\"ratio\":" << compute_ratio() << ","
+        << "\"entropy_bits_per_character\":" << compute_entropy() << ","
+        << "\"average_code_length_bits\":" << compute_average_code_length()
+        << "}\n";
+    out.flags(flags);
+}
@@ -0,0 +1,167 @@
+#ifndef PIPELINE_STATISTICS_HPP
+#define PIPELINE_STATISTICS_HPP
+
+#include "histogram.hpp"
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+/****************************************************************************
+* Collects the time spent in each stage of a compression or decompression   *
+* job together with the sizes and the statistics of the coded text. All the *
+* methods adding to the statistics may be called from several threads.      *
+****************************************************************************/
+class pipeline_statistics {
+public:
+    
+    enum stage {
+        READ,
+        MATCH,
+        COUNT,
+        BUILD_CODE,
+        ENCODE,
+        SERIALIZE,
+        BUILD_DECODE_TABLE,
+        DECODE,
+        WRITE,
+        NUMBER_OF_STAGES
+    };
+    
+    /********************************************************************
+    * Measures the wall and the CPU time of the calling thread from the *
+    * construction to the destruction and adds them to the stage. Does  *
+    * nothing if 'statistics' is null.                                  *
+    ********************************************************************/
+    class stage_timer {
+    public:
+        
+        stage_timer(pipeline_statistics* statistics,
+                    stage s,
+                    uint64_t number_of_bytes);
+        
+        ~stage_timer();
+        
+        /*********************************************************************
+        * Adds the time measured so far to the stage before the destruction. *
+        *********************************************************************/
+        void stop();
+        
+        /*********************************************************************
+        * Sets the number of the bytes processed when it is only known after *
+        * the stage has run.                                                 *
+        *********************************************************************/
+        void set_number_of_bytes(uint64_t number_of_bytes);
+        
+        stage_timer(const stage_timer&) = delete;
+        stage_timer& operator=(const stage_timer&) = delete;
+        
+    private:
+        
+        pipeline_statistics* statistics;
+        stage s;
+        uint64_t number_of_bytes;
+        uint64_t start_wall_ns;
+        uint64_t start_cpu_ns;
+    };
+    
+    /**************************************
+    * Starts the clocks of the whole job. *
+    **************************************/
+    pipeline_statistics();
+    
+    /********************************************************************
+    * Adds the time spent in the stage 's' processing 'number_of_bytes' *
+    * bytes.                                                            *
+    ********************************************************************/
+    void add_stage_time(stage s,
+                        uint64_t wall_ns,
+                        uint64_t cpu_ns,
+                        uint64_t number_of_bytes);
+    
+    /**********************************************
+    * Adds the character counts of a coded block. *
+    **********************************************/
+    void add_counts(const histogram& counts);
+    
+    /*****************************************************************
+    * Adds to the sizes of the uncompressed and the compressed data. *
+    *****************************************************************/
+    void add_uncompressed_bytes(uint64_t number_of_bytes);
+    void add_compressed_bytes(uint64_t number_of_bytes);
+    
+    /******************************************************
+    * Adds to the number of the bits the code words take. *
+    ******************************************************/
+    void add_encoded_bits(uint64_t number_of_bits);
+    
+    /*************************************
+    * Stops the clocks of the whole job. *
+    *************************************/
+    void finish();
+    
+    /***************************************************
+    * Prints the statistics as a human-readable table. *
+    ***************************************************/
+    void print_text(std::ostream& out) const;
+    
+    /******************************************
+    * Prints the statistics as a JSON object. *
+    ******************************************/
+    void print_json(std::ostream& out) const;
+    
+    /*************************************************************************
+    * Returns the Shannon entropy of the added counts in bits per character. *
+    *************************************************************************/
+    double compute_entropy() const;
+    
+    /**************************************************************
+    * Returns the average code word length in bits per character. *
+    **************************************************************/
+    double compute_average_code_length() const;
+    
+    /****************************************************************
+    * Returns the uncompressed size divided by the compressed size. *
+    ****************************************************************/
+    double compute_ratio() const;
+    
+    /*************************************
+    * Returns the name of the stage 's'. *
+    *************************************/
+    static const char* get_stage_name(stage s);
+    
+    /**************************************************************************
+    * Returns the monotonic wall clock and the CPU time of the calling thread *
+    * in nanoseconds.                                                         *
+    **************************************************************************/
+    static uint64_t wall_clock_ns();
+    static uint64_t thread_cpu_clock_ns();
+    
+private:
+    
+    // The totals of a single stage over all the threads:
+    struct stage_totals {
+        std::atomic<uint64_t> wall_ns;
+        std::atomic<uint64_t> cpu_ns;
+        std::atomic<uint64_t> number_of_bytes;
+    };
+    
+    stage_totals stages[NUMBER_OF_STAGES];
+    std::atomic<uint64_t> counts[histogram::NUMBER_OF_CHARACTERS];
+    std::atomic<uint64_t> number_of_uncompressed_bytes;
+    std::atomic<uint64_t> number_of_compressed_bytes;
+    std::atomic<uint64_t> number_of_encoded_bits;
+    
+    // The clocks of the whole job:
+    uint64_t start_wall_ns;
+    uint64_t start_cpu_ns;
+    uint64_t job_wall_ns;
+    uint64_t job_cpu_ns;
+    
+    // Returns the CPU time of the whole process in nanoseconds:
+    static uint64_t process_cpu_clock_ns();
+    
+    // Returns the throughput of a stage in megabytes per second:
+    double compute_throughput(stage s) const;
+};
+
+#endif // PIPELINE_STATISTICS_HPP
@@ -0,0 +1,112 @@
+#include "streaming_compressor.hpp"
+#include <algorithm>
+#include <cstring>
+
+streaming_compressor::streaming_compressor(size_t block_size_log2,
+                                           size_t number_of_streams,
+                                           size_t max_code_length)
+:
+    compressor{block_size_log2, number_of_streams, max_code_length},
+    output_position{0},
+    stream_started{false}
+{
+    text.reserve(compressor.get_block_size());
+}
+
+void streaming_compressor::push(const int8_t* text, size_t length)
+{
+    start_stream();
+    size_t block_size = compressor.get_block_size();
+    
+    while (length != 0)
+    {
+        size_t chunk = std::min(length, block_size - this->text.size());
+        this->text.insert(this->text.end(), text, text + chunk);
+        text += chunk;
+        length -= chunk;
+        
+        if (this->text.size() == block_size)
+        {
+            compress_text();
+        }
+    }
+}
+
+void streaming_compressor::flush()
+{
+    start_stream();
+    
+    if (!text.empty())
+    {
+        compress_text();
+    }
+}
+
+void streaming_compressor::end()
+{
+    flush();
+    compressor.append_end_of_stream(index, output);
+    index.clear();
+    stream_started = false;
+}
+
+size_t streaming_compressor::pull(int8_t* output, size_t capacity)
+{
+    size_t length = std::min(capacity, get_available());
+    
+    if (length != 0)
+    {
+        std::memcpy(output, this->output.data() + output_position, length);
+    }
+    
+    output_position += length;
+    
+    if (output_position == this->output.size())
+    {
+        // Everything has been pulled, so the memory can be reused:
+        this->output.clear();
+        output_position = 0;
+    }
+    
+    return length;
+}
+
+size_t streaming_compressor::get_available() const
+{
+    return output.size() - output_position;
+}
+
+void streaming_compressor::start_stream()
+{
+    if (!stream_started)
+    {
+        compressor.append_stream_header(output);
+        stream_started = true;
+    }
+}
+
+void streaming_compressor::compress_text()
+{
+    size_t block_start = output.size();
+    compressor.compress_block(text.data(),
+                              text.size(),
+                              output,
+                              block_scratch);
+    index.add_block(output.size() - block_start, text.size());
+    text.clear();
+}
+
+void streaming_compressor::set_dictionary(const huffman_dictionary* dictionary)
+{
+    compressor.set_dictionary(dictionary);
+}
+
+void streaming_compressor::set_codec(block_compressor::codec block_codec)
+{
+    compressor.set_codec(block_codec);
+}
+
+void streaming_compressor::set_lz77_level(size_t level)
+{
+    compressor.set_lz77_level(level);
+}
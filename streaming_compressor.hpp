@@ -0,0 +1,99 @@
+#ifndef STREAMING_COMPRESSOR_HPP
+#define STREAMING_COMPRESSOR_HPP
+
+#include "block_compressor.hpp"
+#include "block_index.hpp"
+#include <cstdint>
+#include <vector>
+
+/****************************************************************************
+* Compresses a text arriving in chunks of any size into a block stream. The *
+* text is pushed in, and the stream can be pulled out as soon as each block *
+* is complete, so that the memory held depends on the chunks and not on the *
+* length of the text. Without flushes the stream is identical to the one    *
+* 'block_compressor' produces from the whole text.                          *
+****************************************************************************/
+class streaming_compressor {
+public:
+    
+    /*********************************************************************
+    * Constructs a compressor cutting the text into blocks of            *
+    * '2^block_size_log2' bytes coded as 'number_of_streams' interleaved *
+    * streams with no code word longer than 'max_code_length' bits.      *
+    *********************************************************************/
+    explicit streaming_compressor(
+                size_t block_size_log2 = block_format::DEFAULT_BLOCK_SIZE_LOG2,
+                size_t number_of_streams = 1,
+                size_t max_code_length = code_table::MAX_CODE_WORD_LENGTH);
+    
+    /************************************************************************
+    * Appends the 'length' bytes at 'text' to the text and compresses every *
+    * block it completes.                                                   *
+    ************************************************************************/
+    void push(const int8_t* text, size_t length);
+    
+    /*************************************************************************
+    * Compresses the text pushed so far as a block of its own, even if it is *
+    * shorter than the block size, so that all of it can be pulled.          *
+    *************************************************************************/
+    void flush();
+    
+    /************************************************************************
+    * Compresses the rest of the text and closes the stream with the end of *
+    * stream block and the block index. The next push starts a new stream.  *
+    ************************************************************************/
+    void end();
+    
+    /************************************************************************
+    * Moves up to 'capacity' bytes of the compressed stream to 'output' and *
+    * returns their number.                                                 *
+    ************************************************************************/
+    size_t pull(int8_t* output, size_t capacity);
+    
+    /*******************************************************************
+    * Returns the number of the compressed bytes waiting to be pulled. *
+    *******************************************************************/
+    size_t get_available() const;
+    
+    /***************************************************************************
+    * Makes the compressor code the blocks with 'dictionary', or stop doing so *
+    * if it is null. The dictionary must outlive the compressor.               *
+    ***************************************************************************/
+    void set_dictionary(const huffman_dictionary* dictionary);
+    
+    /***********************************************************
+    * Makes the compressor code the blocks with 'block_codec'. *
+    ***********************************************************/
+    void set_codec(block_compressor::codec block_codec);
+    
+    /********************************************************************
+    * Sets the effort level of the LZ77 match finder of the compressor. *
+    ********************************************************************/
+    void set_lz77_level(size_t level);
+    
+private:
+    
+    block_compressor compressor;
+    block_compressor::scratch block_scratch;
+    
+    // The text of the block being filled:
+    std::vector<int8_t> text;
+    
+    // The compressed bytes not pulled yet start at 'output_position':
+    std::vector<int8_t> output;
+    size_t output_position;
+    
+    // The blocks of the current stream:
+    block_index index;
+    
+    // Whether the stream header has been written:
+    bool stream_started;
+    
+    // Writes the stream header unless it has been written already:
+    void start_stream();
+    
+    // Compresses the 'text' into a block:
+    void compress_text();
+};
+
+#endif // STREAMING_COMPRESSOR_HPP
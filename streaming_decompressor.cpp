@@ -0,0 +1,251 @@
+#include "file_format_error.h"
+#include "streaming_decompressor.hpp"
+#include "varint.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+streaming_decompressor::streaming_decompressor()
+:
+    state{stream_state::HEADER},
+    input_position{0},
+    text_position{0},
+    block_size{0},
+    flags{0},
+    statistics{nullptr}
+{}
+
+void streaming_decompressor::push(const int8_t* data, size_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+    
+    if (state == stream_state::FINISHED)
+    {
+        throw file_format_error{"Data follows the end of the stream."};
+    }
+    
+    input.insert(input.end(), data, data + size);
+    
+    if (statistics != nullptr)
+    {
+        statistics->add_compressed_bytes(size);
+    }
+    
+    bool consumed = true;
+    
+    while (consumed)
+    {
+        switch (state)
+        {
+            case stream_state::HEADER:
+                consumed = consume_header();
+                break;
+                
+            case stream_state::BLOCKS:
+                consumed = consume_block();
+                break;
+                
+            case stream_state::TRAILER:
+                consumed = consume_trailer();
+                break;
+                
+            case stream_state::FINISHED:
+                consumed = false;
+                break;
+        }
+    }
+    
+    if (state == stream_state::FINISHED && get_buffered() != 0)
+    {
+        throw file_format_error{"Data follows the end of the stream."};
+    }
+    
+    // Keep only the incomplete part of the stream:
+    input.erase(input.begin(), input.begin() + input_position);
+    input_position = 0;
+}
+
+void streaming_decompressor::end()
+{
+    if (state == stream_state::TRAILER)
+    {
+        throw file_format_error{"The stream ends in the middle of the block "
+                                "index."};
+    }
+    
+    if (state != stream_state::FINISHED)
+    {
+        throw file_format_error{"The stream ends without the end of stream "
+                                "block."};
+    }
+    
+    state = stream_state::HEADER;
+    observed_index.clear();
+}
+
+bool streaming_decompressor::is_finished() const
+{
+    return state == stream_state::FINISHED;
+}
+
+size_t streaming_decompressor::pull(int8_t* text, size_t capacity)
+{
+    size_t length = std::min(capacity, get_available());
+    
+    if (length != 0)
+    {
+        std::memcpy(text, this->text.data() + text_position, length);
+    }
+    
+    text_position += length;
+    
+    if (text_position == this->text.size())
+    {
+        this->text.clear();
+        text_position = 0;
+    }
+    
+    return length;
+}
+
+size_t streaming_decompressor::get_available() const
+{
+    return text.size() - text_position;
+}
+
+void streaming_decompressor::set_statistics(pipeline_statistics* statistics)
+{
+    this->statistics = statistics;
+    decompressor.set_statistics(statistics);
+}
+
+size_t streaming_decompressor::get_buffered() const
+{
+    return input.size() - input_position;
+}
+
+bool streaming_decompressor::consume_header()
+{
+    if (get_buffered() < block_format::STREAM_HEADER_SIZE)
+    {
+        return false;
+    }
+    
+    size_t block_size_log2 =
+            decompressor.read_stream_header(input.data() + input_position,
+                                            get_buffered(),
+                                            flags);
+    block_size = (size_t) 1 << block_size_log2;
+    input_position += block_format::STREAM_HEADER_SIZE;
+    state = stream_state::BLOCKS;
+    return true;
+}
+
+bool streaming_decompressor::consume_block()
+{
+    if (get_buffered() == 0)
+    {
+        return false;
+    }
+    
+    const int8_t* block = input.data() + input_position;
+    int8_t type = block[0];
+    
+    if (type == block_format::END_OF_STREAM)
+    {
+        ++input_position;
+        state = (flags & block_format::HAS_BLOCK_INDEX) != 0
+              ? stream_state::TRAILER
+              : stream_state::FINISHED;
+        return true;
+    }
+    
+    size_t index = 1;
+    size_t length;
+    size_t payload_length;
+    
+    try
+    {
+        length = extract_varint(block, get_buffered(), index);
+        payload_length = extract_varint(block, get_buffered(), index);
+    }
+    catch (std::out_of_range& error)
+    {
+        // The block header is split between the chunks:
+        return false;
+    }
+    
+    if (length == 0 || length > block_size)
+    {
+        std::stringstream ss;
+        ss << "Bad block length: " << length << ".";
+        std::string err_msg = ss.str();
+        throw file_format_error{err_msg.c_str()};
+    }
+    
+    if (payload_length > block_size + block_format::MAX_PAYLOAD_OVERHEAD)
+    {
+        std::stringstream ss;
+        ss << "Bad block payload length: " << payload_length << ".";
+        std::string err_msg = ss.str();
+        throw file_format_error{err_msg.c_str()};
+    }
+    
+    if (get_buffered() - index < payload_length)
+    {
+        return false;
+    }
+    
+    size_t text_start = text.size();
+    text.resize(text_start + length);
+    decompressor.decompress_block((block_format::block_type) type,
+                                  block + index,
+                                  payload_length,
+                                  text.data() + text_start,
+                                  length,
+                                  block_scratch);
+    input_position += index + payload_length;
+    observed_index.add_block(index + payload_length, length);
+    
+    if (statistics != nullptr)
+    {
+        statistics->add_uncompressed_bytes(length);
+    }
+    
+    return true;
+}
+
+bool streaming_decompressor::consume_trailer()
+{
+    // The stored index must describe exactly the blocks just decoded:
+    std::vector<int8_t> expected_trailer;
+    observed_index.append_trailer(expected_trailer);
+    
+    if (get_buffered() < expected_trailer.size())
+    {
+        return false;
+    }
+    
+    if (!std::equal(expected_trailer.begin(),
+                    expected_trailer.end(),
+                    input.begin() + input_position))
+    {
+        throw file_format_error{"The block index does not match the "
+                                "blocks."};
+    }
+    
+    input_position += expected_trailer.size();
+    state = stream_state::FINISHED;
+    return true;
+}
+
+void streaming_decompressor::set_dictionary(
+                                        const huffman_dictionary* dictionary)
+{
+    decompressor.set_dictionary(dictionary);
+}
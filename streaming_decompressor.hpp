@@ -0,0 +1,105 @@
+#ifndef STREAMING_DECOMPRESSOR_HPP
+#define STREAMING_DECOMPRESSOR_HPP
+
+#include "block_decompressor.hpp"
+#include "block_index.hpp"
+#include "pipeline_statistics.hpp"
+#include <cstdint>
+#include <vector>
+
+/*****************************************************************************
+* Decompresses a block stream arriving in chunks of any size. The chunks may *
+* split the stream anywhere, also in the middle of a code word: the bytes    *
+* are held back until the block they belong to is complete, and then its     *
+* text can be pulled. The memory held depends on the chunks and not on the   *
+* length of the stream.                                                      *
+*****************************************************************************/
+class streaming_decompressor {
+public:
+    
+    streaming_decompressor();
+    
+    /**************************************************************************
+    * Appends the 'size' bytes at 'data' to the stream and decompresses every *
+    * block they complete. Throws 'file_format_error' if the stream is bad.   *
+    **************************************************************************/
+    void push(const int8_t* data, size_t size);
+    
+    /************************************************************************
+    * Checks that the whole stream has been pushed, and makes the next push *
+    * start a new stream. Throws 'file_format_error' if the stream is       *
+    * incomplete.                                                           *
+    ************************************************************************/
+    void end();
+    
+    /*********************************************************************
+    * Returns true once the end of stream block and the block index have *
+    * been pushed.                                                       *
+    *********************************************************************/
+    bool is_finished() const;
+    
+    /**********************************************************************
+    * Moves up to 'capacity' bytes of the decompressed text to 'text' and *
+    * returns their number.                                               *
+    **********************************************************************/
+    size_t pull(int8_t* text, size_t capacity);
+    
+    /*********************************************************************
+    * Returns the number of the decompressed bytes waiting to be pulled. *
+    *********************************************************************/
+    size_t get_available() const;
+    
+    /************************************************************************
+    * Makes the decompressor add its stage times and sizes to 'statistics'. *
+    * Passing null stops the collection.                                    *
+    ************************************************************************/
+    void set_statistics(pipeline_statistics* statistics);
+    
+    /************************************************************************
+    * Makes the decompressor decode the blocks coded with 'dictionary'. The *
+    * dictionary must outlive the decompressor.                             *
+    ************************************************************************/
+    void set_dictionary(const huffman_dictionary* dictionary);
+    
+private:
+    
+    enum class stream_state {
+        HEADER,  // Waiting for the stream header.
+        BLOCKS,  // Waiting for the next block.
+        TRAILER, // Waiting for the block index.
+        FINISHED // Nothing more is expected.
+    };
+    
+    block_decompressor decompressor;
+    block_decompressor::scratch block_scratch;
+    stream_state state;
+    
+    // The stream bytes not consumed yet start at 'input_position':
+    std::vector<int8_t> input;
+    size_t input_position;
+    
+    // The text not pulled yet starts at 'text_position':
+    std::vector<int8_t> text;
+    size_t text_position;
+    
+    // The properties of the current stream:
+    size_t block_size;
+    uint8_t flags;
+    
+    // The blocks decoded so far, checked against the stored index:
+    block_index observed_index;
+    
+    // Where to report the sizes, or null:
+    pipeline_statistics* statistics;
+    
+    // Consumes the next part of the stream if it is complete and returns
+    // true, or returns false if more bytes are needed:
+    bool consume_header();
+    bool consume_block();
+    bool consume_trailer();
+    
+    // Returns the number of the stream bytes not consumed yet:
+    size_t get_buffered() const;
+};
+
+#endif // STREAMING_DECOMPRESSOR_HPP
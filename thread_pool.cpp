@@ -0,0 +1,141 @@
+#include "thread_pool.hpp"
+#include <stdexcept>
+#include <utility>
+
+// The index of the worker running on the calling thread:
+static thread_local size_t worker_index_of_thread = thread_pool::NOT_A_WORKER;
+
+thread_pool::thread_pool(size_t number_of_threads)
+:
+    number_of_pending_tasks{0},
+    next_queue_index{0},
+    stopping{false}
+{
+    if (number_of_threads == 0)
+    {
+        throw std::runtime_error{"A thread pool needs at least one thread."};
+    }
+    
+    for (size_t i = 0; i != number_of_threads; ++i)
+    {
+        queues.emplace_back(new worker_queue);
+    }
+    
+    for (size_t i = 0; i != number_of_threads; ++i)
+    {
+        threads.emplace_back(&thread_pool::run, this, i);
+    }
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    
+    wake_up.notify_all();
+    
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+size_t thread_pool::size() const
+{
+    return threads.size();
+}
+
+size_t thread_pool::get_worker_index()
+{
+    return worker_index_of_thread;
+}
+
+std::future<void> thread_pool::submit(std::function<void()> task)
+{
+    std::packaged_task<void()> packaged_task(std::move(task));
+    std::future<void> future = packaged_task.get_future();
+    
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        ++number_of_pending_tasks;
+    }
+    
+    worker_queue& queue = *queues[next_queue_index++ % queues.size()];
+    
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(packaged_task));
+    }
+    
+    wake_up.notify_one();
+    return future;
+}
+
+bool thread_pool::try_take_task(size_t worker_index,
+                                std::packaged_task<void()>& task)
+{
+    // Serve the own queue in the submission order:
+    {
+        worker_queue& queue = *queues[worker_index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            --number_of_pending_tasks;
+            return true;
+        }
+    }
+    
+    // Steal from the back of the other queues:
+    for (size_t i = 1; i != queues.size(); ++i)
+    {
+        worker_queue& queue = *queues[(worker_index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            --number_of_pending_tasks;
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+void thread_pool::run(size_t worker_index)
+{
+    worker_index_of_thread = worker_index;
+    
+    while (true)
+    {
+        std::packaged_task<void()> task;
+        
+        if (try_take_task(worker_index, task))
+        {
+            task();
+            continue;
+        }
+        
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        
+        if (stopping && number_of_pending_tasks == 0)
+        {
+            return;
+        }
+        
+        wake_up.wait(lock, [this]() {
+            return stopping || number_of_pending_tasks > 0;
+        });
+        
+        if (stopping && number_of_pending_tasks == 0)
+        {
+            return;
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***************************************************************************
+* A fixed-size pool of worker threads. Each worker owns a task queue; the  *
+* submitted tasks are spread over the queues and a worker that runs out of *
+* its own tasks steals from the back of the other queues.                  *
+***************************************************************************/
+class thread_pool {
+public:
+    
+    // The worker index of the threads that are not workers of a pool:
+    constexpr static size_t NOT_A_WORKER = SIZE_MAX;
+    
+    /*********************************************
+    * Starts 'number_of_threads' worker threads. *
+    *********************************************/
+    explicit thread_pool(size_t number_of_threads);
+    
+    /*********************************************************
+    * Runs the remaining tasks and joins the worker threads. *
+    *********************************************************/
+    ~thread_pool();
+    
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+    
+    /*************************************************************************
+    * Schedules 'task' for execution. The returned future becomes ready when *
+    * the task finishes and rethrows the exception the task threw, if any.   *
+    *************************************************************************/
+    std::future<void> submit(std::function<void()> task);
+    
+    /****************************************
+    * Returns the number of worker threads. *
+    ****************************************/
+    size_t size() const;
+    
+    /************************************************************************
+    * Returns the index of the calling worker thread within its pool, below *
+    * 'size()', or 'NOT_A_WORKER' if the caller is not a worker. Lets a     *
+    * task pick the per-worker state it may use without locking.            *
+    ************************************************************************/
+    static size_t get_worker_index();
+    
+private:
+    
+    // The task queue of a single worker:
+    struct worker_queue {
+        std::mutex mutex;
+        std::deque<std::packaged_task<void()>> tasks;
+    };
+    
+    std::vector<std::unique_ptr<worker_queue>> queues;
+    std::vector<std::thread> threads;
+    
+    // Guards the sleeping of idle workers:
+    std::mutex sleep_mutex;
+    std::condition_variable wake_up;
+    
+    // The number of submitted tasks not taken by any worker yet:
+    std::atomic<int64_t> number_of_pending_tasks;
+    
+    // The queue the next submitted task goes to:
+    std::atomic<size_t> next_queue_index;
+    
+    bool stopping;
+    
+    // The main loop of the worker 'worker_index':
+    void run(size_t worker_index);
+    
+    // Takes a task from the own queue or steals one from the others:
+    bool try_take_task(size_t worker_index, std::packaged_task<void()>& task);
+};
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,87 @@
+#include "file_format_error.h"
+#include "varint.hpp"
+#include <stdexcept>
+
+void append_varint(uint64_t value, std::vector<int8_t>& byte_list)
+{
+    while (value >= 0x80)
+    {
+        byte_list.push_back((int8_t)((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    
+    byte_list.push_back((int8_t) value);
+}
+
+size_t varint_length(uint64_t value)
+{
+    size_t length = 1;
+    
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        ++length;
+    }
+    
+    return length;
+}
+
+uint64_t extract_varint(const std::vector<int8_t>& data, size_t& index)
+{
+    return extract_varint(data.data(), data.size(), index);
+}
+
+uint64_t extract_varint(const int8_t* data, size_t size, size_t& index)
+{
+    uint64_t value = 0;
+    
+    for (size_t shift = 0; ; shift += 7)
+    {
+        if (index >= size)
+        {
+            throw std::out_of_range{"The data ends in the middle of a varint."};
+        }
+        
+        uint8_t byte = data[index++];
+        
+        if (shift > 63)
+        {
+            throw file_format_error{"The varint does not fit in 64 bits."};
+        }
+        
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        
+        if ((byte & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+}
+
+uint64_t read_varint(std::istream& in)
+{
+    uint64_t value = 0;
+    
+    for (size_t shift = 0; ; shift += 7)
+    {
+        int byte = in.get();
+        
+        if (byte == std::char_traits<char>::eof())
+        {
+            throw file_format_error{"The stream ends in the middle of a "
+                                    "varint."};
+        }
+        
+        if (shift > 63)
+        {
+            throw file_format_error{"The varint does not fit in 64 bits."};
+        }
+        
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        
+        if ((byte & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef VARINT_HPP
+#define VARINT_HPP
+
+#include <cstdint>
+#include <istream>
+#include <vector>
+
+// The maximum number of bytes a 64-bit varint occupies:
+constexpr size_t MAX_VARINT_BYTES = 10;
+
+/*************************************************************************
+* Appends 'value' to 'byte_list' 7 bits per byte, lowest bits first. The *
+* highest bit of each byte tells whether more bytes follow.              *
+*************************************************************************/
+void append_varint(uint64_t value, std::vector<int8_t>& byte_list);
+
+/****************************************************************
+* Returns the number of bytes 'append_varint' emits for 'value'. *
+****************************************************************/
+size_t varint_length(uint64_t value);
+
+/**************************************************************************
+* Extracts the varint starting at 'data[index]' and advances 'index' past *
+* it. Throws 'std::out_of_range' if the data ends in the middle of the    *
+* varint and 'file_format_error' if it does not fit in 64 bits.           *
+**************************************************************************/
+uint64_t extract_varint(const std::vector<int8_t>& data, size_t& index);
+
+/***********************************************************************
+* Extracts the varint starting at 'data[index]' of the 'size' bytes at *
+* 'data' in the same way.                                              *
+***********************************************************************/
+uint64_t extract_varint(const int8_t* data, size_t size, size_t& index);
+
+/*****************************************************************************
+* Reads a varint from 'in'. Throws 'file_format_error' if the stream ends in *
+* the middle of the varint or if it does not fit in 64 bits.                 *
+*****************************************************************************/
+uint64_t read_varint(std::istream& in);
+
+#endif // VARINT_HPP